@@ -0,0 +1,187 @@
+#ifndef BLE_TX_STREAM_H
+#define BLE_TX_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "ring_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// BLE TX Frame Stream
+//
+// Variable-length frames stored back to back in a byte ring, each behind a
+// 2-byte little-endian length prefix. Producers reserve space and build the
+// frame in place; the BLE task notifies straight out of the ring and then
+// releases the frame. A frame never straddles the end of the buffer: when
+// it does not fit before the end, the tail space is skipped with a pad
+// marker (or left implicit when less than a prefix remains).
+//
+// For transmission, runs of consecutive frames are handed out as one span
+// of prefixed frames, so a single notification carries as many whole frames
+// as fit the ATT payload; the receiver splits them on the length prefixes.
+//
+// The commit time of each frame is kept beside the ring, in commit order,
+// so the consumer can tell how long the oldest pending frame has waited.
+// ============================================================================
+
+#define BLE_TX_STREAM_HEADER_SIZE 2
+#define BLE_TX_STREAM_PAD 0xFFFF          // Length marker: skip to the end of the buffer
+#define BLE_TX_STREAM_MAX_FRAME 512       // ATT notification payload limit
+#ifndef BLE_TX_STREAM_MAX_PENDING
+#define BLE_TX_STREAM_MAX_PENDING 128     // Frames queued at once (commit times kept), power of 2
+#endif
+
+/**
+ * @brief Frame stream state
+ */
+typedef struct {
+    ring_buffer_t ring;              // Byte ring (element_size 1)
+    SemaphoreHandle_t lock;          // Serializes producers and the consumer's release
+    StaticSemaphore_t lock_storage;  // Backing for lock: no heap allocation
+    TaskHandle_t consumer;           // Notified on every commit
+    uint32_t commit_us[BLE_TX_STREAM_MAX_PENDING]; // Commit time per pending frame, oldest at stamp_tail
+    uint16_t stamp_head;             // Free-running; masked on access
+    uint16_t stamp_tail;
+    uint32_t dropped;                // Frames rejected because the ring (or the commit time list) was full
+    uint32_t busy;                   // Frames dropped by a non-blocking reserve: lock held
+    uint32_t oversize;               // Frames discarded as larger than the link payload
+} ble_tx_stream_t;
+
+/**
+ * @brief Initialize a frame stream
+ *
+ * @param stream Stream state
+ * @param buffer Backing storage
+ * @param size Backing storage size in bytes
+ * @return true on success
+ */
+bool ble_tx_stream_init(ble_tx_stream_t *stream, uint8_t *buffer, uint32_t size);
+
+/**
+ * @brief Set the task to notify when a frame is committed
+ *
+ * @param stream Stream state
+ * @param consumer Consumer task
+ */
+void ble_tx_stream_set_consumer(ble_tx_stream_t *stream, TaskHandle_t consumer);
+
+/**
+ * @brief Reserve contiguous space for one frame (producer side)
+ *
+ * On success the stream stays locked until ble_tx_stream_commit(), so the
+ * frame should be built without blocking.
+ *
+ * @param stream Stream state
+ * @param max_len Largest payload the producer may write
+ * @return Payload pointer, NULL if the ring is full or BLE_TX_STREAM_MAX_PENDING
+ *         frames are queued (counted in dropped)
+ */
+uint8_t *ble_tx_stream_reserve(ble_tx_stream_t *stream, uint16_t max_len);
+
+/**
+ * @brief Reserve like ble_tx_stream_reserve(), without waiting for the lock
+ *
+ * For real-time producers, which drop the frame rather than wait on tasks
+ * holding the stream (possibly on the other core).
+ *
+ * @param stream Stream state
+ * @param max_len Largest payload the producer may write
+ * @return Payload pointer, NULL if the ring is full (dropped) or locked (busy)
+ */
+uint8_t *ble_tx_stream_try_reserve(ble_tx_stream_t *stream, uint16_t max_len);
+
+/**
+ * @brief Publish a reserved frame and wake the consumer
+ *
+ * @param stream Stream state
+ * @param len Payload bytes actually written (<= max_len of the reservation)
+ */
+void ble_tx_stream_commit(ble_tx_stream_t *stream, uint16_t len);
+
+/**
+ * @brief Copy a ready-made frame into the stream
+ *
+ * @param stream Stream state
+ * @param data Payload
+ * @param len Payload length
+ * @return true if queued
+ */
+bool ble_tx_stream_write(ble_tx_stream_t *stream, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Copy a ready-made frame into the stream without waiting for the lock
+ *
+ * @param stream Stream state
+ * @param data Payload
+ * @param len Payload length
+ * @return true if queued
+ */
+bool ble_tx_stream_try_write(ble_tx_stream_t *stream, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Get the oldest frame without removing it (consumer side)
+ *
+ * The payload stays valid until ble_tx_stream_release().
+ *
+ * @param stream Stream state
+ * @param frame Receives a pointer into the ring
+ * @param len Receives payload length
+ * @return true if a frame is pending
+ */
+bool ble_tx_stream_peek(ble_tx_stream_t *stream, const uint8_t **frame, uint16_t *len);
+
+/**
+ * @brief Release the frame returned by ble_tx_stream_peek()
+ *
+ * @param stream Stream state
+ * @param len Payload length of that frame
+ */
+void ble_tx_stream_release(ble_tx_stream_t *stream, uint16_t len);
+
+/**
+ * @brief Get the longest run of whole frames that fits one packet (consumer side)
+ *
+ * The span starts at the oldest frame's length prefix and covers whole
+ * prefixed frames only. A frame that alone exceeds max_bytes can never be
+ * sent and is discarded (counted in oversize). The span stays valid until
+ * ble_tx_stream_release_span().
+ *
+ * @param stream Stream state
+ * @param max_bytes Packet capacity, length prefixes included
+ * @param span Receives a pointer into the ring
+ * @param full Receives true if no further frame can join this span
+ * @return Span length in bytes, 0 if nothing is pending
+ */
+uint16_t ble_tx_stream_peek_span(ble_tx_stream_t *stream,
+                                 uint16_t max_bytes,
+                                 const uint8_t **span,
+                                 bool *full);
+
+/**
+ * @brief Commit time of the oldest pending frame (consumer side)
+ *
+ * @param stream Stream state
+ * @param commit_us Receives its hal_get_time_us() at commit, low 32 bits
+ * @return true if a frame is pending
+ */
+bool ble_tx_stream_oldest_commit(ble_tx_stream_t *stream, uint32_t *commit_us);
+
+/**
+ * @brief Release a span returned by ble_tx_stream_peek_span()
+ *
+ * @param stream Stream state
+ * @param len Span length in bytes
+ */
+void ble_tx_stream_release_span(ble_tx_stream_t *stream, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_TX_STREAM_H
@@ -0,0 +1,38 @@
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Boot Phase Trace
+//
+// Timestamps each startup phase (time since the high-resolution timer
+// started, i.e. shortly after reset). Phases may be marked from several
+// tasks, since the BLE stack comes up on core 1 while the real-time path is
+// already running. The trace is logged once, when boot is complete.
+// ============================================================================
+
+#define BOOT_TRACE_MAX_PHASES 16
+
+/**
+ * @brief Record the end of a startup phase
+ *
+ * @param phase Phase name (string literal; the pointer is kept)
+ */
+void boot_trace_mark(const char *phase);
+
+/**
+ * @brief Log all recorded phases with their durations
+ */
+void boot_trace_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_TRACE_H
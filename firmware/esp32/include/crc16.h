@@ -0,0 +1,48 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection, no final XOR)
+//
+// Table-driven, slicing-by-4: four bytes per step through four 256-entry
+// tables held in DRAM, so it stays usable while the flash cache is off.
+// The state is the running CRC, so a frame can be checksummed piece by
+// piece (e.g. both halves of a wrapped ring buffer region).
+// Check value: crc16_compute("123456789", 9) == 0x29B1.
+// ============================================================================
+
+#define CRC16_INIT 0xFFFF
+
+/**
+ * @brief Feed a chunk into a running CRC
+ *
+ * @param crc Running CRC (CRC16_INIT for a new message)
+ * @param data Chunk
+ * @param len Chunk length
+ * @return Updated CRC
+ */
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief CRC of a contiguous message
+ *
+ * @param data Message
+ * @param len Message length
+ * @return CRC
+ */
+static inline uint16_t crc16_compute(const uint8_t *data, size_t len) {
+    return crc16_update(CRC16_INIT, data, len);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC16_H
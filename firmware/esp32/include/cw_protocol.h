@@ -0,0 +1,119 @@
+#ifndef CW_PROTOCOL_H
+#define CW_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "crc16.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// CartelWorx Protocol v1.2 Framing
+//
+// Every record sent to the app starts with a 4-byte header: service code,
+// per-service sequence number (lets the app spot drops) and payload length,
+// little-endian. The payload is followed by a CRC16 (CCITT-FALSE, little-
+// endian) over header and payload. Records travel as BLE TX stream frames,
+// several per notification.
+// ============================================================================
+
+#define CW_PROTOCOL_VERSION 0x12
+
+#define CW_SERVICE_REALTIME_SENSOR_BURST 0xC0
+#define CW_SERVICE_KNOCK_STREAM 0xC1
+#define CW_SERVICE_CYLINDER_HEALTH 0xC2
+#define CW_SERVICE_ADAPTIVE_TUNING_STATE 0xC4
+#define CW_SERVICE_TELEMETRY_PLAYBACK 0xC8
+#define CW_SERVICE_TUNING_ADJUSTMENT 0xCE
+
+#define CW_FRAME_HEADER_SIZE 4
+#define CW_FRAME_CRC_SIZE 2
+#define CW_FRAME_OVERHEAD (CW_FRAME_HEADER_SIZE + CW_FRAME_CRC_SIZE)
+
+/**
+ * @brief Decoded frame header
+ */
+typedef struct {
+    uint8_t service;
+    uint8_t sequence;
+    uint16_t payload_len;
+} cw_frame_header_t;
+
+/**
+ * @brief Write a frame header
+ *
+ * @param out Destination (CW_FRAME_HEADER_SIZE bytes)
+ * @param service Service code
+ * @param sequence Per-service sequence number
+ * @param payload_len Payload bytes following the header
+ */
+static inline void cw_frame_write_header(uint8_t *out, uint8_t service, uint8_t sequence, uint16_t payload_len) {
+    out[0] = service;
+    out[1] = sequence;
+    out[2] = (uint8_t)(payload_len & 0xFF);
+    out[3] = (uint8_t)(payload_len >> 8);
+}
+
+/**
+ * @brief Parse a frame header
+ *
+ * @param in Received bytes
+ * @param len Number of received bytes
+ * @param out Receives header
+ * @return true if the header and its whole payload are present
+ */
+static inline bool cw_frame_read_header(const uint8_t *in, uint16_t len, cw_frame_header_t *out) {
+    if (len < CW_FRAME_HEADER_SIZE) {
+        return false;
+    }
+    out->service = in[0];
+    out->sequence = in[1];
+    out->payload_len = (uint16_t)in[2] | ((uint16_t)in[3] << 8);
+    return out->payload_len <= len - CW_FRAME_HEADER_SIZE;
+}
+
+/**
+ * @brief Complete a frame whose payload is already in place
+ *
+ * Writes the header in front of the payload and the CRC after it.
+ *
+ * @param frame Frame start (payload at frame + CW_FRAME_HEADER_SIZE)
+ * @param service Service code
+ * @param sequence Per-service sequence number
+ * @param payload_len Payload bytes
+ * @return Total frame length
+ */
+static inline uint16_t cw_frame_finish(uint8_t *frame, uint8_t service, uint8_t sequence, uint16_t payload_len) {
+    cw_frame_write_header(frame, service, sequence, payload_len);
+    const uint16_t body = CW_FRAME_HEADER_SIZE + payload_len;
+    const uint16_t crc = crc16_compute(frame, body);
+    frame[body] = (uint8_t)(crc & 0xFF);
+    frame[body + 1] = (uint8_t)(crc >> 8);
+    return body + CW_FRAME_CRC_SIZE;
+}
+
+/**
+ * @brief Parse a frame header and verify the CRC
+ *
+ * @param in Received bytes
+ * @param len Number of received bytes
+ * @param out Receives header
+ * @return true if the whole frame is present and the CRC matches
+ */
+static inline bool cw_frame_check(const uint8_t *in, uint16_t len, cw_frame_header_t *out) {
+    if (!cw_frame_read_header(in, len, out) ||
+        out->payload_len + CW_FRAME_OVERHEAD > len) {
+        return false;
+    }
+    const uint16_t body = CW_FRAME_HEADER_SIZE + out->payload_len;
+    const uint16_t crc = (uint16_t)in[body] | ((uint16_t)in[body + 1] << 8);
+    return crc16_compute(in, body) == crc;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CW_PROTOCOL_H
@@ -0,0 +1,128 @@
+#ifndef CYLINDER_HEALTH_H
+#define CYLINDER_HEALTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "knock_window.h"
+#include "knock_noise_floor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Per-Cylinder Health Scoring
+//
+// Incremental statistics keyed by cylinder, fed once per knock window with
+// that cylinder's knock score and with the TDC-to-TDC time of the power
+// stroke that preceded it (crank-tooth timing). Once every cylinder has both
+// for a cycle, each stroke time becomes a deviation from that cycle's mean,
+// in basis points. Normalizing per cycle takes out speed changes, so a
+// cylinder that keeps slowing the crank stands out as the weak one.
+//
+// Each cylinder keeps a rolling window of the last CYL_HEALTH_WINDOW_CYCLES
+// cycles in fixed rings with running sums, plus a Welford mean/variance
+// since the engine started. Updates are O(cylinders) per cycle, and what
+// leaves the device is a few bytes of scores per cylinder, never raw data.
+// ============================================================================
+
+#define CYL_HEALTH_WINDOW_CYCLES 32             // Rolling window length, power of 2
+#define CYL_HEALTH_MAX_STROKE_US 100000         // Slower strokes (cranking, stalling) are not scored
+#define CYL_HEALTH_IMBALANCE_LIMIT_BP 200       // Rolling deviation flagged as imbalance (2%)
+#define CYL_HEALTH_KNOCK_LIMIT_Q8 (2 * KNOCK_SCORE_UNITY) // Rolling mean score flagged as knock-prone
+#define CYL_HEALTH_DRIFT_SIGMAS 3               // Rolling mean this many standard errors off the baseline
+#define CYL_HEALTH_MIN_BASELINE_CYCLES 256      // Baseline needed before drift is judged
+
+#define CYL_HEALTH_FLAG_IMBALANCE (1 << 0)
+#define CYL_HEALTH_FLAG_KNOCK (1 << 1)
+#define CYL_HEALTH_FLAG_DRIFT (1 << 2)          // Rolling stroke or knock mean moved off the baseline
+#define CYL_HEALTH_FLAG_PARTIAL (1 << 3)        // Rolling window not yet full
+
+// CW_SERVICE_CYLINDER_HEALTH payload: u32 cycle, u8 cylinders, then per
+// cylinder i16 imbalance_bp, u16 stability_bp, u16 knock_q8, u8 flags
+#define CYL_HEALTH_PAYLOAD_HEADER_SIZE 5
+#define CYL_HEALTH_PAYLOAD_CYL_SIZE 7
+#define CYL_HEALTH_MAX_PAYLOAD (CYL_HEALTH_PAYLOAD_HEADER_SIZE + KNOCK_MAX_CYLINDERS * CYL_HEALTH_PAYLOAD_CYL_SIZE)
+
+/**
+ * @brief Streaming mean and variance (Welford)
+ */
+typedef struct {
+    uint32_t count;
+    float mean;
+    float m2;               // Sum of squared deviations from the mean
+} cyl_health_welford_t;
+
+/**
+ * @brief Scores for one cylinder, refreshed every cycle
+ */
+typedef struct {
+    int16_t imbalance_bp;   // Rolling mean stroke time vs the cycle mean; positive = slower (weaker)
+    uint16_t stability_bp;  // Rolling standard deviation of it: combustion variability
+    uint16_t knock_q8;      // Rolling mean knock score (energy / floor, Q8)
+    uint8_t flags;          // CYL_HEALTH_FLAG_*
+} cyl_health_score_t;
+
+/**
+ * @brief Statistics for one cylinder
+ */
+typedef struct {
+    int16_t deviation_bp[CYL_HEALTH_WINDOW_CYCLES];
+    uint16_t knock_q8[CYL_HEALTH_WINDOW_CYCLES];
+    int32_t deviation_sum;          // Over the rolling window
+    int64_t deviation_sq_sum;
+    uint32_t knock_sum;
+    cyl_health_welford_t deviation; // Since the engine started
+    cyl_health_welford_t knock;
+    uint32_t pending_stroke_us;     // This cycle's inputs so far
+    uint16_t pending_knock_q8;
+    uint8_t pending;                // Inputs present, bit 0 knock, bit 1 stroke
+} cyl_health_cylinder_t;
+
+/**
+ * @brief Health state for all cylinders (knock task only)
+ */
+typedef struct {
+    uint8_t num_cylinders;
+    uint8_t head;                   // Next ring slot, shared: every cylinder advances per cycle
+    uint8_t fill;                   // Slots holding data
+    uint32_t cycles;                // Cycles scored since init
+    cyl_health_cylinder_t cyl[KNOCK_MAX_CYLINDERS];
+    cyl_health_score_t scores[KNOCK_MAX_CYLINDERS];
+} cylinder_health_t;
+
+/**
+ * @brief Clear all statistics (e.g. at each engine start)
+ *
+ * @param ch Health state
+ * @param num_cylinders Cylinders scored, 2..KNOCK_MAX_CYLINDERS
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for a bad cylinder count
+ */
+esp_err_t cylinder_health_init(cylinder_health_t *ch, uint8_t num_cylinders);
+
+/**
+ * @brief Feed one completed knock window
+ *
+ * @param ch Health state
+ * @param window Scheduled window (cylinder, stroke timing)
+ * @param knock_q8 Its knock score
+ * @return true when this completed a cycle and ch->scores were refreshed
+ */
+bool cylinder_health_on_window(cylinder_health_t *ch, const knock_window_t *window, uint16_t knock_q8);
+
+/**
+ * @brief Serialize the current scores as a CW_SERVICE_CYLINDER_HEALTH payload
+ *
+ * @param ch Health state
+ * @param out Destination
+ * @param capacity Bytes available at out
+ * @return Payload length, 0 if capacity is too small
+ */
+uint16_t cylinder_health_encode(const cylinder_health_t *ch, uint8_t *out, uint16_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CYLINDER_HEALTH_H
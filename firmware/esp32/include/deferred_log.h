@@ -0,0 +1,91 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Deferred Binary Logging
+//
+// Hot paths log a format ID plus up to four 32-bit arguments into a
+// per-core lock-free ring; nothing is formatted and nothing touches the
+// UART there. A low-priority task drains both rings and formats records
+// through ESP_LOG. Format IDs are stable (append only), so a host tool can
+// equally decode raw records off-device.
+//
+// Pushing masks interrupts on the local core for the few instructions of
+// the copy, which makes each core's ring single-producer even with tasks
+// and ISRs logging on the same core. Safe from ISRs (IRAM).
+// ============================================================================
+
+// X(id, format): append new entries at the end only
+#define DEFERRED_LOG_FORMATS(X)                                          \
+    X(DLOG_OBD_POLL, "OBD poll: %lu PIDs")                               \
+    X(DLOG_OBD_TIMEOUT, "OBD request timed out after %lu us")            \
+    X(DLOG_KNOCK_EVENT, "Knock cyl %lu: score %lu/256, retard %lu deg")
+
+typedef enum {
+#define DEFERRED_LOG_ENUM(id, fmt) id,
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_ENUM)
+#undef DEFERRED_LOG_ENUM
+    DLOG_FORMAT_COUNT,
+} deferred_log_id_t;
+
+#define DEFERRED_LOG_MAX_ARGS 4
+#define DEFERRED_LOG_RING_RECORDS 64     // Per core
+#define DEFERRED_LOG_DRAIN_PERIOD_MS 50
+
+/**
+ * @brief One binary log record
+ */
+typedef struct {
+    uint32_t timestamp_us;
+    uint16_t id;
+    uint8_t nargs;
+    uint8_t core;
+    uint32_t args[DEFERRED_LOG_MAX_ARGS];
+} deferred_log_record_t;
+
+/**
+ * @brief Set up the per-core rings (call before any task logs)
+ */
+void deferred_log_init(void);
+
+/**
+ * @brief Queue a record (any context, IRAM)
+ *
+ * @param id Format ID
+ * @param nargs Number of arguments used
+ * @param a0..a3 Arguments
+ */
+void deferred_log_write(deferred_log_id_t id, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/**
+ * @brief Records lost because a ring was full
+ *
+ * @return Drop count summed over cores
+ */
+uint32_t deferred_log_get_dropped(void);
+
+/**
+ * @brief Low-priority drain task: formats queued records through ESP_LOG
+ *
+ * @param pvParameters Unused
+ */
+void deferred_log_task(void *pvParameters);
+
+#define DLOG0(id) deferred_log_write((id), 0, 0, 0, 0, 0)
+#define DLOG1(id, a) deferred_log_write((id), 1, (uint32_t)(a), 0, 0, 0)
+#define DLOG2(id, a, b) deferred_log_write((id), 2, (uint32_t)(a), (uint32_t)(b), 0, 0)
+#define DLOG3(id, a, b, c) deferred_log_write((id), 3, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), 0)
+#define DLOG4(id, a, b, c, d) deferred_log_write((id), 4, (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEFERRED_LOG_H
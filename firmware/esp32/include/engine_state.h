@@ -0,0 +1,97 @@
+#ifndef ENGINE_STATE_H
+#define ENGINE_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Engine State Snapshot
+//
+// One cached view of the engine that its consumers read without touching a
+// peripheral or waiting on a CAN response. Each writer owns one part: the
+// crank ISR publishes engine speed at every TDC, and the CAN receiver
+// publishes each decoded OBD-II response in one go. Because the two writers
+// run on different cores, each part has its own seqlock.
+//
+// Writers mask interrupts on their core for the few stores of an update, so
+// an update is never preempted. A reader that catches one in progress only
+// retries for those few stores, which makes snapshots safe and lock-free
+// from tasks and ISRs on either core (IRAM).
+// ============================================================================
+
+/**
+ * @brief Crank-derived state (crank ISR writes)
+ */
+typedef struct {
+    uint64_t tdc_us;            // Time of the last TDC, 0 = none yet
+    uint32_t tdc_count;         // TDCs seen since boot
+    uint16_t rpm;               // Engine speed measured at that TDC
+    uint8_t cylinder;           // Cylinder that reached TDC (1-based)
+} engine_crank_state_t;
+
+/**
+ * @brief ECU-reported state (CAN receiver writes)
+ *
+ * Each field keeps its last reported value; PIDs polled at lower rates
+ * are older than updated_us.
+ */
+typedef struct {
+    uint64_t updated_us;        // Time of the last response, 0 = none yet
+    uint16_t rpm;               // PID 0x0C
+    uint16_t map_kpa;           // PID 0x0B
+    uint8_t load_pct;           // PID 0x04
+    uint8_t tps_pct;            // PID 0x11
+    int8_t timing_advance_deg;  // PID 0x0E, degrees BTDC
+    int16_t coolant_c;          // PID 0x05
+    int16_t iat_c;              // PID 0x0F
+} engine_obd_state_t;
+
+/**
+ * @brief Consistent snapshot of both parts
+ */
+typedef struct {
+    engine_crank_state_t crank;
+    engine_obd_state_t obd;
+} engine_state_t;
+
+/**
+ * @brief Clear the cached state (before the writers start)
+ */
+void engine_state_init(void);
+
+/**
+ * @brief Publish a TDC (crank ISR only, IRAM)
+ *
+ * @param rpm Engine speed measured at TDC
+ * @param cylinder Cylinder at TDC (1-based)
+ * @param tdc_us TDC timestamp
+ */
+void engine_state_publish_crank(uint16_t rpm, uint8_t cylinder, uint64_t tdc_us);
+
+/**
+ * @brief Publish ECU-reported state (CAN receiver only)
+ * @param obd Merged state after the latest response
+ */
+void engine_state_publish_obd(const engine_obd_state_t *obd);
+
+/**
+ * @brief Take a snapshot (any context, IRAM)
+ * @param out Receives both parts, each consistent in itself
+ */
+void engine_state_read(engine_state_t *out);
+
+/**
+ * @brief Take the ECU-reported part only (any context, IRAM)
+ * @param out Receives the OBD-II state
+ */
+void engine_state_read_obd(engine_obd_state_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENGINE_STATE_H
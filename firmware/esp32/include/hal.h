@@ -37,6 +37,9 @@ esp_err_t hal_deinit_system(void);
 
 /**
  * @brief Get current system time in microseconds
+ *
+ * Called from the crank ISR: must be ISR-safe and IRAM-resident.
+ *
  * @return Current time in microseconds (high resolution timer)
  */
 uint64_t hal_get_time_us(void);
@@ -56,7 +59,10 @@ void hal_delay_ms(uint32_t ms);
 // --- CAN/OBD-II Interface ---
 
 #define HAL_CAN_MAX_DATA_LENGTH 8
-#define HAL_CAN_RX_BUFFER_SIZE 16
+#ifndef HAL_CAN_RX_BUFFER_SIZE
+#define HAL_CAN_RX_BUFFER_SIZE 16             // RX queue depth (override with -DHAL_CAN_RX_BUFFER_SIZE=N, max 255)
+#endif
+#define HAL_CAN_WAIT_FOREVER UINT32_MAX       // Timeout value: block until a frame arrives
 
 typedef struct {
     uint32_t id;                          // CAN message ID
@@ -92,6 +98,51 @@ esp_err_t hal_can_read_frame(hal_can_frame_t *frame);
  */
 uint8_t hal_can_get_rx_count(void);
 
+/**
+ * @brief Drain all pending CAN frames in one call
+ *
+ * Blocks until at least one frame arrives (woken by the RX interrupt, not
+ * a timer) or timeout_ms expires, then copies out every frame already
+ * queued, up to max_frames.
+ *
+ * @param frames Array to receive frames
+ * @param max_frames Capacity of frames
+ * @param timeout_ms Max wait for the first frame (HAL_CAN_WAIT_FOREVER to block)
+ * @return Number of frames read, 0 on timeout
+ */
+uint16_t hal_can_read_frames(hal_can_frame_t *frames,
+                             uint16_t max_frames,
+                             uint32_t timeout_ms);
+
+/**
+ * @brief Get number of frames lost because the RX buffer was full
+ * @return Overflow count since hal_can_init()
+ */
+uint32_t hal_can_get_rx_overflow_count(void);
+
+#define HAL_CAN_MAX_FILTERS 8
+#define HAL_CAN_STD_ID_MASK 0x7FF
+#define HAL_CAN_EXT_ID_MASK 0x1FFFFFFF
+
+/**
+ * @brief Restrict reception to a set of CAN IDs
+ *
+ * A frame is accepted if (frame.id & masks[i]) == (ids[i] & masks[i]) for
+ * any i. The set is programmed into the controller's acceptance filter;
+ * if the hardware filter cannot express it exactly, it is widened to a
+ * superset and the remainder is rejected by a software ID check before
+ * frames are returned. Reinstalls the driver, so call it before RX tasks
+ * start.
+ *
+ * @param ids Acceptance IDs (11-bit, or 29-bit if above HAL_CAN_STD_ID_MASK)
+ * @param masks Bits of each ID that must match (NULL = exact match)
+ * @param count Number of entries (0 = accept all, max HAL_CAN_MAX_FILTERS)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on bad parameters
+ */
+esp_err_t hal_can_set_filters(const uint32_t *ids,
+                              const uint32_t *masks,
+                              uint8_t count);
+
 /**
  * @brief Check if CAN interface is initialized and active
  * @return true if CAN is operational
@@ -130,10 +181,74 @@ uint16_t hal_adc_read_knock_sensor_averaged(uint8_t num_samples);
  */
 uint32_t hal_adc_to_mv(uint16_t adc_value);
 
+// --- ADC Continuous Stream (Knock Sensor, DMA) ---
+
+#define HAL_ADC_KNOCK_STREAM_RATE_MIN_HZ 20000    // ADC DMA lower sample rate bound
+#define HAL_ADC_KNOCK_STREAM_RATE_MAX_HZ 2000000  // ADC DMA upper sample rate bound
+#define HAL_ADC_KNOCK_STREAM_MAX_BLOCK 512        // Max samples per DMA block
+
+/**
+ * @brief Block-ready callback, invoked from the ADC DMA ISR
+ *
+ * Must be IRAM-resident and ISR-safe. Typical use is a single
+ * vTaskNotifyGiveFromISR() to wake the knock processing task.
+ *
+ * @return true if a higher priority task was woken (yield on ISR exit)
+ */
+typedef bool (*hal_adc_block_ready_cb_t)(void);
+
+/**
+ * @brief Start continuous DMA acquisition of the knock sensor
+ *
+ * The ADC is clocked by the digital controller, so sample spacing is
+ * set by hardware rather than the RTOS tick. Samples are collected in
+ * double-buffered blocks of block_len; cb fires once per completed block.
+ *
+ * @param rate_hz Sample rate (HAL_ADC_KNOCK_STREAM_RATE_MIN_HZ..MAX_HZ)
+ * @param block_len Samples per block (even, up to HAL_ADC_KNOCK_STREAM_MAX_BLOCK)
+ * @param cb ISR callback for block completion (may be NULL)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on bad parameters,
+ *         ESP_ERR_INVALID_STATE if the stream is already running
+ */
+esp_err_t hal_adc_knock_start_stream(uint32_t rate_hz,
+                                     uint16_t block_len,
+                                     hal_adc_block_ready_cb_t cb);
+
+/**
+ * @brief Stop continuous knock acquisition and release the DMA channel
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not running
+ */
+esp_err_t hal_adc_knock_stop_stream(void);
+
+/**
+ * @brief Take the next completed block of knock samples (non-blocking)
+ *
+ * Call from task context after the block-ready callback has fired.
+ * The returned block stays valid until the next call (double-buffered),
+ * so the caller can process it in place while DMA fills the other half.
+ *
+ * @param samples Receives pointer to raw 12-bit samples
+ * @param count Receives number of samples in the block
+ * @param timestamp_us Receives time the last sample of the block was taken
+ * @return ESP_OK if a block was returned, ESP_ERR_TIMEOUT if none pending
+ */
+esp_err_t hal_adc_knock_get_block(const uint16_t **samples,
+                                  uint16_t *count,
+                                  uint64_t *timestamp_us);
+
+/**
+ * @brief Get number of DMA blocks dropped because the consumer fell behind
+ * @return Overrun count since stream start
+ */
+uint32_t hal_adc_knock_get_overrun_count(void);
+
 // --- Engine Position Sensing ---
 
 /**
  * @brief Get current crank angle position
+ *
+ * Called from the crank ISR: must be ISR-safe and IRAM-resident.
+ *
  * @return Crank angle in degrees (0-719 for 4-stroke cycle)
  */
 uint16_t hal_get_crank_angle(void);
@@ -165,6 +280,10 @@ int16_t hal_get_coolant_temp(void);
 
 /**
  * @brief Set ignition timing adjustment
+ *
+ * Called from the crank ISR by the knock response: must be ISR-safe and
+ * IRAM-resident, and take effect from the next spark event.
+ *
  * @param degrees_btdc Degrees before TDC (-30 to +40)
  * @return ESP_OK on success
  */
@@ -186,20 +305,22 @@ esp_err_t hal_set_fuel_injector_pulse(uint16_t microseconds);
 /**
  * @brief Set fuel trim adjustment
  * @param percent Fuel trim adjustment (-15 to +15)
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED without a fuel actuator
  */
 esp_err_t hal_set_fuel_trim(int8_t percent);
 
 /**
  * @brief Set boost target (turbo/supercharger control)
  * @param kpa Target boost pressure in kPa
- * @return ESP_OK on success
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED without a boost actuator
  */
 esp_err_t hal_set_boost_target(uint16_t kpa);
 
 // --- Bluetooth Low Energy Interface ---
 
 #define HAL_BLE_MTU_SIZE 517  // Maximum Transmission Unit
+#define HAL_BLE_DEFAULT_MTU 23  // ATT MTU before the client exchanges a larger one
+#define HAL_BLE_NOTIFY_OVERHEAD 3  // ATT opcode + attribute handle
 
 typedef struct {
     uint8_t *data;
@@ -207,11 +328,81 @@ typedef struct {
     uint16_t handle;  // GATT characteristic handle
 } hal_ble_data_t;
 
+// High-throughput streaming profile requested on every connection
+#define HAL_BLE_STREAM_CONN_INTERVAL_MIN 6     // 7.5 ms (1.25 ms units)
+#define HAL_BLE_STREAM_CONN_INTERVAL_MAX 12    // 15 ms
+#define HAL_BLE_FALLBACK_CONN_INTERVAL_MAX 24  // 30 ms, retried once if the client rejects
+#define HAL_BLE_STREAM_SUPERVISION_TIMEOUT 400 // 4 s (10 ms units)
+#define HAL_BLE_DEFAULT_LL_OCTETS 27           // LL payload without Data Length Extension
+#define HAL_BLE_MAX_LL_OCTETS 251
+
+/**
+ * @brief Link parameters in effect on the current connection
+ */
+typedef struct {
+    uint16_t conn_interval;        // 1.25 ms units
+    uint16_t latency;              // Connection events the peripheral may skip
+    uint16_t supervision_timeout;  // 10 ms units
+    uint16_t tx_octets;            // LL payload per packet (27..251)
+    uint8_t phy;                   // 1 = LE 1M, 2 = LE 2M
+} hal_ble_link_params_t;
+
+// CartelWorx GATT service. UUIDs are CCCCCCCC-0000-0000-0000-00000000xxCC,
+// 128-bit values, listed least significant byte first as both BLE hosts expect
+#define HAL_BLE_DEVICE_NAME "CartelWorx"
+#define HAL_BLE_UUID128(id) {0xCC, (id), 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+                             0x00, 0x00, 0x00, 0x00, 0xCC, 0xCC, 0xCC, 0xCC}
+#define HAL_BLE_SERVICE_UUID_ID 0xCC
+#define HAL_BLE_CHAR_UUID_ID(chr) (0xC1 + (chr))
+#define HAL_BLE_READ_MAX 512  // Longest attribute value served on a read
+#define HAL_BLE_ADV_INTERVAL_MIN 0x20  // 20 ms (0.625 ms units)
+#define HAL_BLE_ADV_INTERVAL_MAX 0x40  // 40 ms
+
+/**
+ * @brief Characteristics of the CartelWorx service, in UUID order (0xC1..)
+ */
+typedef enum {
+    HAL_BLE_CHAR_STREAM = 0,  // Notify: protocol frames, several per notification
+    HAL_BLE_CHAR_COMMAND,     // Write: commands from the app
+    HAL_BLE_CHAR_LATENCY,     // Read: latency histograms
+    HAL_BLE_CHAR_STATS,       // Read: runtime stats, then the negotiated link parameters
+    HAL_BLE_CHAR_COUNT,
+} hal_ble_char_t;
+
+/**
+ * @brief Application hooks, called from the BLE host task
+ *
+ * Any member may be NULL. They run on the host's own task, so they must not
+ * block for long: set event bits or notify a task and return.
+ */
+typedef struct {
+    void (*on_connect)(void);     // Client connected
+    void (*on_disconnect)(void);  // Client gone; queued notifications are stale
+    void (*on_tx_ready)(void);    // Host TX buffers drained after congestion
+    // Fill out with the current value of a readable characteristic, return its
+    // length. Called once per read: the pages of a long read share that value
+    uint16_t (*on_read)(hal_ble_char_t chr, uint8_t *out, uint16_t capacity);
+    void (*on_write)(hal_ble_char_t chr, const uint8_t *data, uint16_t length);
+} hal_ble_callbacks_t;
+
 /**
  * @brief Initialize Bluetooth LE (GATT Server mode)
+ *
+ * Brings up the controller and the host stack selected at build time
+ * (CONFIG_BT_NIMBLE_ENABLED or CONFIG_BT_BLUEDROID_ENABLED) and registers
+ * the CartelWorx service. NVS must already be initialized.
+ *
+ * @param callbacks Application hooks (copied)
  * @return ESP_OK on success
  */
-esp_err_t hal_ble_init(void);
+esp_err_t hal_ble_init(const hal_ble_callbacks_t *callbacks);
+
+/**
+ * @brief Get the attribute handle of a characteristic's value
+ * @param chr Characteristic
+ * @return Handle, or 0 before the service is registered
+ */
+uint16_t hal_ble_get_char_handle(hal_ble_char_t chr);
 
 /**
  * @brief Start BLE advertising
@@ -231,7 +422,10 @@ esp_err_t hal_ble_stop_advertising(void);
  * @param data Data to send
  * @param length Data length
  * @param is_notification true for notification, false for indication
- * @return ESP_OK on success
+ * @return ESP_OK if queued, ESP_ERR_NO_MEM if the host is congested (retry
+ *         after on_tx_ready, or after about a connection interval since
+ *         NimBLE may free its buffers without calling it),
+ *         ESP_ERR_INVALID_STATE if not connected
  */
 esp_err_t hal_ble_send_notify(uint16_t characteristic_handle,
                                const uint8_t *data,
@@ -244,6 +438,12 @@ esp_err_t hal_ble_send_notify(uint16_t characteristic_handle,
  */
 bool hal_ble_is_connected(void);
 
+/**
+ * @brief Check if the host stack is out of TX buffers
+ * @return true from a refused send until on_tx_ready or the next accepted one
+ */
+bool hal_ble_is_congested(void);
+
 /**
  * @brief Get current BLE MTU (negotiated with client)
  * @return MTU size in bytes
@@ -257,6 +457,13 @@ uint16_t hal_ble_get_mtu(void);
  */
 esp_err_t hal_ble_request_mtu(uint16_t desired_mtu);
 
+/**
+ * @brief Get the negotiated connection interval, data length and PHY
+ * @param out Receives link parameters
+ * @return ESP_OK if connected, ESP_ERR_INVALID_STATE otherwise
+ */
+esp_err_t hal_ble_get_link_params(hal_ble_link_params_t *out);
+
 // --- Interrupt & Event Handling ---
 
 typedef void (*hal_interrupt_handler_t)(void);
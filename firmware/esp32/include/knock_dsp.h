@@ -0,0 +1,107 @@
+#ifndef KNOCK_DSP_H
+#define KNOCK_DSP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Knock Signal Processing (fixed-point)
+//
+// Cascaded biquad band-pass centred on the engine's knock resonance, followed
+// by window energy integration. Samples are converted to Q15 around the
+// window mean, coefficients are Q14 and every section accumulates in 32 bits,
+// which keeps the inner loop to 16x16/32x16 multiplies on the ESP32 LX6.
+// ============================================================================
+
+#define KNOCK_DSP_MAX_SECTIONS 4
+#define KNOCK_DSP_COEFF_SHIFT 14   // Q14 coefficients, range [-2, 2)
+
+/**
+ * @brief Band-pass section coefficients (b1 = 0, b2 = -b0, a0 = 1)
+ */
+typedef struct {
+    int16_t b0;
+    int16_t a1;
+    int16_t a2;
+} knock_biquad_q14_t;
+
+/**
+ * @brief Band-pass filter chain
+ */
+typedef struct {
+    knock_biquad_q14_t sections[KNOCK_DSP_MAX_SECTIONS];
+    uint8_t num_sections;
+    uint32_t sample_rate_hz;
+    uint32_t center_hz;
+} knock_dsp_t;
+
+/**
+ * @brief Result of knock_dsp_benchmark()
+ */
+typedef struct {
+    uint32_t cycles_per_window;  // Average CPU cycles per window
+    uint32_t us_per_window;      // Average time per window
+    uint32_t budget_us;          // One cylinder event at the given RPM
+    uint16_t window_len;
+} knock_dsp_benchmark_t;
+
+/**
+ * @brief Design the band-pass chain
+ *
+ * @param dsp Filter chain
+ * @param sample_rate_hz ADC sample rate
+ * @param center_hz Knock resonance frequency (must be below Nyquist)
+ * @param q_x100 Quality factor per section x100 (e.g. 500 = Q 5.0)
+ * @param num_sections Number of cascaded biquads (1..KNOCK_DSP_MAX_SECTIONS)
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on bad parameters
+ */
+esp_err_t knock_dsp_init(knock_dsp_t *dsp,
+                         uint32_t sample_rate_hz,
+                         uint32_t center_hz,
+                         uint16_t q_x100,
+                         uint8_t num_sections);
+
+/**
+ * @brief Band-pass a window and return its mean energy
+ *
+ * Filter state starts from rest for every window so each cylinder is
+ * scored independently.
+ *
+ * @param dsp Filter chain
+ * @param samples Raw 12-bit ADC samples
+ * @param count Number of samples (up to KNOCK_WINDOW_MAX_SAMPLES)
+ * @return Mean band energy in Q30 (full-scale sine ~ 2^29), 0 if count is 0
+ */
+uint32_t knock_dsp_window_energy(const knock_dsp_t *dsp,
+                                 const uint16_t *samples,
+                                 uint16_t count);
+
+/**
+ * @brief Measure the DSP cost of one window with the CPU cycle counter
+ *
+ * Runs knock_dsp_window_energy() over a synthetic knock waveform.
+ *
+ * @param dsp Filter chain
+ * @param window_len Window length in samples
+ * @param iterations Number of windows to average over
+ * @param redline_rpm RPM used for the per-event budget
+ * @param num_cylinders Cylinder count used for the per-event budget
+ * @param out Receives the measurement
+ */
+void knock_dsp_benchmark(const knock_dsp_t *dsp,
+                         uint16_t window_len,
+                         uint16_t iterations,
+                         uint16_t redline_rpm,
+                         uint8_t num_cylinders,
+                         knock_dsp_benchmark_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KNOCK_DSP_H
@@ -0,0 +1,106 @@
+#ifndef KNOCK_NOISE_FLOOR_H
+#define KNOCK_NOISE_FLOOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "knock_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Adaptive Knock Noise Floor
+//
+// Learned background band energy per cylinder, RPM bin and load bin, kept as
+// an exponentially weighted mean in one flat table. Inputs are clamped to a
+// multiple of the current floor so knock events do not drag the floor up.
+// Each update is a handful of integer ops: no allocation, no search.
+// ============================================================================
+
+#define KNOCK_FLOOR_RPM_BINS 16
+#define KNOCK_FLOOR_RPM_BIN_WIDTH 500    // 0-8000 RPM, top bin open-ended
+#define KNOCK_FLOOR_LOAD_BINS 4
+#define KNOCK_FLOOR_LOAD_BIN_WIDTH 25    // Percent load
+#define KNOCK_FLOOR_ALPHA_SHIFT 4        // EWMA weight 1/16 per window
+#define KNOCK_FLOOR_CLAMP_RATIO 4        // Max learned input, multiple of floor
+#define KNOCK_FLOOR_MIN 64               // Lowest floor (Q30), about 1 ADC LSB RMS
+
+#define KNOCK_SCORE_SHIFT 8              // Score is energy / floor in Q8
+#define KNOCK_SCORE_UNITY (1 << KNOCK_SCORE_SHIFT)
+
+/**
+ * @brief Noise floor table, [cylinder][rpm bin][load bin] in one array
+ *
+ * Levels are mean band energy in Q30 (knock_dsp_window_energy()); 0 means
+ * the cell has not been learned yet, otherwise at least KNOCK_FLOOR_MIN.
+ */
+typedef struct {
+    uint32_t level[KNOCK_MAX_CYLINDERS * KNOCK_FLOOR_RPM_BINS * KNOCK_FLOOR_LOAD_BINS];
+} knock_noise_floor_t;
+
+/**
+ * @brief Clear all learned levels
+ * @param nf Noise floor table
+ */
+void knock_noise_floor_init(knock_noise_floor_t *nf);
+
+/**
+ * @brief Get table index for a cylinder / operating point
+ *
+ * @param cyl_index Cylinder index (0-based)
+ * @param rpm Engine speed
+ * @param load_pct Engine load in percent
+ * @return Index into nf->level
+ */
+static inline uint32_t knock_noise_floor_cell(uint8_t cyl_index, uint16_t rpm, uint8_t load_pct) {
+    uint32_t rpm_bin = rpm / KNOCK_FLOOR_RPM_BIN_WIDTH;
+    uint32_t load_bin = load_pct / KNOCK_FLOOR_LOAD_BIN_WIDTH;
+    if (rpm_bin >= KNOCK_FLOOR_RPM_BINS) {
+        rpm_bin = KNOCK_FLOOR_RPM_BINS - 1;
+    }
+    if (load_bin >= KNOCK_FLOOR_LOAD_BINS) {
+        load_bin = KNOCK_FLOOR_LOAD_BINS - 1;
+    }
+    return ((uint32_t)cyl_index * KNOCK_FLOOR_RPM_BINS + rpm_bin) * KNOCK_FLOOR_LOAD_BINS + load_bin;
+}
+
+/**
+ * @brief Get the learned floor for a cylinder / operating point
+ *
+ * @param nf Noise floor table
+ * @param cyl_index Cylinder index (0-based, < KNOCK_MAX_CYLINDERS)
+ * @param rpm Engine speed
+ * @param load_pct Engine load in percent
+ * @return Floor in Q30, 0 if not learned
+ */
+static inline uint32_t knock_noise_floor_get(const knock_noise_floor_t *nf,
+                                             uint8_t cyl_index,
+                                             uint16_t rpm,
+                                             uint8_t load_pct) {
+    return nf->level[knock_noise_floor_cell(cyl_index, rpm, load_pct)];
+}
+
+/**
+ * @brief Score a window against its floor, then learn from it
+ *
+ * @param nf Noise floor table
+ * @param cyl_index Cylinder index (0-based, < KNOCK_MAX_CYLINDERS)
+ * @param rpm Engine speed
+ * @param load_pct Engine load in percent
+ * @param energy Window band energy (Q30)
+ * @return Knock score, energy / floor in Q8 (KNOCK_SCORE_UNITY = at floor),
+ *         0 while the cell is still unlearned (including windows below
+ *         KNOCK_FLOOR_MIN, which do not seed it)
+ */
+uint16_t knock_noise_floor_update(knock_noise_floor_t *nf,
+                                  uint8_t cyl_index,
+                                  uint16_t rpm,
+                                  uint8_t load_pct,
+                                  uint32_t energy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KNOCK_NOISE_FLOOR_H
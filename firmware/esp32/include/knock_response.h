@@ -0,0 +1,112 @@
+#ifndef KNOCK_RESPONSE_H
+#define KNOCK_RESPONSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "knock_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Per-Cylinder Knock Response (Ignition Retard)
+//
+// The knock task marks a cylinder's retard as soon as its window scores
+// above threshold. The crank ISR applies each cylinder's timing (base
+// minus retard, clamped to the HAL safety limits) at the TDC before that
+// cylinder fires, so a knock is acted on at the very next firing of the
+// cylinder that knocked, without a task switch on the actuation side.
+// Retard is restored a degree at a time after a run of clean windows.
+//
+// Single writer per field: the task owns retard/clean counts and the
+// detection stats, the ISR owns the applied timing and actuation stats.
+// ============================================================================
+
+#define KNOCK_RETARD_STEP_DEG 2          // Added per knocking window
+#define KNOCK_RETARD_MAX_DEG 10          // Per-cylinder ceiling
+#define KNOCK_RECOVER_WINDOWS 32         // Clean windows per degree restored
+
+/**
+ * @brief End-to-end latency, measured from the knocking window's close
+ */
+typedef struct {
+    uint32_t knock_events;          // Windows that added retard
+    uint32_t detect_latency_max_us; // Window close -> score available (task)
+    uint32_t applied_events;        // Retards applied at a firing (ISR)
+    uint32_t apply_latency_us;      // Window close -> timing written, last event
+    uint32_t apply_latency_max_us;
+} knock_response_stats_t;
+
+/**
+ * @brief Response state
+ */
+typedef struct {
+    int16_t base_timing;                          // Degrees BTDC before knock retard
+    int8_t retard[KNOCK_MAX_CYLINDERS];           // By cylinder - 1 (task writes)
+    uint16_t clean_windows[KNOCK_MAX_CYLINDERS];  // Task only
+    uint32_t pending_us[KNOCK_MAX_CYLINDERS];     // Close time of an unapplied knock, 0 = none
+    int16_t applied_timing;                       // Last value written (ISR only)
+    knock_response_stats_t stats;
+} knock_response_t;
+
+/**
+ * @brief Initialize with no retard
+ *
+ * @param kr Response state
+ * @param base_timing Degrees BTDC to run without knock
+ */
+void knock_response_init(knock_response_t *kr, int16_t base_timing);
+
+/**
+ * @brief Set the timing retard is subtracted from (e.g. from the tuning map)
+ *
+ * Forced inline: called from the crank ISR, which must not reach flash.
+ *
+ * @param kr Response state
+ * @param base_timing Degrees BTDC
+ */
+static inline __attribute__((always_inline)) void knock_response_set_base(knock_response_t *kr, int16_t base_timing) {
+    __atomic_store_n(&kr->base_timing, base_timing, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Record a completed window (knock task)
+ *
+ * @param kr Response state
+ * @param cyl_index Cylinder index (0-based)
+ * @param knock Window scored above threshold
+ * @param close_us Window close time
+ * @param now_us Time the score became available
+ */
+void knock_response_on_window(knock_response_t *kr,
+                              uint8_t cyl_index,
+                              bool knock,
+                              uint64_t close_us,
+                              uint64_t now_us);
+
+/**
+ * @brief Apply timing for the cylinder about to fire (crank ISR, IRAM)
+ *
+ * @param kr Response state
+ * @param cyl_index Cylinder index (0-based) of the next firing
+ * @param now_us Current time
+ */
+void knock_response_before_firing(knock_response_t *kr, uint8_t cyl_index, uint64_t now_us);
+
+/**
+ * @brief Current retard of one cylinder
+ *
+ * @param kr Response state
+ * @param cyl_index Cylinder index (0-based)
+ * @return Degrees of retard
+ */
+static inline int8_t knock_response_get_retard(const knock_response_t *kr, uint8_t cyl_index) {
+    return __atomic_load_n(&kr->retard[cyl_index], __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KNOCK_RESPONSE_H
@@ -0,0 +1,156 @@
+#ifndef KNOCK_WINDOW_H
+#define KNOCK_WINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Crank-Angle Gated Knock Windows
+//
+// The crank ISR feeds every tooth edge to the scheduler. When a cylinder's
+// firing TDC is crossed, its knock window (e.g. 10-70 deg ATDC) is converted
+// into absolute open/close timestamps using the measured tooth period. The
+// knock task then keeps only the DMA samples that fall inside a window;
+// everything else is discarded before it reaches the DSP chain.
+// ============================================================================
+
+#define KNOCK_MAX_CYLINDERS 8
+#define KNOCK_WINDOW_MAX_SAMPLES 512   // Longest window kept (512-sample buffer)
+#define KNOCK_CYCLE_DEGREES 720        // 4-stroke engine cycle
+
+/**
+ * @brief Knock window for one firing event, in firing order
+ */
+typedef struct {
+    uint8_t cylinder;      // Cylinder number (1-based, as printed on the engine)
+    uint16_t tdc_angle;    // Crank angle of firing TDC (0-719)
+    uint8_t start_atdc;    // Window open, degrees after TDC
+    uint8_t end_atdc;      // Window close, degrees after TDC
+} knock_window_cyl_t;
+
+/**
+ * @brief Scheduler configuration
+ *
+ * events[] must be sorted by ascending tdc_angle.
+ */
+typedef struct {
+    uint8_t num_cylinders;
+    knock_window_cyl_t events[KNOCK_MAX_CYLINDERS];
+} knock_window_config_t;
+
+/**
+ * @brief Scheduled window in absolute time (hal_get_time_us base)
+ */
+typedef struct {
+    uint64_t open_us;
+    uint64_t close_us;
+    uint32_t stroke_us;    // Previous TDC to this one, 0 if unknown
+    uint16_t rpm;          // Engine speed measured at TDC
+    uint8_t cylinder;
+    uint8_t stroke_cylinder; // Cylinder whose power stroke stroke_us spans
+} knock_window_t;
+
+/**
+ * @brief Scheduler state, updated from the crank ISR only
+ */
+typedef struct {
+    knock_window_config_t config;
+    uint64_t prev_edge_us;
+    uint64_t prev_tdc_us;  // Interpolated time of the last TDC crossed, 0 = none
+    uint16_t prev_angle;
+    uint8_t next_event;    // Index into config.events of the next TDC
+    bool primed;           // At least one edge seen
+} knock_window_scheduler_t;
+
+/**
+ * @brief Sample buffer for the window currently being collected
+ */
+typedef struct {
+    knock_window_t window;
+    uint16_t samples[KNOCK_WINDOW_MAX_SAMPLES];
+    uint16_t count;
+    bool armed;
+} knock_window_buffer_t;
+
+/**
+ * @brief Initialize the scheduler
+ *
+ * @param sched Scheduler state
+ * @param config Per-cylinder window configuration
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if config is invalid
+ */
+esp_err_t knock_window_scheduler_init(knock_window_scheduler_t *sched,
+                                      const knock_window_config_t *config);
+
+/**
+ * @brief Feed a crank tooth edge (ISR context, IRAM)
+ *
+ * @param sched Scheduler state
+ * @param crank_angle Crank angle at the edge (0-719)
+ * @param now_us Edge timestamp
+ * @param out Receives the window to collect when a TDC was crossed
+ * @return true if out was filled
+ */
+bool knock_window_on_crank_edge(knock_window_scheduler_t *sched,
+                                uint16_t crank_angle,
+                                uint64_t now_us,
+                                knock_window_t *out);
+
+/**
+ * @brief Cylinder whose firing TDC comes next (ISR context)
+ *
+ * Right after knock_window_on_crank_edge() returns true this is the
+ * cylinder that fires after the one whose window was just scheduled.
+ *
+ * @param sched Scheduler state
+ * @return Cylinder number (1-based)
+ */
+static inline __attribute__((always_inline)) uint8_t knock_window_next_cylinder(const knock_window_scheduler_t *sched) {
+    return sched->config.events[sched->next_event].cylinder;
+}
+
+/**
+ * @brief Start collecting a scheduled window
+ *
+ * @param wb Window buffer
+ * @param window Window from knock_window_on_crank_edge
+ */
+static inline void knock_window_arm(knock_window_buffer_t *wb, const knock_window_t *window) {
+    wb->window = *window;
+    wb->count = 0;
+    wb->armed = true;
+}
+
+/**
+ * @brief Copy the in-window part of a DMA block into the window buffer
+ *
+ * Samples before the window are skipped, samples after it are left for the
+ * next window. When complete is set, wb holds the whole window.
+ *
+ * @param wb Armed window buffer
+ * @param block DMA block samples
+ * @param from First block index not yet claimed by an earlier window
+ * @param count Samples in the block
+ * @param block_end_us Timestamp of the last sample in the block
+ * @param sample_period_ns Sample spacing in nanoseconds
+ * @param complete Set true once the window close time has passed
+ * @return Block index just past the samples consumed by this window
+ */
+uint16_t knock_window_collect(knock_window_buffer_t *wb,
+                              const uint16_t *block,
+                              uint16_t from,
+                              uint16_t count,
+                              uint64_t block_end_us,
+                              uint32_t sample_period_ns,
+                              bool *complete);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KNOCK_WINDOW_H
@@ -0,0 +1,84 @@
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Hot-Path Latency Trace
+//
+// One log2 histogram per pipeline stage and per core: bucket b counts
+// latencies in [2^b, 2^(b+1)) us, bucket 0 also takes 0-1 us and the last
+// bucket is open-ended. Each core only touches its own counters, and
+// increments are atomic so an ISR may preempt a task recording the same
+// stage. Recording is a clz, an add and a compare: safe from ISRs (IRAM).
+// ============================================================================
+
+#define LATENCY_TRACE_BUCKETS 16        // Up to 32 ms resolved, beyond in the last bucket
+#define LATENCY_TRACE_CORES 2
+#define LATENCY_TRACE_FORMAT_VERSION 1
+
+typedef enum {
+    LATENCY_STAGE_KNOCK_SCORE = 0,   // ADC block ready -> knock score
+    LATENCY_STAGE_CAN_RESPONSE,      // OBD request sent -> response reassembled
+    LATENCY_STAGE_BLE_NOTIFY,        // TX frame committed -> notification sent (oldest frame of the packet)
+    LATENCY_STAGE_KNOCK_RETARD,      // Knocking window closed -> ignition timing written
+    LATENCY_STAGE_TUNING_COMMAND,    // BLE command written -> applied
+    LATENCY_STAGE_COUNT,
+} latency_stage_t;
+
+/**
+ * @brief One stage, merged across cores
+ */
+typedef struct {
+    uint32_t buckets[LATENCY_TRACE_BUCKETS];
+    uint32_t max_us;
+} latency_histogram_t;
+
+/**
+ * @brief Record one latency sample (any context, IRAM)
+ *
+ * @param stage Pipeline stage
+ * @param latency_us Measured latency
+ */
+void latency_trace_record(latency_stage_t stage, uint32_t latency_us);
+
+/**
+ * @brief Sum a stage's histograms across cores
+ *
+ * @param stage Pipeline stage
+ * @param out Receives merged histogram
+ */
+void latency_trace_get(latency_stage_t stage, latency_histogram_t *out);
+
+/**
+ * @brief Clear all histograms
+ */
+void latency_trace_reset(void);
+
+/**
+ * @brief Serialize all stages for the BLE diagnostic characteristic
+ *
+ * Layout: u8 version, u8 stage count, u8 bucket count, then per stage
+ * u32 max_us and u32 buckets[], all little-endian.
+ *
+ * @param out Destination
+ * @param capacity Destination size
+ * @return Bytes written, 0 if capacity is too small
+ */
+uint16_t latency_trace_serialize(uint8_t *out, uint16_t capacity);
+
+/**
+ * @brief Size of the serialized form
+ */
+#define LATENCY_TRACE_SERIALIZED_SIZE (3 + LATENCY_STAGE_COUNT * 4 * (1 + LATENCY_TRACE_BUCKETS))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_TRACE_H
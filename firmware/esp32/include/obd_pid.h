@@ -0,0 +1,141 @@
+#ifndef OBD_PID_H
+#define OBD_PID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// OBD-II Mode 01 over ISO 15765-4 (ISO-TP on CAN)
+//
+// A single request frame may carry up to six PIDs. The ECU answers with one
+// response listing each PID followed by its data bytes, which for more than
+// a few PIDs spans an ISO-TP first frame plus consecutive frames. This module
+// builds batched requests, reassembles ISO-TP replies per ECU, and splits a
+// reply back into per-PID values.
+// ============================================================================
+
+#define OBD_FUNCTIONAL_REQUEST_ID 0x7DF   // Broadcast to all ECUs
+#define OBD_PHYSICAL_REQUEST_BASE 0x7E0   // ECU n listens on 0x7E0 + n
+#define OBD_RESPONSE_ID_BASE 0x7E8        // ECU n responds on 0x7E8 + n
+#define OBD_RESPONSE_ID_MASK 0x7F8
+#define OBD_NUM_ECUS 8
+
+#define OBD_MODE_CURRENT_DATA 0x01
+#define OBD_POSITIVE_RESPONSE_OFFSET 0x40
+#define OBD_NEGATIVE_RESPONSE 0x7F
+#define OBD_MAX_PIDS_PER_REQUEST 6
+#define OBD_PID_MAX_DATA 4
+#define OBD_ISOTP_MAX_PAYLOAD 64          // Six 4-byte PIDs need 31 bytes
+
+/**
+ * @brief ISO-TP reassembly state for one ECU
+ */
+typedef struct {
+    uint8_t buffer[OBD_ISOTP_MAX_PAYLOAD];
+    uint16_t expected;     // Total payload length announced by the ECU
+    uint16_t received;     // Bytes reassembled so far
+    uint8_t next_seq;      // Expected consecutive frame sequence number
+    bool active;           // Multi-frame transfer in progress
+} obd_isotp_rx_t;
+
+typedef enum {
+    OBD_ISOTP_INCOMPLETE = 0,      // More frames needed
+    OBD_ISOTP_COMPLETE,            // rx->buffer holds rx->expected bytes
+    OBD_ISOTP_NEED_FLOW_CONTROL,   // First frame seen: send obd_build_flow_control()
+    OBD_ISOTP_ERROR,               // Malformed or out-of-sequence frame, transfer dropped
+} obd_isotp_result_t;
+
+/**
+ * @brief One PID value demultiplexed from a Mode 01 response
+ */
+typedef struct {
+    uint8_t pid;
+    uint8_t len;
+    uint8_t data[OBD_PID_MAX_DATA];
+} obd_pid_value_t;
+
+/**
+ * @brief Build a single-frame Mode 01 request for up to six PIDs
+ *
+ * @param pids PID numbers (without mode byte)
+ * @param count Number of PIDs (1..OBD_MAX_PIDS_PER_REQUEST)
+ * @param out Receives the padded CAN frame on OBD_FUNCTIONAL_REQUEST_ID
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on bad count
+ */
+esp_err_t obd_build_mode01_request(const uint8_t *pids, uint8_t count, hal_can_frame_t *out);
+
+/**
+ * @brief Build the ISO-TP flow control frame (continue, no block limit, no STmin)
+ *
+ * @param response_id CAN ID the first frame arrived on
+ * @param out Receives the frame, addressed to the responding ECU
+ */
+void obd_build_flow_control(uint32_t response_id, hal_can_frame_t *out);
+
+/**
+ * @brief Reset ISO-TP reassembly state
+ * @param rx Reassembly state
+ */
+static inline void obd_isotp_reset(obd_isotp_rx_t *rx) {
+    rx->expected = 0;
+    rx->received = 0;
+    rx->next_seq = 0;
+    rx->active = false;
+}
+
+/**
+ * @brief Feed one CAN frame from an ECU into its reassembly state
+ *
+ * @param rx Reassembly state for the frame's ECU
+ * @param frame Received frame
+ * @return Reassembly result
+ */
+obd_isotp_result_t obd_isotp_feed(obd_isotp_rx_t *rx, const hal_can_frame_t *frame);
+
+/**
+ * @brief Get data length of a Mode 01 PID
+ * @param pid PID number
+ * @return Data bytes, 0 if the PID is unknown
+ */
+uint8_t obd_pid_data_length(uint8_t pid);
+
+/**
+ * @brief Split a reassembled Mode 01 response into per-PID values
+ *
+ * Parsing stops at the first unknown PID, since its length (and so the
+ * position of the next PID) cannot be known.
+ *
+ * @param payload ISO-TP payload, starting with the response mode byte
+ * @param len Payload length
+ * @param values Array to receive values
+ * @param max_values Capacity of values
+ * @return Number of values parsed, 0 for negative or non-Mode 01 responses
+ */
+uint8_t obd_parse_mode01_response(const uint8_t *payload,
+                                  uint16_t len,
+                                  obd_pid_value_t *values,
+                                  uint8_t max_values);
+
+/**
+ * @brief Convert a PID value to engineering units (SAE J1979 scaling)
+ *
+ * RPM in rev/min, temperatures in deg C, pressure in kPa, timing in deg
+ * BTDC, O2 sensor in volts, throttle/load in percent. Unknown PIDs return
+ * the raw big-endian value.
+ *
+ * @param value PID value
+ * @return Scaled value
+ */
+float obd_pid_decode(const obd_pid_value_t *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OBD_PID_H
@@ -0,0 +1,156 @@
+#ifndef PID_SCHEDULER_H
+#define PID_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+#include "obd_pid.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Priority-Weighted Adaptive OBD-II PID Scheduler
+//
+// Each PID has a target rate and a priority. Requests are issued one at a
+// time (ECUs answer a single outstanding request), so the achievable rate is
+// bounded by the ECU's response latency. The scheduler batches up to six due
+// PIDs per request, highest priority and most overdue first, tops the batch
+// up with PIDs that would fall due before the response is back, and issues
+// the next request as soon as a response arrives rather than on a timer.
+//
+// Requests are broadcast, so several ECUs may answer. The first ECU to reply
+// becomes the responder: its replies end a request, and a PID it leaves out
+// (ECUs omit unsupported PIDs from multi-PID replies) counts as a timeout.
+// Replies from other ECUs are not scheduled against; a timeout clears the
+// responder so another ECU can take over.
+// ============================================================================
+
+#define PID_SCHED_MAX_ENTRIES 16
+#define PID_SCHED_RESPONSE_TIMEOUT_US 50000   // ISO 15765-4 P2 max
+#define PID_SCHED_LATENCY_SHIFT 3             // Latency EWMA weight 1/8
+#define PID_SCHED_RATE_WINDOW_US 1000000      // Achieved-rate measurement window
+#define PID_SCHED_NO_RESPONDER 0xFF
+
+/**
+ * @brief Requested polling for one PID
+ */
+typedef struct {
+    uint8_t pid;
+    uint8_t priority;      // Higher is served first when PIDs compete
+    uint16_t target_hz;    // Requested refresh rate (1..1000)
+} pid_sched_config_t;
+
+/**
+ * @brief Per-PID state
+ */
+typedef struct {
+    pid_sched_config_t config;
+    uint32_t period_us;
+    uint64_t next_due_us;
+    uint32_t window_responses;   // Responses in the current rate window
+    uint16_t achieved_hz_x10;    // Rate measured over the last window
+    uint32_t timeouts;
+    bool in_flight;
+} pid_sched_entry_t;
+
+/**
+ * @brief Achieved vs. requested rate for one PID
+ */
+typedef struct {
+    uint8_t pid;
+    uint8_t priority;
+    uint16_t target_hz;
+    uint16_t achieved_hz_x10;
+    uint32_t timeouts;
+} pid_sched_stats_t;
+
+/**
+ * @brief Scheduler state
+ *
+ * Not thread-safe: the sender and receiver tasks must serialize access.
+ */
+typedef struct {
+    pid_sched_entry_t entries[PID_SCHED_MAX_ENTRIES];
+    uint8_t count;
+    bool awaiting_response;
+    uint8_t responder;            // ECU whose replies end a request, PID_SCHED_NO_RESPONDER if none yet
+    uint64_t request_sent_us;
+    uint32_t latency_us;          // EWMA of request -> response time
+    uint64_t rate_window_start_us;
+} pid_scheduler_t;
+
+/**
+ * @brief Initialize the scheduler
+ *
+ * @param sched Scheduler state
+ * @param configs Per-PID targets
+ * @param count Number of PIDs (max PID_SCHED_MAX_ENTRIES)
+ * @param now_us Current time
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG on bad config
+ */
+esp_err_t pid_scheduler_init(pid_scheduler_t *sched,
+                             const pid_sched_config_t *configs,
+                             uint8_t count,
+                             uint64_t now_us);
+
+/**
+ * @brief Pick the PIDs for the next request
+ *
+ * Returns 0 while a request is outstanding (until its response or timeout)
+ * or when nothing is due. A non-zero result marks the request as sent.
+ *
+ * @param sched Scheduler state
+ * @param now_us Current time
+ * @param pids Receives PID numbers
+ * @param max_pids Capacity of pids (up to OBD_MAX_PIDS_PER_REQUEST)
+ * @return Number of PIDs selected
+ */
+uint8_t pid_scheduler_next_batch(pid_scheduler_t *sched,
+                                 uint64_t now_us,
+                                 uint8_t *pids,
+                                 uint8_t max_pids);
+
+/**
+ * @brief Time the sender should next wake up if no response arrives
+ *
+ * @param sched Scheduler state
+ * @return Response deadline while awaiting, else the earliest due time
+ */
+uint64_t pid_scheduler_next_event_us(const pid_scheduler_t *sched);
+
+/**
+ * @brief Record a response and release the request slot
+ *
+ * Only a reply from the responder to the outstanding request counts; PIDs
+ * it did not return are charged a timeout.
+ *
+ * @param sched Scheduler state
+ * @param now_us Time the response completed
+ * @param ecu Responding ECU (response ID - OBD_RESPONSE_ID_BASE)
+ * @param values PID values from obd_parse_mode01_response()
+ * @param count Number of values
+ * @return true if this reply ended the outstanding request
+ */
+bool pid_scheduler_on_response(pid_scheduler_t *sched,
+                               uint64_t now_us,
+                               uint8_t ecu,
+                               const obd_pid_value_t *values,
+                               uint8_t count);
+
+/**
+ * @brief Get achieved vs. requested rate for one PID
+ *
+ * @param sched Scheduler state
+ * @param index Entry index (0..count-1)
+ * @param out Receives stats
+ * @return true if index valid
+ */
+bool pid_scheduler_get_stats(const pid_scheduler_t *sched, uint8_t index, pid_sched_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PID_SCHEDULER_H
@@ -5,12 +5,19 @@
 #include <string.h>
 #include <stdbool.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Ring Buffer (Circular Buffer) Template-like Implementation for C
  * 
  * Fixed-size ring buffer optimized for real-time embedded systems.
  * O(1) insertion and removal. No dynamic allocation after initialization.
  * Thread-safe when used with proper synchronization (mutexes/semaphores).
+ *
+ * For a single producer and single consumer (e.g. ISR -> task, or core 0 ->
+ * core 1) use ring_buffer_spsc_t instead: it needs no lock on either side.
  */
 
 /**
@@ -206,4 +213,209 @@ const void *ring_buffer_get_read_region(const ring_buffer_t *rb, uint32_t *out_s
  */
 bool ring_buffer_advance_read(ring_buffer_t *rb, uint32_t bytes_read);
 
+// ============================================================================
+// Lock-free single-producer / single-consumer variant
+//
+// head is written only by the producer and tail only by the consumer, so
+// neither side ever writes state the other side writes. The element copy is
+// published with a release store of the index and observed with an acquire
+// load, which is enough ordering across both ESP32 cores. One slot is kept
+// free to tell full from empty. Safe to push from ISR context.
+// ============================================================================
+
+/**
+ * @brief SPSC ring buffer structure
+ */
+typedef struct {
+    uint8_t *buffer;       // Data buffer
+    uint32_t capacity;     // Number of slots (capacity - 1 usable)
+    uint32_t element_size; // Size of each element in bytes
+    uint32_t head;         // Next slot to write (producer only)
+    uint32_t tail;         // Next slot to read (consumer only)
+    uint32_t overflows;    // Pushes rejected because full (producer only)
+} ring_buffer_spsc_t;
+
+/**
+ * @brief Initialize an SPSC ring buffer
+ * 
+ * @param rb Ring buffer structure
+ * @param buffer Pre-allocated buffer memory
+ * @param buffer_size Total size in bytes (divided into element_size slots)
+ * @param element_size Size of each element stored
+ * @return true on success, false if parameters invalid
+ */
+static inline bool ring_buffer_spsc_init(ring_buffer_spsc_t *rb,
+                                         uint8_t *buffer,
+                                         uint32_t buffer_size,
+                                         uint32_t element_size) {
+    if (rb == NULL || buffer == NULL || element_size == 0 ||
+        buffer_size / element_size < 2) {
+        return false;
+    }
+    rb->buffer = buffer;
+    rb->capacity = buffer_size / element_size;
+    rb->element_size = element_size;
+    rb->head = 0;
+    rb->tail = 0;
+    rb->overflows = 0;
+    return true;
+}
+
+/**
+ * @brief Push an element (producer side, ISR-safe)
+ * 
+ * Unlike ring_buffer_push(), never overwrites: the oldest element belongs
+ * to the consumer until it advances tail. Forced inline, like the other
+ * ISR-side calls: an outlined copy would be placed in flash and stall the
+ * ISR whenever the cache is disabled.
+ * 
+ * @param rb Ring buffer
+ * @param element Pointer to element data
+ * @return true if pushed, false if buffer full (counted in overflows)
+ */
+static inline __attribute__((always_inline)) bool ring_buffer_spsc_push(ring_buffer_spsc_t *rb, const void *element) {
+    const uint32_t head = __atomic_load_n(&rb->head, __ATOMIC_RELAXED);
+    uint32_t next = head + 1;
+    if (next == rb->capacity) {
+        next = 0;
+    }
+    if (next == __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE)) {
+        rb->overflows++;
+        return false;
+    }
+    memcpy(rb->buffer + head * rb->element_size, element, rb->element_size);
+    __atomic_store_n(&rb->head, next, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Pop an element (consumer side)
+ * 
+ * @param rb Ring buffer
+ * @param element Pointer to receive popped element
+ * @return true if element was popped, false if buffer empty
+ */
+static inline __attribute__((always_inline)) bool ring_buffer_spsc_pop(ring_buffer_spsc_t *rb, void *element) {
+    const uint32_t tail = __atomic_load_n(&rb->tail, __ATOMIC_RELAXED);
+    if (tail == __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    memcpy(element, rb->buffer + tail * rb->element_size, rb->element_size);
+    uint32_t next = tail + 1;
+    if (next == rb->capacity) {
+        next = 0;
+    }
+    __atomic_store_n(&rb->tail, next, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Get number of elements pending (either side, snapshot)
+ * 
+ * @param rb Ring buffer
+ * @return Number of elements
+ */
+static inline uint32_t ring_buffer_spsc_count(const ring_buffer_spsc_t *rb) {
+    const uint32_t head = __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE);
+    const uint32_t tail = __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE);
+    return (head >= tail) ? head - tail : head + rb->capacity - tail;
+}
+
+/**
+ * @brief Check if buffer is empty (either side, snapshot)
+ * 
+ * @param rb Ring buffer
+ * @return true if empty
+ */
+static inline bool ring_buffer_spsc_is_empty(const ring_buffer_spsc_t *rb) {
+    return __atomic_load_n(&rb->head, __ATOMIC_ACQUIRE) ==
+           __atomic_load_n(&rb->tail, __ATOMIC_ACQUIRE);
+}
+
+#ifdef __cplusplus
+}
+
+#include <type_traits>
+
+/**
+ * @brief Compile-time typed SPSC ring buffer for C++ callers
+ *
+ * Same producer/consumer contract as ring_buffer_spsc_t, but capacity and
+ * element type are template parameters: indices are free-running and
+ * wrapped with a mask, and elements are copied by assignment, so a push of
+ * a uint16_t sample or hal_can_frame_t compiles to a few loads and stores.
+ * All N slots are usable.
+ *
+ * @tparam T Trivially copyable element type
+ * @tparam N Capacity, must be a power of 2
+ */
+template <typename T, uint32_t N>
+class RingBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of 2");
+    static_assert(std::is_trivially_copyable<T>::value, "RingBuffer element must be trivially copyable");
+
+public:
+    static constexpr uint32_t kMask = N - 1;
+
+    /**
+     * @brief Push an element (producer side, ISR-safe)
+     * @return true if pushed, false if full (counted in overflows())
+     */
+    __attribute__((always_inline)) bool push(const T &element) {
+        const uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        if (head - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE) == N) {
+            overflows_++;
+            return false;
+        }
+        slots_[head & kMask] = element;
+        __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * @brief Pop an element (consumer side)
+     * @return true if element was popped, false if empty
+     */
+    __attribute__((always_inline)) bool pop(T &element) {
+        const uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        if (tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        element = slots_[tail & kMask];
+        __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /**
+     * @brief Peek at the front element without removing it (consumer side)
+     * @return Pointer to the front element, nullptr if empty
+     */
+    const T *peek() const {
+        const uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        if (tail == __atomic_load_n(&head_, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+        return &slots_[tail & kMask];
+    }
+
+    /**
+     * @brief Number of elements pending (snapshot)
+     */
+    uint32_t count() const {
+        return __atomic_load_n(&head_, __ATOMIC_ACQUIRE) - __atomic_load_n(&tail_, __ATOMIC_ACQUIRE);
+    }
+
+    bool is_empty() const { return count() == 0; }
+    bool is_full() const { return count() == N; }
+    uint32_t overflows() const { return overflows_; }
+    static constexpr uint32_t capacity() { return N; }
+
+private:
+    T slots_[N];
+    uint32_t head_ = 0;       // Producer only, free-running
+    uint32_t tail_ = 0;       // Consumer only, free-running
+    uint32_t overflows_ = 0;  // Producer only
+};
+#endif // __cplusplus
+
 #endif // RING_BUFFER_H
@@ -0,0 +1,101 @@
+#ifndef RTOS_ARENA_H
+#define RTOS_ARENA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Static RTOS Object Arena
+//
+// Every application task, mutex and event group is carved at startup from one
+// compile-time-sized arena through the FreeRTOS ...Static APIs: TCBs, stacks
+// and control blocks are in .bss, so they cost no heap, cannot fragment it
+// across BLE reconnects, and boot does the same work every time. Exhaustion
+// is a configuration error caught at startup, not a runtime heap failure.
+//
+// Not thread-safe: allocate from app_main before the tasks start sharing.
+// ============================================================================
+
+#ifndef RTOS_ARENA_MAX_TASKS
+#define RTOS_ARENA_MAX_TASKS 8
+#endif
+#ifndef RTOS_ARENA_STACK_BYTES
+#define RTOS_ARENA_STACK_BYTES 22528    // Sum of all application task stacks
+#endif
+#ifndef RTOS_ARENA_MAX_SEMAPHORES
+#define RTOS_ARENA_MAX_SEMAPHORES 4
+#endif
+#ifndef RTOS_ARENA_MAX_EVENT_GROUPS
+#define RTOS_ARENA_MAX_EVENT_GROUPS 2
+#endif
+#define RTOS_ARENA_STACK_ALIGN 16
+
+/**
+ * @brief Arena usage
+ */
+typedef struct {
+    uint8_t tasks;
+    uint8_t semaphores;
+    uint8_t event_groups;
+    uint32_t stack_used;        // Bytes of the stack arena handed out
+    uint32_t footprint;         // Total static bytes reserved by the arena
+} rtos_arena_usage_t;
+
+/**
+ * @brief Create a pinned task with its TCB and stack from the arena
+ *
+ * @param fn Task function
+ * @param name Task name
+ * @param stack_bytes Stack size in bytes (rounded up to RTOS_ARENA_STACK_ALIGN)
+ * @param arg Task argument
+ * @param priority Priority
+ * @param core Core to pin to
+ * @return Task handle, NULL if the arena is exhausted
+ */
+TaskHandle_t rtos_arena_create_task(TaskFunction_t fn,
+                                    const char *name,
+                                    uint32_t stack_bytes,
+                                    void *arg,
+                                    UBaseType_t priority,
+                                    BaseType_t core);
+
+/**
+ * @brief Create a mutex from the arena
+ * @return Mutex handle, NULL if the arena is exhausted
+ */
+SemaphoreHandle_t rtos_arena_create_mutex(void);
+
+/**
+ * @brief Create an event group from the arena
+ * @return Event group handle, NULL if the arena is exhausted
+ */
+EventGroupHandle_t rtos_arena_create_event_group(void);
+
+/**
+ * @brief Get arena usage
+ * @param out Receives usage
+ */
+void rtos_arena_get_usage(rtos_arena_usage_t *out);
+
+/**
+ * @brief Log the static footprint at startup
+ *
+ * Arena usage plus the application's other static buffers.
+ *
+ * @param app_static_bytes Bytes of static buffers owned by the application
+ */
+void rtos_arena_report(uint32_t app_static_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RTOS_ARENA_H
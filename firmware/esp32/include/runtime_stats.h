@@ -0,0 +1,105 @@
+#ifndef RUNTIME_STATS_H
+#define RUNTIME_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Runtime Resource Telemetry
+//
+// Periodic snapshot of per-task CPU share (FreeRTOS run-time counters,
+// as a delta since the previous snapshot), stack high-water marks, per-core
+// idle time, heap low-water mark, and the drop/overflow counters of the
+// pipeline's queues and rings. Used to size stacks and priorities from
+// data instead of guesses.
+// ============================================================================
+
+#define RUNTIME_STATS_MAX_TASKS 16
+#define RUNTIME_STATS_CORES 2
+#define RUNTIME_STATS_FORMAT_VERSION 2
+
+/**
+ * @brief One task
+ */
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint8_t core;              // 0/1, RUNTIME_STATS_CORES if unpinned
+    uint8_t priority;
+    uint16_t cpu_permille;     // Share of one core since the previous snapshot
+    uint32_t stack_free_min;   // Bytes of stack never used
+} runtime_task_stats_t;
+
+/**
+ * @brief Queue depths and drop counters, filled in by the application
+ */
+typedef struct {
+    uint32_t knock_window_depth;      // Windows waiting for the knock task
+    uint32_t ble_tx_bytes;            // Bytes queued in the BLE TX stream
+    uint32_t knock_window_overflows;  // Crank ISR -> knock task ring
+    uint32_t adc_overruns;            // ADC DMA pool overflows
+    uint32_t can_rx_overflows;        // TWAI RX queue/FIFO losses
+    uint32_t ble_tx_dropped;          // BLE TX ring full or busy
+    uint32_t log_dropped;             // Deferred log rings full
+    uint32_t telemetry_dropped;       // Flash recorder frames lost
+    uint32_t telemetry_drive_full;    // Of those, after a drive used all erased sectors
+} runtime_counters_t;
+
+/**
+ * @brief Full snapshot
+ */
+typedef struct {
+    runtime_task_stats_t tasks[RUNTIME_STATS_MAX_TASKS];
+    uint8_t task_count;
+    uint16_t idle_permille[RUNTIME_STATS_CORES];
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    runtime_counters_t counters;
+} runtime_stats_t;
+
+/**
+ * @brief Take a snapshot
+ *
+ * CPU shares are relative to the previous call, so call at a fixed period
+ * from a single task. Needs configUSE_TRACE_FACILITY and
+ * configGENERATE_RUN_TIME_STATS; without them the task list is empty.
+ *
+ * @param out Receives the snapshot
+ * @param counters Application drop counters to include
+ */
+void runtime_stats_sample(runtime_stats_t *out, const runtime_counters_t *counters);
+
+/**
+ * @brief Log a snapshot compactly (one summary line plus one per task)
+ *
+ * @param stats Snapshot
+ */
+void runtime_stats_log(const runtime_stats_t *stats);
+
+/**
+ * @brief Serialize a snapshot for the BLE diagnostic characteristic
+ *
+ * Layout: u8 version, u8 task count, u16 idle_permille[2], u32 heap_free,
+ * u32 heap_min_free, u32 counters[9] (runtime_counters_t order), then per task: name (NUL-padded to
+ * configMAX_TASK_NAME_LEN), u8 core, u8 priority, u16 cpu_permille,
+ * u32 stack_free_min. Little-endian.
+ *
+ * @param stats Snapshot
+ * @param out Destination
+ * @param capacity Destination size
+ * @return Bytes written, 0 if capacity is too small
+ */
+uint16_t runtime_stats_serialize(const runtime_stats_t *stats, uint8_t *out, uint16_t capacity);
+
+#define RUNTIME_STATS_SERIALIZED_MAX \
+    (2 + 2 * RUNTIME_STATS_CORES + 8 + 4 * 9 + RUNTIME_STATS_MAX_TASKS * (configMAX_TASK_NAME_LEN + 8))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RUNTIME_STATS_H
@@ -0,0 +1,88 @@
+#ifndef SENSOR_BURST_H
+#define SENSOR_BURST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Sensor Burst Delta Codec (SERVICE_REALTIME_SENSOR_BURST / KNOCK_STREAM)
+//
+// A burst is a block of equally spaced samples for several channels. Time
+// is sent once: a 32-bit base timestamp plus a sample period, so sample i
+// is at base + i * period. Each channel then sends its first sample as a
+// keyframe and every later sample as the difference from the previous one,
+// all as zigzag LEB128 varints. Slowly varying signals cost 1 byte per
+// sample instead of 4 plus a 4-byte timestamp.
+//
+// Payload layout:
+//   u8 channel_count, u8 sample_count, u32 base_timestamp_us (LE),
+//   varint period_us, then per channel:
+//   u8 channel_id, varint keyframe, varint delta[sample_count - 1]
+// ============================================================================
+
+#define SENSOR_BURST_MAX_CHANNELS 16
+#define SENSOR_BURST_MAX_SAMPLES 64
+#define SENSOR_BURST_HEADER_SIZE 6       // Counts + base timestamp, before the period
+#define SENSOR_BURST_VARINT_MAX 5        // Bytes for any 32-bit value
+
+/**
+ * @brief Burst description
+ *
+ * samples is channel-major: samples[ch * sample_count + i].
+ */
+typedef struct {
+    uint8_t channel_count;
+    uint8_t sample_count;
+    uint32_t base_timestamp_us;
+    uint32_t period_us;
+    const uint8_t *channel_ids;
+    const int32_t *samples;
+} sensor_burst_t;
+
+/**
+ * @brief Worst-case encoded size, for reserving output space
+ *
+ * @param channel_count Number of channels
+ * @param sample_count Samples per channel
+ * @return Maximum payload bytes
+ */
+static inline uint32_t sensor_burst_max_size(uint8_t channel_count, uint8_t sample_count) {
+    return SENSOR_BURST_HEADER_SIZE + SENSOR_BURST_VARINT_MAX +
+           (uint32_t)channel_count * (1 + (uint32_t)sample_count * SENSOR_BURST_VARINT_MAX);
+}
+
+/**
+ * @brief Encode a burst
+ *
+ * @param burst Burst to encode
+ * @param out Destination buffer
+ * @param capacity Destination size
+ * @return Bytes written, 0 if the burst is invalid or does not fit
+ */
+uint16_t sensor_burst_encode(const sensor_burst_t *burst, uint8_t *out, uint16_t capacity);
+
+/**
+ * @brief Decode a burst
+ *
+ * @param in Encoded payload
+ * @param len Payload length
+ * @param channel_ids Receives channel IDs (SENSOR_BURST_MAX_CHANNELS entries)
+ * @param samples Receives channel-major samples (max channels x max samples)
+ * @param out Receives counts and timing; channel_ids/samples point at the arrays
+ * @return true if the payload was well formed
+ */
+bool sensor_burst_decode(const uint8_t *in,
+                         uint16_t len,
+                         uint8_t *channel_ids,
+                         int32_t *samples,
+                         sensor_burst_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSOR_BURST_H
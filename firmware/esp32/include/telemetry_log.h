@@ -0,0 +1,188 @@
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Flash Telemetry Recorder
+//
+// Protocol frames (the delta-encoded sensor bursts the app already decodes)
+// are copied into a RAM frame stream by their producers, which never touch
+// flash. A low-priority task appends them to the "telemetry" data partition
+// in the BLE TX stream's own format (u16 length prefix, frame), staged in RAM
+// and programmed a page at a time.
+//
+// Every flash operation disables the cache on both cores, so the knock task
+// on core 0 stalls for each page program too. Programs are therefore
+// synchronised to it: the knock task hands out a slot each time it has
+// drained the ADC DMA pool, and the writer programs one page per fresh slot.
+// The next block is then a full DMA block away, and the DMA pool keeps
+// filling under a stall, so a page program (under 1 ms typical, 3 ms worst
+// case) delays knock processing by at most one block and loses no samples.
+//
+// The partition is a circular log of 4 KB sectors, each opened with a magic
+// and a sequence number, so every sector is erased once per lap (even wear)
+// and the write head is found again after reset. Sector erases are the long
+// flash operations, so they only run ahead of the head while erasing is
+// allowed (engine stopped); with no erased sector left, frames are dropped
+// rather than erased for. At each stop the writer erases every sector but
+// the newest TELEMETRY_RETAIN_SECTORS of history, so the next drive can fill
+// the rest of the partition (about 1.7 MB of the 1.9 MB). Frames dropped
+// once a drive has used it all are counted in drive_full.
+//
+// Playback hands out runs of whole prefixed frames as pointers into the
+// memory-mapped partition, ready to go into a notification unchanged.
+// ============================================================================
+
+#define TELEMETRY_PARTITION_LABEL "telemetry"
+#define TELEMETRY_PARTITION_SUBTYPE 0x40
+#define TELEMETRY_SECTOR_SIZE 4096
+#define TELEMETRY_SECTOR_HEADER_SIZE 8      // u32 magic, u32 sequence
+#define TELEMETRY_SECTOR_MAGIC 0x4C545743   // "CWTL"
+#define TELEMETRY_PAGE_SIZE 256             // Flash program unit
+#define TELEMETRY_STREAM_SIZE 2048          // RAM frame stream ahead of the writer
+#define TELEMETRY_FLUSH_PERIOD_MS 1000      // Partial pages reach flash at least this often
+#ifndef TELEMETRY_RETAIN_SECTORS
+#define TELEMETRY_RETAIN_SECTORS 64         // Recorded sectors kept through a stop for download (256 KB)
+#endif
+#define TELEMETRY_PROGRAM_SLOT_US 1000      // A slot older than this is not used: the next block is due
+
+// CW_SERVICE_TELEMETRY_PLAYBACK: the app writes a u32 since_sequence (0 =
+// everything) to the command characteristic; the device answers with a START
+// marker (first sector sequence), the recorded frames unchanged, then an END
+// marker (last sector sequence, to resume from next time). Markers carry
+// u8 event, u32 value.
+#define TELEMETRY_PLAYBACK_REQUEST_SIZE 4
+#define TELEMETRY_PLAYBACK_MARKER_SIZE 5
+#define TELEMETRY_PLAYBACK_START 0
+#define TELEMETRY_PLAYBACK_END 1
+
+/**
+ * @brief Recorder counters
+ */
+typedef struct {
+    uint32_t sectors;           // Partition size in sectors, 0 if no partition
+    uint32_t head_sequence;     // Sequence number of the sector being written
+    uint32_t erased_ahead;      // Erased sectors ready for the head
+    uint32_t erase_target;      // Sectors erased ahead at a stop: the per-drive capacity
+    uint32_t bytes_written;     // Since boot
+    uint32_t frames_dropped;    // RAM stream full, or no erased sector
+    uint32_t drive_full;        // Of those, dropped for lack of an erased sector
+    uint32_t write_errors;
+} telemetry_log_stats_t;
+
+/**
+ * @brief Playback cursor (one reader, the BLE task)
+ */
+typedef struct {
+    uint32_t sector;            // Sector being read
+    uint32_t offset;            // Next prefix within it
+    uint32_t sequence;          // Its sequence number
+    uint32_t last_sequence;     // Head sector when playback began
+    uint32_t last_end;          // Bytes of the head sector in flash when playback began
+    uint32_t bytes;             // Handed out so far
+    bool active;
+} telemetry_playback_t;
+
+/**
+ * @brief Find and map the partition, and locate the write head
+ * @return ESP_OK, ESP_ERR_NOT_FOUND without a telemetry partition
+ */
+esp_err_t telemetry_log_init(void);
+
+/**
+ * @brief Reserve space for one frame in the RAM stream (any task)
+ *
+ * The stream stays locked until telemetry_log_commit(): build the frame
+ * without blocking.
+ *
+ * @param max_len Largest frame the caller may write
+ * @return Frame pointer, NULL if the stream is full or the recorder is off
+ */
+uint8_t *telemetry_log_reserve(uint16_t max_len);
+
+/**
+ * @brief Reserve like telemetry_log_reserve(), without waiting for the lock
+ *
+ * For the knock task: a frame is dropped (counted in frames_dropped) rather
+ * than wait on the writer task.
+ *
+ * @param max_len Largest frame the caller may write
+ * @return Frame pointer, NULL if the stream is full or busy, or the recorder is off
+ */
+uint8_t *telemetry_log_try_reserve(uint16_t max_len);
+
+/**
+ * @brief Publish a reserved frame
+ * @param len Frame bytes written
+ */
+void telemetry_log_commit(uint16_t len);
+
+/**
+ * @brief Let the writer program one page now (knock task, after draining the ADC DMA pool)
+ */
+void telemetry_log_program_slot(void);
+
+/**
+ * @brief Allow or forbid sector erases (e.g. only while the engine is stopped)
+ * @param allowed true to let the writer erase ahead of the head
+ */
+void telemetry_log_set_erase_allowed(bool allowed);
+
+/**
+ * @brief Get recorder counters
+ * @param out Receives counters
+ */
+void telemetry_log_get_stats(telemetry_log_stats_t *out);
+
+/**
+ * @brief Start playback from the oldest sector at or after a sequence number
+ *
+ * Covers what is in flash now; erasing is held off until playback ends.
+ *
+ * @param pb Cursor
+ * @param since_sequence First sector sequence wanted (0 = everything)
+ * @return true if there is anything to play back
+ */
+bool telemetry_log_playback_begin(telemetry_playback_t *pb, uint32_t since_sequence);
+
+/**
+ * @brief Get the next run of whole prefixed frames
+ *
+ * @param pb Cursor
+ * @param max_bytes Packet capacity, length prefixes included
+ * @param span Receives a pointer into the mapped partition
+ * @return Span length, 0 when playback is complete
+ */
+uint16_t telemetry_log_playback_next(telemetry_playback_t *pb, uint16_t max_bytes, const uint8_t **span);
+
+/**
+ * @brief Consume a span returned by telemetry_log_playback_next()
+ * @param pb Cursor
+ * @param len Span length
+ */
+void telemetry_log_playback_advance(telemetry_playback_t *pb, uint16_t len);
+
+/**
+ * @brief Stop playback and let erasing resume
+ * @param pb Cursor
+ */
+void telemetry_log_playback_end(telemetry_playback_t *pb);
+
+/**
+ * @brief Low-priority writer task: moves frames from RAM to flash
+ * @param pvParameters Unused
+ */
+void telemetry_log_task(void *pvParameters);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_LOG_H
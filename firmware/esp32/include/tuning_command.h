@@ -0,0 +1,88 @@
+#ifndef TUNING_COMMAND_H
+#define TUNING_COMMAND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cw_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Live Tuning Commands (BLE write -> control task)
+//
+// The app writes one CW_SERVICE_TUNING_ADJUSTMENT frame per command to the
+// command characteristic: payload u8 parameter, i16 value (little-endian).
+// The frame is checked and range-limited in the BLE host's callback and
+// queued as a fixed-size record, refused or not; the control task applies
+// it and answers with an acknowledgement frame on the stream characteristic
+// carrying the same sequence number: u8 parameter, u8 status, i16 value in
+// effect.
+// ============================================================================
+
+#define TUNING_COMMAND_PAYLOAD_SIZE 3
+#define TUNING_ACK_PAYLOAD_SIZE 4
+#define TUNING_TIMING_OFFSET_MAX 10   // Degrees either side of the base timing
+#define TUNING_BOOST_TARGET_MAX 250   // kPa absolute
+
+typedef enum {
+    TUNING_PARAM_TIMING_OFFSET = 0x01, // Degrees added to the base timing (knock retard still applies)
+    TUNING_PARAM_FUEL_TRIM = 0x02,     // Percent, hal_set_fuel_trim()
+    TUNING_PARAM_BOOST_TARGET = 0x03,  // kPa, hal_set_boost_target()
+} tuning_param_t;
+
+typedef enum {
+    TUNING_STATUS_OK = 0,
+    TUNING_STATUS_BAD_FRAME,      // Short, wrong service or CRC mismatch
+    TUNING_STATUS_UNKNOWN_PARAM,
+    TUNING_STATUS_OUT_OF_RANGE,
+    TUNING_STATUS_QUEUE_FULL,
+    TUNING_STATUS_REJECTED,       // HAL refused the value
+} tuning_status_t;
+
+/**
+ * @brief One command, as queued to the control task
+ */
+typedef struct {
+    uint8_t param;          // tuning_param_t
+    uint8_t sequence;       // From the frame header, echoed in the ack
+    int16_t value;          // Range-checked
+    uint32_t received_us;   // Write arrival, for the apply latency
+    uint8_t status;         // tuning_status_t: OK to apply, else only acknowledged
+} tuning_command_t;
+
+/**
+ * @brief Check a command frame and decode it
+ *
+ * @param data Written bytes
+ * @param len Number of written bytes
+ * @param received_us Arrival time
+ * @param out Receives the command (param and sequence also on range errors)
+ * @return TUNING_STATUS_OK, or why the command was refused
+ */
+tuning_status_t tuning_command_parse(const uint8_t *data, uint16_t len, uint32_t received_us,
+                                     tuning_command_t *out);
+
+/**
+ * @brief Write an acknowledgement payload
+ *
+ * @param out Destination (TUNING_ACK_PAYLOAD_SIZE bytes)
+ * @param param Parameter
+ * @param status Result
+ * @param value Value in effect after the command
+ * @return Payload length
+ */
+static inline uint16_t tuning_ack_write(uint8_t *out, uint8_t param, tuning_status_t status, int16_t value) {
+    out[0] = param;
+    out[1] = (uint8_t)status;
+    out[2] = (uint8_t)((uint16_t)value & 0xFF);
+    out[3] = (uint8_t)((uint16_t)value >> 8);
+    return TUNING_ACK_PAYLOAD_SIZE;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TUNING_COMMAND_H
@@ -0,0 +1,119 @@
+#ifndef TUNING_MAP_H
+#define TUNING_MAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// RPM x Load Tuning Maps
+//
+// Cells are int16, row-major by RPM bin with the load bins of one row
+// adjacent, so the four cells of a lookup sit in two short runs. Lookups
+// run per firing from the crank ISR: the RPM bin comes from a LUT indexed by
+// RPM / 64 plus at most a step or two, the load bin from a binary search, and
+// the fractions from precomputed 1/span reciprocals, so the bilinear blend is
+// a handful of multiplies with no division.
+//
+// A map set double-buffers one map. The writer edits the spare copy and
+// publishes it with one atomic index store; each lookup pins the copy it
+// reads, and the writer waits for a copy to be unpinned before reusing it,
+// so readers on either core never see a half-written table.
+// ============================================================================
+
+#define TUNING_MAP_MAX_RPM_BINS 16
+#define TUNING_MAP_MAX_LOAD_BINS 16
+#define TUNING_MAP_FRAC_BITS 8           // Interpolation weights in Q8
+#define TUNING_MAP_RPM_LUT_SHIFT 6       // 64 RPM per LUT slot
+#define TUNING_MAP_RPM_LUT_SIZE 160      // Slots cover 0-10239 RPM, above clamps to the last
+
+/**
+ * @brief One map: axes and cells as edited, plus lookup tables from tuning_map_prepare()
+ */
+typedef struct {
+    uint8_t rpm_bins;                                   // 2..TUNING_MAP_MAX_RPM_BINS
+    uint8_t load_bins;                                  // 2..TUNING_MAP_MAX_LOAD_BINS
+    uint16_t rpm_axis[TUNING_MAP_MAX_RPM_BINS];         // Strictly ascending
+    uint16_t load_axis[TUNING_MAP_MAX_LOAD_BINS];       // Strictly ascending (kPa MAP)
+    int16_t cells[TUNING_MAP_MAX_RPM_BINS * TUNING_MAP_MAX_LOAD_BINS]; // [rpm_bin * load_bins + load_bin]
+    // Derived by tuning_map_prepare()
+    uint8_t rpm_lut[TUNING_MAP_RPM_LUT_SIZE];           // Lower RPM bin at the slot's start
+    uint32_t rpm_recip[TUNING_MAP_MAX_RPM_BINS];        // 2^16 / (axis[i + 1] - axis[i]), rounded up
+    uint32_t load_recip[TUNING_MAP_MAX_LOAD_BINS];
+} tuning_map_t;
+
+/**
+ * @brief Double-buffered map shared by one writer and any number of readers
+ */
+typedef struct {
+    tuning_map_t maps[2];
+    uint32_t active;        // Copy lookups use (atomic)
+    uint32_t readers[2];    // Lookups in progress, per copy (atomic)
+    uint32_t generation;    // Successful commits
+} tuning_map_set_t;
+
+/**
+ * @brief Validate axes and build the lookup tables
+ *
+ * @param map Map with bins, axes and cells filled in
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for bad bin counts or non-ascending axes
+ */
+esp_err_t tuning_map_prepare(tuning_map_t *map);
+
+/**
+ * @brief Bilinear lookup, clamped at the axis ends (any context, IRAM)
+ *
+ * @param map Prepared map
+ * @param rpm Engine speed
+ * @param load Load on the load axis' scale
+ * @return Interpolated cell value, rounded
+ */
+int16_t tuning_map_lookup(const tuning_map_t *map, uint16_t rpm, uint16_t load);
+
+/**
+ * @brief Initialize both copies from one map
+ *
+ * @param set Map set
+ * @param initial Axes and cells (need not be prepared)
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if the map does not validate
+ */
+esp_err_t tuning_map_set_init(tuning_map_set_t *set, const tuning_map_t *initial);
+
+/**
+ * @brief Look up in the published copy (any context, IRAM)
+ *
+ * @param set Map set
+ * @param rpm Engine speed
+ * @param load Load
+ * @return Interpolated cell value
+ */
+int16_t tuning_map_set_lookup(tuning_map_set_t *set, uint16_t rpm, uint16_t load);
+
+/**
+ * @brief Get the spare copy for editing (writer task only)
+ *
+ * Waits until no lookup is still reading the spare, then copies the
+ * published map into it so single cells can be changed in place.
+ *
+ * @param set Map set
+ * @return Spare copy, private to the writer until tuning_map_set_commit()
+ */
+tuning_map_t *tuning_map_set_begin_update(tuning_map_set_t *set);
+
+/**
+ * @brief Prepare the spare copy and publish it
+ *
+ * @param set Map set
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG (the published map is kept)
+ */
+esp_err_t tuning_map_set_commit(tuning_map_set_t *set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TUNING_MAP_H
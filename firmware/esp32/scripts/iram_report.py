@@ -0,0 +1,68 @@
+# PlatformIO post-build step: report IRAM/DRAM use of the linked firmware.
+#
+# Everything a real-time ISR touches must live in IRAM/DRAM, so IRAM fills
+# up as hot paths are pinned there. This prints usage against the ESP32
+# segments, the largest IRAM symbols (candidates to move back to flash) and
+# warns when IRAM headroom drops below custom_iram_min_free.
+
+import subprocess
+
+Import("env")
+
+# ESP32 internal memory as seen by the application (ESP-IDF 5.1 memory map)
+IRAM_START, IRAM_END = 0x40080000, 0x400A0000
+DRAM_START, DRAM_END = 0x3FFAE000, 0x40000000
+TOP_SYMBOLS = 10
+
+
+def tool(name):
+    return env.subst("$SIZETOOL").replace("size", name)
+
+
+def section_totals(elf):
+    iram = dram = 0
+    output = subprocess.check_output([tool("size"), "-A", elf], text=True)
+    for line in output.splitlines()[2:]:
+        fields = line.split()
+        if len(fields) != 3 or not fields[1].isdigit():
+            continue
+        size, addr = int(fields[1]), int(fields[2])
+        if IRAM_START <= addr < IRAM_END:
+            iram += size
+        elif DRAM_START <= addr < DRAM_END:
+            dram += size
+    return iram, dram
+
+
+def top_iram_symbols(elf):
+    output = subprocess.check_output([tool("nm"), "-S", "--size-sort", "-r", elf], text=True)
+    symbols = []
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) != 4:
+            continue
+        addr, size, name = int(fields[0], 16), int(fields[1], 16), fields[3]
+        if IRAM_START <= addr < IRAM_END:
+            symbols.append((size, name))
+        if len(symbols) == TOP_SYMBOLS:
+            break
+    return symbols
+
+
+def iram_report(source, target, env):
+    elf = str(target[0])
+    iram, dram = section_totals(elf)
+    iram_size = IRAM_END - IRAM_START
+    iram_free = iram_size - iram
+    print("IRAM: %6d / %6d bytes used, %6d free" % (iram, iram_size, iram_free))
+    print("DRAM: %6d bytes static (.data + .bss)" % dram)
+    print("Largest IRAM symbols:")
+    for size, name in top_iram_symbols(elf):
+        print("  %6d  %s" % (size, name))
+
+    min_free = int(env.GetProjectOption("custom_iram_min_free", "0"))
+    if iram_free < min_free:
+        print("WARNING: IRAM headroom %d bytes is below custom_iram_min_free (%d)" % (iram_free, min_free))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", iram_report)
@@ -0,0 +1,232 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal_sim.h"
+
+static uint64_t s_now_us;
+static uint16_t s_crank_angle;
+static uint16_t s_rpm;
+static int16_t s_ignition_timing;
+static uint32_t s_ignition_updates;
+static uint32_t s_can_tx;
+static FILE *s_can_log;
+static double s_can_log_start = -1.0;
+
+static uint16_t *s_knock_samples;
+static uint32_t s_knock_count;
+static uint32_t s_knock_pos;
+static uint32_t s_knock_rate_hz;
+static uint16_t s_knock_block_len;
+static bool s_knock_running;
+
+// === Time ===
+
+uint64_t hal_get_time_us(void) {
+    return s_now_us;
+}
+
+uint32_t hal_get_time_ms(void) {
+    return (uint32_t)(s_now_us / 1000);
+}
+
+void hal_delay_ms(uint32_t ms) {
+    s_now_us += (uint64_t)ms * 1000;
+}
+
+void hal_sim_set_time_us(uint64_t now_us) {
+    s_now_us = now_us;
+}
+
+// === Engine position and actuators ===
+
+void hal_sim_set_crank(uint16_t angle, uint16_t rpm) {
+    s_crank_angle = angle;
+    s_rpm = rpm;
+}
+
+uint16_t hal_get_crank_angle(void) {
+    return s_crank_angle;
+}
+
+uint16_t hal_get_rpm(void) {
+    return s_rpm;
+}
+
+bool hal_is_engine_cranking(void) {
+    return s_rpm < 250;
+}
+
+esp_err_t hal_set_ignition_timing(int16_t degrees_btdc) {
+    if (degrees_btdc < HAL_IGNITION_TIMING_MIN || degrees_btdc > HAL_IGNITION_TIMING_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ignition_timing = degrees_btdc;
+    s_ignition_updates++;
+    return ESP_OK;
+}
+
+int16_t hal_get_ignition_timing(void) {
+    return s_ignition_timing;
+}
+
+uint32_t hal_sim_ignition_updates(void) {
+    return s_ignition_updates;
+}
+
+// === Knock ADC stream ===
+
+static bool knock_alloc(uint32_t count) {
+    free(s_knock_samples);
+    s_knock_samples = (uint16_t *)malloc(count * sizeof(uint16_t));
+    s_knock_count = 0;
+    s_knock_pos = 0;
+    return s_knock_samples != NULL;
+}
+
+uint32_t hal_sim_load_knock_waveform(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL || !knock_alloc(HAL_SIM_MAX_KNOCK_SAMPLES)) {
+        if (f != NULL) {
+            fclose(f);
+        }
+        return 0;
+    }
+    uint8_t raw[2];
+    while (s_knock_count < HAL_SIM_MAX_KNOCK_SAMPLES && fread(raw, 1, 2, f) == 2) {
+        s_knock_samples[s_knock_count++] = (uint16_t)(raw[0] | (raw[1] << 8)) & 0x0FFF;
+    }
+    fclose(f);
+    return s_knock_count;
+}
+
+uint32_t hal_sim_generate_knock_waveform(uint32_t count,
+                                         uint32_t rate_hz,
+                                         uint32_t resonance_hz,
+                                         uint16_t rpm,
+                                         uint16_t tdc_interval_deg,
+                                         uint32_t knock_every) {
+    if (count > HAL_SIM_MAX_KNOCK_SAMPLES) {
+        count = HAL_SIM_MAX_KNOCK_SAMPLES;
+    }
+    if (rate_hz == 0 || rpm == 0 || tdc_interval_deg == 0 || !knock_alloc(count)) {
+        return 0;
+    }
+    const double tdc_interval_s = (double)tdc_interval_deg / (rpm * 6.0);
+    const double onset_s = 15.0 / (rpm * 6.0); // Knock starts 15 deg ATDC
+    const double w = 2.0 * M_PI * (double)resonance_hz;
+    uint32_t lcg = 0x12345678;
+    for (uint32_t n = 0; n < count; n++) {
+        const double t = (double)n / rate_hz;
+        lcg = lcg * 1664525u + 1013904223u;
+        double v = 2048.0 + (double)((int32_t)(lcg >> 25) - 64);
+        const uint32_t firing = (uint32_t)(t / tdc_interval_s);
+        const double since = t - firing * tdc_interval_s - onset_s;
+        if (knock_every != 0 && firing % knock_every == knock_every - 1 && since >= 0.0) {
+            v += 1200.0 * exp(-since / 0.0015) * sin(w * since);
+        }
+        s_knock_samples[n] = (uint16_t)(v < 0 ? 0 : (v > 4095 ? 4095 : v));
+    }
+    s_knock_count = count;
+    return count;
+}
+
+esp_err_t hal_adc_knock_start_stream(uint32_t rate_hz,
+                                     uint16_t block_len,
+                                     hal_adc_block_ready_cb_t cb) {
+    (void)cb; // The replay loop pulls blocks itself
+    if (rate_hz == 0 || block_len == 0 || block_len > HAL_ADC_KNOCK_STREAM_MAX_BLOCK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_knock_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_knock_rate_hz = rate_hz;
+    s_knock_block_len = block_len;
+    s_knock_pos = 0;
+    s_knock_running = true;
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_knock_stop_stream(void) {
+    if (!s_knock_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_knock_running = false;
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_knock_get_block(const uint16_t **samples,
+                                  uint16_t *count,
+                                  uint64_t *timestamp_us) {
+    if (!s_knock_running || s_knock_pos + s_knock_block_len > s_knock_count) {
+        return ESP_ERR_TIMEOUT;
+    }
+    *samples = &s_knock_samples[s_knock_pos];
+    *count = s_knock_block_len;
+    s_knock_pos += s_knock_block_len;
+    // Sample 0 of the waveform is taken at time 0
+    *timestamp_us = (uint64_t)(s_knock_pos - 1) * 1000000u / s_knock_rate_hz;
+    return ESP_OK;
+}
+
+uint32_t hal_adc_knock_get_overrun_count(void) {
+    return 0;
+}
+
+// === CAN ===
+
+esp_err_t hal_can_send(const hal_can_frame_t *frame) {
+    (void)frame;
+    s_can_tx++;
+    return ESP_OK;
+}
+
+uint32_t hal_can_get_rx_overflow_count(void) {
+    return 0;
+}
+
+uint32_t hal_sim_can_tx_count(void) {
+    return s_can_tx;
+}
+
+bool hal_sim_open_can_log(const char *path) {
+    if (s_can_log != NULL) {
+        fclose(s_can_log);
+    }
+    s_can_log = fopen(path, "r");
+    s_can_log_start = -1.0;
+    return s_can_log != NULL;
+}
+
+// Line format: "(1436509052.249713) can0 7E8#0441...", payload in hex
+bool hal_sim_next_can_frame(hal_can_frame_t *frame, uint64_t *timestamp_us) {
+    char line[128];
+    while (s_can_log != NULL && fgets(line, sizeof(line), s_can_log) != NULL) {
+        double ts;
+        char iface[16];
+        char id_hex[16];
+        char data_hex[32];
+        if (sscanf(line, " (%lf) %15s %15[0-9A-Fa-f]#%31[0-9A-Fa-f]", &ts, iface, id_hex, data_hex) != 4) {
+            data_hex[0] = '\0';
+            if (sscanf(line, " (%lf) %15s %15[0-9A-Fa-f]#", &ts, iface, id_hex) != 3) {
+                continue;
+            }
+        }
+        if (s_can_log_start < 0.0) {
+            s_can_log_start = ts;
+        }
+        memset(frame, 0, sizeof(*frame));
+        frame->id = (uint32_t)strtoul(id_hex, NULL, 16);
+        frame->is_extended = strlen(id_hex) > 3;
+        const size_t hex_len = strlen(data_hex);
+        for (size_t i = 0; i + 1 < hex_len && frame->dlc < HAL_CAN_MAX_DATA_LENGTH; i += 2) {
+            char byte[3] = {data_hex[i], data_hex[i + 1], '\0'};
+            frame->data[frame->dlc++] = (uint8_t)strtoul(byte, NULL, 16);
+        }
+        *timestamp_us = (uint64_t)((ts - s_can_log_start) * 1e6 + 0.5);
+        frame->timestamp_us = (uint32_t)*timestamp_us;
+        return true;
+    }
+    return false;
+}
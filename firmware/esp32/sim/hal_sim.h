@@ -0,0 +1,102 @@
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Simulated HAL Backend (native build)
+//
+// Implements the hal.h calls the pipeline makes against a virtual clock, so
+// recorded drives replay as fast as the host can process them. Knock
+// samples come from a recorded or synthesized waveform and are handed out
+// in DMA-sized blocks; CAN frames come from a candump log. Actuator calls
+// are recorded instead of driven.
+// ============================================================================
+
+#define HAL_SIM_MAX_KNOCK_SAMPLES (50000u * 60u) // One minute at 50 kHz
+
+/**
+ * @brief Set the virtual clock
+ * @param now_us New time
+ */
+void hal_sim_set_time_us(uint64_t now_us);
+
+/**
+ * @brief Set the simulated crank position
+ * @param angle Crank angle (0-719)
+ * @param rpm Engine speed
+ */
+void hal_sim_set_crank(uint16_t angle, uint16_t rpm);
+
+/**
+ * @brief Load a recorded knock waveform
+ *
+ * Raw little-endian uint16 ADC samples at the stream rate, as dumped from
+ * the knock task's DMA blocks.
+ *
+ * @param path Waveform file
+ * @return Samples loaded, 0 on error
+ */
+uint32_t hal_sim_load_knock_waveform(const char *path);
+
+/**
+ * @brief Synthesize a knock waveform
+ *
+ * Mid-scale noise with knock ringing after every knock_every-th firing TDC,
+ * TDCs evenly spaced by tdc_interval_deg at a constant engine speed that
+ * starts at angle 0, time 0.
+ *
+ * @param count Samples to generate (up to HAL_SIM_MAX_KNOCK_SAMPLES)
+ * @param rate_hz Sample rate
+ * @param resonance_hz Ringing frequency
+ * @param rpm Engine speed
+ * @param tdc_interval_deg Crank degrees between firing TDCs
+ * @param knock_every Knock on every n-th firing (0: never)
+ * @return Samples generated
+ */
+uint32_t hal_sim_generate_knock_waveform(uint32_t count,
+                                         uint32_t rate_hz,
+                                         uint32_t resonance_hz,
+                                         uint16_t rpm,
+                                         uint16_t tdc_interval_deg,
+                                         uint32_t knock_every);
+
+/**
+ * @brief Open a candump log (`candump -l` format) for replay
+ * @param path Log file
+ * @return true if opened
+ */
+bool hal_sim_open_can_log(const char *path);
+
+/**
+ * @brief Read the next logged frame
+ *
+ * Timestamps are relative to the first frame of the log.
+ *
+ * @param frame Receives the frame
+ * @param timestamp_us Receives its log time
+ * @return false at end of log
+ */
+bool hal_sim_next_can_frame(hal_can_frame_t *frame, uint64_t *timestamp_us);
+
+/**
+ * @brief Number of frames sent through hal_can_send()
+ */
+uint32_t hal_sim_can_tx_count(void);
+
+/**
+ * @brief Number of ignition timing changes
+ */
+uint32_t hal_sim_ignition_updates(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HAL_SIM_H
@@ -0,0 +1,9 @@
+#ifndef SIM_ESP_ATTR_H
+#define SIM_ESP_ATTR_H
+
+// Host build: memory placement attributes have no meaning
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif // SIM_ESP_ATTR_H
@@ -0,0 +1,19 @@
+#ifndef SIM_ESP_CPU_H
+#define SIM_ESP_CPU_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Host build: one "cycle" is one nanosecond of the monotonic clock
+
+static inline uint32_t esp_cpu_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static inline int esp_cpu_get_core_id(void) {
+    return 0;
+}
+
+#endif // SIM_ESP_CPU_H
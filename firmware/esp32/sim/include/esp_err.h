@@ -0,0 +1,18 @@
+#ifndef SIM_ESP_ERR_H
+#define SIM_ESP_ERR_H
+
+// Host build: the subset of ESP-IDF error codes used by the portable modules
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+
+#endif // SIM_ESP_ERR_H
@@ -0,0 +1,11 @@
+#ifndef SIM_ESP_ROM_SYS_H
+#define SIM_ESP_ROM_SYS_H
+
+#include <stdint.h>
+
+// Host build: matches the nanosecond "cycles" of esp_cpu.h
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void) {
+    return 1000;
+}
+
+#endif // SIM_ESP_ROM_SYS_H
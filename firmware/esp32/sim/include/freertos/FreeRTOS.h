@@ -0,0 +1,19 @@
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+
+// Host build: the replay runs every module on one thread, so the RTOS
+// primitives the portable modules touch reduce to no-ops
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define configMAX_TASK_NAME_LEN 16
+
+#endif // SIM_FREERTOS_H
@@ -0,0 +1,31 @@
+#ifndef SIM_SEMPHR_H
+#define SIM_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
+typedef struct {
+    int unused;
+} StaticSemaphore_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    static StaticSemaphore_t s_mutex;
+    return &s_mutex;
+}
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *storage) {
+    return storage;
+}
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    (void)sem;
+    (void)ticks;
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    (void)sem;
+    return pdTRUE;
+}
+
+#endif // SIM_SEMPHR_H
@@ -0,0 +1,17 @@
+#ifndef SIM_TASK_H
+#define SIM_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    (void)task;
+    return pdPASS;
+}
+
+static inline void vTaskDelay(TickType_t ticks) {
+    (void)ticks;
+}
+
+#endif // SIM_TASK_H
@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hal_sim.h"
+#include "ring_buffer.h"
+#include "crc16.h"
+#include "cw_protocol.h"
+#include "sensor_burst.h"
+#include "ble_tx_stream.h"
+#include "knock_window.h"
+#include "knock_dsp.h"
+#include "knock_noise_floor.h"
+#include "knock_response.h"
+#include "obd_pid.h"
+#include "pid_scheduler.h"
+#include "tuning_map.h"
+#include "cylinder_health.h"
+
+// ============================================================================
+// Native Replay and Benchmark Runner
+//
+// Micro-benchmarks the hot modules, then replays a knock waveform and a CAN
+// log through the same code the firmware runs, against the simulated HAL's
+// virtual clock. Every result is printed as "bench <name> <value> <unit>"
+// so runs can be diffed commit to commit, and checked against the limits
+// below: any result past its limit prints "FAIL" and the runner exits 1.
+// Time limits leave about 10x headroom over a desktop host, so they catch
+// algorithmic regressions rather than a slow machine.
+//
+// Usage: replay_bench [--knock FILE] [--can FILE] [--rpm N] [--seconds N]
+// Without --knock, a synthetic waveform is used: knock on every 7th firing,
+// so it rotates through the cylinders.
+// ============================================================================
+
+// Mirrors the firmware configuration in main.cpp
+#define KNOCK_SAMPLE_RATE_HZ 50000
+#define KNOCK_SAMPLE_PERIOD_NS (1000000000UL / KNOCK_SAMPLE_RATE_HZ)
+#define KNOCK_DMA_BLOCK_SAMPLES 128
+#define KNOCK_RESONANCE_HZ 17000
+#define KNOCK_FILTER_Q_X100 300
+#define KNOCK_FILTER_SECTIONS 2
+#define KNOCK_THRESHOLD_Q8 (3 * KNOCK_SCORE_UNITY)
+#define KNOCK_BASE_TIMING_DEG 10
+#define KNOCK_WINDOW_QUEUE_LEN 8
+#define CRANK_TOOTH_DEG 6            // 60-tooth wheel, missing teeth not modelled
+#define BENCH_BLE_ATT_PAYLOAD 244    // MTU 247 minus the notification header
+
+// Regression limits
+#define BENCH_MAX_RING_NS 150
+#define BENCH_MIN_CRC16_MBPS 100
+#define BENCH_MAX_DSP_WINDOW_NS 50000
+#define BENCH_MAX_PID_SCHED_NS 400
+#define BENCH_MAX_BLE_PACK_NS 3000
+#define BENCH_MIN_BLE_BYTES_PER_PACKET 80
+#define BENCH_MAX_TUNING_MAP_NS 300
+#define BENCH_MIN_REPLAY_SPEED 100   // x realtime
+#define BENCH_SYNTHETIC_KNOCK_EVERY 7
+#define BENCH_KNOCK_TOLERANCE_PCT 3   // Plus 2 events: window phase vs knock onset varies with RPM
+
+static const knock_window_config_t knock_window_config = {
+    4,
+    {
+        {1, 0, 10, 70},
+        {3, 180, 10, 70},
+        {4, 360, 10, 70},
+        {2, 540, 10, 70},
+    },
+};
+
+static const pid_sched_config_t obd_poll_config[] = {
+    {0x0C, 3, 50},
+    {0x0B, 3, 50},
+    {0x0E, 2, 20},
+    {0x11, 2, 20},
+    {0x14, 1, 10},
+    {0x0F, 0, 1},
+    {0x05, 0, 1},
+};
+
+static uint64_t wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int s_failures;
+
+static void report(const char *name, double value, const char *unit) {
+    printf("bench %-28s %14.2f %s\n", name, value, unit);
+}
+
+static void check(const char *name, bool ok, double value, const char *limit_text, double limit) {
+    if (!ok) {
+        printf("FAIL  %-28s %14.2f, limit %s %.2f\n", name, value, limit_text, limit);
+        s_failures++;
+    }
+}
+
+static void check_at_most(const char *name, double value, double limit) {
+    check(name, value <= limit, value, "<=", limit);
+}
+
+static void check_at_least(const char *name, double value, double limit) {
+    check(name, value >= limit, value, ">=", limit);
+}
+
+// Keeps results live so the optimizer cannot drop the measured work
+static volatile uint32_t s_sink;
+
+// === Micro-benchmarks ===
+
+static void bench_ring_buffer(void) {
+    static uint8_t storage[256 * sizeof(uint32_t)];
+    ring_buffer_t rb;
+    ring_buffer_init(&rb, storage, sizeof(storage), sizeof(uint32_t));
+    const uint32_t iterations = 4000000;
+    uint32_t v = 0;
+    const uint64_t start = wall_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        ring_buffer_push(&rb, &i);
+        ring_buffer_pop(&rb, &v);
+    }
+    s_sink = v;
+    const double ns = (double)(wall_ns() - start) / iterations;
+    report("ring_buffer_push_pop", ns, "ns/op");
+    check_at_most("ring_buffer_push_pop", ns, BENCH_MAX_RING_NS);
+}
+
+static void bench_crc16(void) {
+    static uint8_t frame[512];
+    for (uint32_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (uint8_t)(i * 31 + 7);
+    }
+    const uint32_t iterations = 200000;
+    uint16_t crc = 0;
+    const uint64_t start = wall_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        crc ^= crc16_compute(frame, sizeof(frame));
+    }
+    const uint64_t elapsed = wall_ns() - start;
+    s_sink = crc;
+    const double mbps = (double)sizeof(frame) * iterations * 1000.0 / elapsed;
+    report("crc16_512B", mbps, "MB/s");
+    check_at_least("crc16_512B", mbps, BENCH_MIN_CRC16_MBPS);
+}
+
+static void bench_knock_dsp(const knock_dsp_t *dsp) {
+    knock_dsp_benchmark_t result;
+    knock_dsp_benchmark(dsp, KNOCK_WINDOW_MAX_SAMPLES, 2000, 8000, knock_window_config.num_cylinders, &result);
+    report("knock_dsp_window_512", (double)result.cycles_per_window, "ns/window");
+    check_at_most("knock_dsp_window_512", (double)result.cycles_per_window, BENCH_MAX_DSP_WINDOW_NS);
+}
+
+static void bench_pid_scheduler(void) {
+    pid_scheduler_t sched;
+    const uint8_t count = sizeof(obd_poll_config) / sizeof(obd_poll_config[0]);
+    pid_scheduler_init(&sched, obd_poll_config, count, 0);
+    const uint32_t iterations = 1000000;
+    uint64_t now_us = 0;
+    uint32_t requested = 0;
+    const uint64_t start = wall_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint8_t pids[OBD_MAX_PIDS_PER_REQUEST];
+        const uint8_t n = pid_scheduler_next_batch(&sched, now_us, pids, OBD_MAX_PIDS_PER_REQUEST);
+        obd_pid_value_t values[OBD_MAX_PIDS_PER_REQUEST];
+        for (uint8_t k = 0; k < n; k++) {
+            values[k].pid = pids[k];
+            values[k].len = obd_pid_data_length(pids[k]);
+            memset(values[k].data, 0x40, sizeof(values[k].data));
+        }
+        now_us += 2000; // ECU answers in 2 ms
+        if (n > 0) {
+            pid_scheduler_on_response(&sched, now_us, 0, values, n);
+        }
+        requested += n;
+    }
+    const uint64_t elapsed = wall_ns() - start;
+    s_sink = requested;
+    report("pid_scheduler_cycle", (double)elapsed / iterations, "ns/op");
+    check_at_most("pid_scheduler_cycle", (double)elapsed / iterations, BENCH_MAX_PID_SCHED_NS);
+}
+
+// Encode a knock-stream burst, frame it and pack it into notifications
+static void bench_ble_packer(void) {
+    static uint8_t storage[4096];
+    static int32_t samples[4 * 16];
+    static const uint8_t ids[4] = {1, 2, 3, 4};
+    ble_tx_stream_t stream;
+    ble_tx_stream_init(&stream, storage, sizeof(storage));
+    for (uint32_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        samples[i] = 256 + (int32_t)((i * 37) % 40) - 20;
+    }
+    sensor_burst_t burst = {4, 16, 0, 30000, ids, samples};
+    const uint16_t max_payload = sensor_burst_max_size(4, 16);
+
+    const uint32_t iterations = 200000;
+    uint32_t bytes = 0;
+    uint32_t packets = 0;
+    const uint64_t start = wall_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint8_t *frame = ble_tx_stream_reserve(&stream, CW_FRAME_OVERHEAD + max_payload);
+        if (frame != NULL) {
+            burst.base_timestamp_us = i;
+            const uint16_t len = sensor_burst_encode(&burst, frame + CW_FRAME_HEADER_SIZE, max_payload);
+            ble_tx_stream_commit(&stream, cw_frame_finish(frame, CW_SERVICE_KNOCK_STREAM, (uint8_t)i, len));
+        }
+        const uint8_t *span;
+        bool full;
+        uint16_t len;
+        while ((len = ble_tx_stream_peek_span(&stream, BENCH_BLE_ATT_PAYLOAD, &span, &full)) > 0) {
+            bytes += len;
+            packets++;
+            ble_tx_stream_release_span(&stream, len);
+        }
+    }
+    const uint64_t elapsed = wall_ns() - start;
+    const double bytes_per_packet = packets ? (double)bytes / packets : 0.0;
+    report("ble_pack_knock_burst", (double)elapsed / iterations, "ns/frame");
+    report("ble_pack_bytes_per_packet", bytes_per_packet, "B");
+    check_at_most("ble_pack_knock_burst", (double)elapsed / iterations, BENCH_MAX_BLE_PACK_NS);
+    check_at_least("ble_pack_bytes_per_packet", bytes_per_packet, BENCH_MIN_BLE_BYTES_PER_PACKET);
+}
+
+// A full 16x16 map swept across its whole range, as the crank ISR would per firing
+static void bench_tuning_map(void) {
+    static tuning_map_t map;
+    static tuning_map_set_t set;
+    map.rpm_bins = TUNING_MAP_MAX_RPM_BINS;
+    map.load_bins = TUNING_MAP_MAX_LOAD_BINS;
+    for (uint8_t i = 0; i < TUNING_MAP_MAX_RPM_BINS; i++) {
+        map.rpm_axis[i] = (uint16_t)(500 + i * 500);
+    }
+    for (uint8_t i = 0; i < TUNING_MAP_MAX_LOAD_BINS; i++) {
+        map.load_axis[i] = (uint16_t)(20 + i * 15);
+    }
+    for (uint32_t i = 0; i < sizeof(map.cells) / sizeof(map.cells[0]); i++) {
+        map.cells[i] = (int16_t)((i * 37) % 400 - 100);
+    }
+    tuning_map_set_init(&set, &map);
+    const uint32_t iterations = 4000000;
+    int32_t acc = 0;
+    const uint64_t start = wall_ns();
+    for (uint32_t i = 0; i < iterations; i++) {
+        acc += tuning_map_set_lookup(&set, (uint16_t)((i * 7) % 9000), (uint16_t)((i * 13) % 260));
+    }
+    s_sink = (uint32_t)acc;
+    const double ns = (double)(wall_ns() - start) / iterations;
+    report("tuning_map_lookup", ns, "ns/op");
+    check_at_most("tuning_map_lookup", ns, BENCH_MAX_TUNING_MAP_NS);
+}
+
+// === Knock replay ===
+
+// knock_every: knock period in firings of a synthetic waveform, checked
+// against the detections; 0 for a recorded one
+static void replay_knock(const knock_dsp_t *dsp, uint16_t rpm, uint32_t knock_every) {
+    knock_window_scheduler_t sched;
+    static knock_window_buffer_t window;
+    static knock_noise_floor_t floor_model;
+    static knock_response_t response;
+    static cylinder_health_t health;
+    static uint8_t queue_storage[KNOCK_WINDOW_QUEUE_LEN * sizeof(knock_window_t)];
+    ring_buffer_t queue;
+
+    knock_window_scheduler_init(&sched, &knock_window_config);
+    knock_noise_floor_init(&floor_model);
+    knock_response_init(&response, KNOCK_BASE_TIMING_DEG);
+    cylinder_health_init(&health, knock_window_config.num_cylinders);
+    ring_buffer_init(&queue, queue_storage, sizeof(queue_storage), sizeof(knock_window_t));
+    window.armed = false;
+    hal_adc_knock_start_stream(KNOCK_SAMPLE_RATE_HZ, KNOCK_DMA_BLOCK_SAMPLES, NULL);
+
+    const double us_per_deg = 1000000.0 / ((double)rpm * 6.0);
+    uint32_t edge = 0;
+    uint32_t windows = 0;
+    uint32_t knocks = 0;
+    uint32_t queue_drops = 0;
+    uint32_t health_cycles = 0;
+    uint32_t health_flagged = 0;
+    uint64_t sim_end_us = 0;
+    const uint16_t *samples;
+    uint16_t count;
+    uint64_t block_end_us;
+
+    const uint64_t start = wall_ns();
+    while (hal_adc_knock_get_block(&samples, &count, &block_end_us) == ESP_OK) {
+        // Crank ISR: every tooth edge up to the end of this block
+        for (;;) {
+            const uint64_t edge_us = (uint64_t)(edge * CRANK_TOOTH_DEG * us_per_deg);
+            if (edge_us > block_end_us) {
+                break;
+            }
+            const uint16_t angle = (uint16_t)((edge * CRANK_TOOTH_DEG) % KNOCK_CYCLE_DEGREES);
+            hal_sim_set_time_us(edge_us);
+            hal_sim_set_crank(angle, rpm);
+            knock_window_t w;
+            if (knock_window_on_crank_edge(&sched, angle, edge_us, &w)) {
+                if (ring_buffer_is_full(&queue)) {
+                    queue_drops++;
+                } else {
+                    ring_buffer_push(&queue, &w);
+                }
+                knock_response_before_firing(&response, knock_window_next_cylinder(&sched) - 1, edge_us);
+            }
+            edge++;
+        }
+        hal_sim_set_time_us(block_end_us);
+
+        // Knock task: same per-block flow as knock_process_block()
+        uint16_t pos = 0;
+        while (pos < count) {
+            if (!window.armed) {
+                knock_window_t next;
+                if (!ring_buffer_pop(&queue, &next)) {
+                    break;
+                }
+                knock_window_arm(&window, &next);
+            }
+            bool complete;
+            pos = knock_window_collect(&window, samples, pos, count, block_end_us, KNOCK_SAMPLE_PERIOD_NS, &complete);
+            if (!complete) {
+                break;
+            }
+            window.armed = false;
+            if (window.count == 0) {
+                continue;
+            }
+            const uint8_t cyl = window.window.cylinder - 1;
+            const uint32_t energy = knock_dsp_window_energy(dsp, window.samples, window.count);
+            const uint16_t score = knock_noise_floor_update(&floor_model, cyl, window.window.rpm, 0, energy);
+            const bool knock = score > KNOCK_THRESHOLD_Q8;
+            knocks += knock;
+            windows++;
+            knock_response_on_window(&response, cyl, knock, window.window.close_us, block_end_us);
+            if (cylinder_health_on_window(&health, &window.window, score)) {
+                health_cycles++;
+                for (uint8_t c = 0; c < health.num_cylinders; c++) {
+                    health_flagged += (health.scores[c].flags & ~CYL_HEALTH_FLAG_PARTIAL) != 0;
+                }
+            }
+        }
+        sim_end_us = block_end_us;
+    }
+    const uint64_t elapsed_ns = wall_ns() - start;
+    hal_adc_knock_stop_stream();
+
+    report("knock_replay_windows", windows, "windows");
+    report("knock_replay_knocks", knocks, "events");
+    report("knock_replay_retard_updates", response.stats.applied_events, "events");
+    report("knock_replay_queue_drops", queue_drops, "windows");
+    report("knock_replay_health_cycles", health_cycles, "cycles");
+    report("knock_replay_health_flags", health_flagged, "cylinder-cycles");
+    const double speed = elapsed_ns ? sim_end_us * 1000.0 / elapsed_ns : 0.0;
+    report("knock_replay_speed", speed, "x realtime");
+
+    check_at_most("knock_replay_queue_drops", queue_drops, 0);
+    check_at_least("knock_replay_speed", speed, BENCH_MIN_REPLAY_SPEED);
+    if (knock_every != 0) {
+        // Every knock detected once and answered at the next firing (the last
+        // may fall after the replay ends); a cycle scored per firing order
+        const double expected = (double)(windows / knock_every);
+        const double tolerance = expected * BENCH_KNOCK_TOLERANCE_PCT / 100.0 + 2;
+        check_at_least("knock_replay_knocks", knocks, expected - tolerance);
+        check_at_most("knock_replay_knocks", knocks, expected + tolerance);
+        check_at_least("knock_replay_retard_updates", response.stats.applied_events, (double)knocks - 1);
+        check_at_least("knock_replay_health_cycles", health_cycles,
+                       (double)(windows / knock_window_config.num_cylinders) - 2);
+    }
+}
+
+// === CAN replay ===
+
+static void replay_can(const char *path) {
+    if (!hal_sim_open_can_log(path)) {
+        fprintf(stderr, "cannot open CAN log %s\n", path);
+        return;
+    }
+    static obd_isotp_rx_t rx[OBD_NUM_ECUS];
+    for (uint8_t i = 0; i < OBD_NUM_ECUS; i++) {
+        obd_isotp_reset(&rx[i]);
+    }
+    pid_scheduler_t sched;
+    pid_scheduler_init(&sched, obd_poll_config, sizeof(obd_poll_config) / sizeof(obd_poll_config[0]), 0);
+
+    hal_can_frame_t frame;
+    uint64_t ts_us = 0;
+    uint32_t frames = 0;
+    uint32_t responses = 0;
+    uint32_t values_decoded = 0;
+    const uint64_t start = wall_ns();
+    while (hal_sim_next_can_frame(&frame, &ts_us)) {
+        frames++;
+        hal_sim_set_time_us(ts_us);
+        if ((frame.id & OBD_RESPONSE_ID_MASK) != OBD_RESPONSE_ID_BASE) {
+            continue;
+        }
+        const uint8_t ecu_index = (uint8_t)((frame.id - OBD_RESPONSE_ID_BASE) & (OBD_NUM_ECUS - 1));
+        obd_isotp_rx_t *ecu = &rx[ecu_index];
+        const obd_isotp_result_t result = obd_isotp_feed(ecu, &frame);
+        if (result == OBD_ISOTP_NEED_FLOW_CONTROL) {
+            hal_can_frame_t flow_control;
+            obd_build_flow_control(frame.id, &flow_control);
+            hal_can_send(&flow_control);
+            continue;
+        }
+        if (result != OBD_ISOTP_COMPLETE) {
+            continue;
+        }
+        obd_pid_value_t values[OBD_MAX_PIDS_PER_REQUEST];
+        const uint8_t n = obd_parse_mode01_response(ecu->buffer, ecu->expected, values, OBD_MAX_PIDS_PER_REQUEST);
+        for (uint8_t i = 0; i < n; i++) {
+            s_sink += (uint32_t)obd_pid_decode(&values[i]);
+        }
+        values_decoded += n;
+        responses++;
+        pid_scheduler_on_response(&sched, ts_us, ecu_index, values, n);
+        uint8_t pids[OBD_MAX_PIDS_PER_REQUEST];
+        pid_scheduler_next_batch(&sched, ts_us, pids, OBD_MAX_PIDS_PER_REQUEST);
+    }
+    const uint64_t elapsed_ns = wall_ns() - start;
+
+    report("can_replay_frames", frames, "frames");
+    report("can_replay_responses", responses, "responses");
+    report("can_replay_pid_values", values_decoded, "values");
+    report("can_replay_speed", elapsed_ns ? ts_us * 1000.0 / elapsed_ns : 0.0, "x realtime");
+}
+
+int main(int argc, char **argv) {
+    const char *knock_path = NULL;
+    const char *can_path = NULL;
+    uint16_t rpm = 3000;
+    uint32_t seconds = 10;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--knock") == 0) {
+            knock_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--can") == 0) {
+            can_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--rpm") == 0) {
+            rpm = (uint16_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--seconds") == 0) {
+            seconds = (uint32_t)atoi(argv[i + 1]);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    knock_dsp_t dsp;
+    if (knock_dsp_init(&dsp, KNOCK_SAMPLE_RATE_HZ, KNOCK_RESONANCE_HZ,
+                       KNOCK_FILTER_Q_X100, KNOCK_FILTER_SECTIONS) != ESP_OK) {
+        return 1;
+    }
+
+    bench_ring_buffer();
+    bench_crc16();
+    bench_knock_dsp(&dsp);
+    bench_pid_scheduler();
+    bench_ble_packer();
+    bench_tuning_map();
+
+    uint32_t loaded;
+    uint32_t knock_every = 0;
+    if (knock_path != NULL) {
+        loaded = hal_sim_load_knock_waveform(knock_path);
+    } else {
+        knock_every = BENCH_SYNTHETIC_KNOCK_EVERY;
+        loaded = hal_sim_generate_knock_waveform(seconds * KNOCK_SAMPLE_RATE_HZ, KNOCK_SAMPLE_RATE_HZ,
+                                                 KNOCK_RESONANCE_HZ, rpm, 180, knock_every);
+    }
+    if (loaded == 0 || rpm == 0) {
+        fprintf(stderr, "no knock waveform\n");
+        return 1;
+    }
+    replay_knock(&dsp, rpm, knock_every);
+    if (can_path != NULL) {
+        replay_can(can_path);
+    }
+    if (s_failures > 0) {
+        printf("%d regression check(s) failed\n", s_failures);
+        return 1;
+    }
+    return 0;
+}
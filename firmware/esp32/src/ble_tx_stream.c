@@ -0,0 +1,208 @@
+#include "ble_tx_stream.h"
+#include "hal.h"
+
+#define STAMP_MASK (BLE_TX_STREAM_MAX_PENDING - 1)
+
+static inline uint16_t read_header(const uint8_t *p) {
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static inline void write_header(uint8_t *p, uint16_t len) {
+    p[0] = (uint8_t)(len & 0xFF);
+    p[1] = (uint8_t)(len >> 8);
+}
+
+bool ble_tx_stream_init(ble_tx_stream_t *stream, uint8_t *buffer, uint32_t size) {
+    if (stream == NULL || size < BLE_TX_STREAM_HEADER_SIZE + BLE_TX_STREAM_MAX_FRAME) {
+        return false;
+    }
+    if (!ring_buffer_init(&stream->ring, buffer, size, 1)) {
+        return false;
+    }
+    stream->lock = xSemaphoreCreateMutexStatic(&stream->lock_storage);
+    stream->consumer = NULL;
+    stream->stamp_head = 0;
+    stream->stamp_tail = 0;
+    stream->dropped = 0;
+    stream->busy = 0;
+    stream->oversize = 0;
+    return stream->lock != NULL;
+}
+
+void ble_tx_stream_set_consumer(ble_tx_stream_t *stream, TaskHandle_t consumer) {
+    stream->consumer = consumer;
+}
+
+static uint8_t *reserve(ble_tx_stream_t *stream, uint16_t max_len, TickType_t wait) {
+    if (max_len == 0 || max_len > BLE_TX_STREAM_MAX_FRAME) {
+        return NULL;
+    }
+    const uint32_t need = BLE_TX_STREAM_HEADER_SIZE + max_len;
+    ring_buffer_t *rb = &stream->ring;
+
+    if (xSemaphoreTake(stream->lock, wait) != pdTRUE) {
+        __atomic_fetch_add(&stream->busy, 1, __ATOMIC_RELAXED); // Counted outside the lock
+        return NULL;
+    }
+    if (ring_buffer_is_empty(rb)) {
+        ring_buffer_clear(rb); // Nothing is peeked while empty: restart at offset 0
+    }
+
+    uint32_t avail;
+    uint8_t *region = (uint8_t *)ring_buffer_get_write_region(rb, &avail);
+    if (region != NULL && avail < need && rb->head + avail == rb->size &&
+        ring_buffer_available(rb) - avail >= need) {
+        // Too little room before the end: skip it and take the space at the start
+        if (avail >= BLE_TX_STREAM_HEADER_SIZE) {
+            write_header(region, BLE_TX_STREAM_PAD);
+        }
+        ring_buffer_advance_write(rb, avail);
+        region = (uint8_t *)ring_buffer_get_write_region(rb, &avail);
+    }
+    if (region == NULL || avail < need ||
+        (uint16_t)(stream->stamp_head - stream->stamp_tail) == BLE_TX_STREAM_MAX_PENDING) {
+        stream->dropped++;
+        xSemaphoreGive(stream->lock);
+        return NULL;
+    }
+    return region + BLE_TX_STREAM_HEADER_SIZE;
+}
+
+uint8_t *ble_tx_stream_reserve(ble_tx_stream_t *stream, uint16_t max_len) {
+    return reserve(stream, max_len, portMAX_DELAY);
+}
+
+uint8_t *ble_tx_stream_try_reserve(ble_tx_stream_t *stream, uint16_t max_len) {
+    return reserve(stream, max_len, 0);
+}
+
+void ble_tx_stream_commit(ble_tx_stream_t *stream, uint16_t len) {
+    uint8_t *header = stream->ring.buffer + stream->ring.head;
+    write_header(header, len);
+    ring_buffer_advance_write(&stream->ring, BLE_TX_STREAM_HEADER_SIZE + len);
+    stream->commit_us[stream->stamp_head & STAMP_MASK] = (uint32_t)hal_get_time_us();
+    stream->stamp_head++;
+    TaskHandle_t consumer = stream->consumer;
+    xSemaphoreGive(stream->lock);
+    if (consumer != NULL) {
+        xTaskNotifyGive(consumer);
+    }
+}
+
+bool ble_tx_stream_write(ble_tx_stream_t *stream, const uint8_t *data, uint16_t len) {
+    uint8_t *payload = ble_tx_stream_reserve(stream, len);
+    if (payload == NULL) {
+        return false;
+    }
+    memcpy(payload, data, len);
+    ble_tx_stream_commit(stream, len);
+    return true;
+}
+
+bool ble_tx_stream_try_write(ble_tx_stream_t *stream, const uint8_t *data, uint16_t len) {
+    uint8_t *payload = ble_tx_stream_try_reserve(stream, len);
+    if (payload == NULL) {
+        return false;
+    }
+    memcpy(payload, data, len);
+    ble_tx_stream_commit(stream, len);
+    return true;
+}
+
+bool ble_tx_stream_peek(ble_tx_stream_t *stream, const uint8_t **frame, uint16_t *len) {
+    ring_buffer_t *rb = &stream->ring;
+    bool found = false;
+
+    xSemaphoreTake(stream->lock, portMAX_DELAY);
+    while (!found) {
+        uint32_t avail;
+        const uint8_t *region = (const uint8_t *)ring_buffer_get_read_region(rb, &avail);
+        if (region == NULL) {
+            break;
+        }
+        // Frames are committed whole, so a short or padded region is skipped end space
+        if (avail < BLE_TX_STREAM_HEADER_SIZE || read_header(region) == BLE_TX_STREAM_PAD) {
+            ring_buffer_advance_read(rb, avail);
+            continue;
+        }
+        *frame = region + BLE_TX_STREAM_HEADER_SIZE;
+        *len = read_header(region);
+        found = true;
+    }
+    xSemaphoreGive(stream->lock);
+    return found;
+}
+
+void ble_tx_stream_release(ble_tx_stream_t *stream, uint16_t len) {
+    xSemaphoreTake(stream->lock, portMAX_DELAY);
+    ring_buffer_advance_read(&stream->ring, BLE_TX_STREAM_HEADER_SIZE + len);
+    stream->stamp_tail++;
+    xSemaphoreGive(stream->lock);
+}
+
+uint16_t ble_tx_stream_peek_span(ble_tx_stream_t *stream,
+                                 uint16_t max_bytes,
+                                 const uint8_t **span,
+                                 bool *full) {
+    ring_buffer_t *rb = &stream->ring;
+    uint32_t len = 0;
+    *full = false;
+
+    xSemaphoreTake(stream->lock, portMAX_DELAY);
+    uint32_t avail;
+    const uint8_t *region = (const uint8_t *)ring_buffer_get_read_region(rb, &avail);
+    while (region != NULL) {
+        const uint8_t *p = region + len;
+        const uint32_t remaining = avail - len;
+        if (remaining == 0) {
+            break; // Caught up with the producers
+        }
+        if (remaining < BLE_TX_STREAM_HEADER_SIZE || read_header(p) == BLE_TX_STREAM_PAD) {
+            if (len > 0) {
+                *full = true; // Next frame is at the start of the buffer
+                break;
+            }
+            ring_buffer_advance_read(rb, avail);
+            region = (const uint8_t *)ring_buffer_get_read_region(rb, &avail);
+            continue;
+        }
+        const uint32_t frame_bytes = BLE_TX_STREAM_HEADER_SIZE + read_header(p);
+        if (len + frame_bytes > max_bytes) {
+            if (len > 0) {
+                *full = true;
+                break;
+            }
+            ring_buffer_advance_read(rb, frame_bytes);
+            stream->stamp_tail++;
+            stream->oversize++;
+            region = (const uint8_t *)ring_buffer_get_read_region(rb, &avail);
+            continue;
+        }
+        len += frame_bytes;
+    }
+    *span = region;
+    xSemaphoreGive(stream->lock);
+    return (uint16_t)len;
+}
+
+bool ble_tx_stream_oldest_commit(ble_tx_stream_t *stream, uint32_t *commit_us) {
+    xSemaphoreTake(stream->lock, portMAX_DELAY);
+    const bool pending = stream->stamp_head != stream->stamp_tail;
+    if (pending) {
+        *commit_us = stream->commit_us[stream->stamp_tail & STAMP_MASK];
+    }
+    xSemaphoreGive(stream->lock);
+    return pending;
+}
+
+void ble_tx_stream_release_span(ble_tx_stream_t *stream, uint16_t len) {
+    xSemaphoreTake(stream->lock, portMAX_DELAY);
+    // Drop the commit times of the frames in the span
+    uint32_t avail;
+    const uint8_t *region = (const uint8_t *)ring_buffer_get_read_region(&stream->ring, &avail);
+    for (uint32_t pos = 0; region != NULL && pos < len; pos += BLE_TX_STREAM_HEADER_SIZE + read_header(region + pos)) {
+        stream->stamp_tail++;
+    }
+    ring_buffer_advance_read(&stream->ring, len);
+    xSemaphoreGive(stream->lock);
+}
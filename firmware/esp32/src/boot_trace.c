@@ -0,0 +1,44 @@
+#include <freertos/FreeRTOS.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "boot_trace.h"
+
+#define TAG "CartelWorx-Boot"
+
+typedef struct {
+    const char *phase;
+    uint64_t time_us;
+} boot_trace_entry_t;
+
+static boot_trace_entry_t s_entries[BOOT_TRACE_MAX_PHASES];
+static uint8_t s_count;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_trace_mark(const char *phase) {
+    const uint64_t now_us = (uint64_t)esp_timer_get_time();
+    portENTER_CRITICAL(&s_lock);
+    if (s_count < BOOT_TRACE_MAX_PHASES) {
+        s_entries[s_count].phase = phase;
+        s_entries[s_count].time_us = now_us;
+        s_count++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void boot_trace_report(void) {
+    boot_trace_entry_t entries[BOOT_TRACE_MAX_PHASES];
+    portENTER_CRITICAL(&s_lock);
+    const uint8_t count = s_count;
+    for (uint8_t i = 0; i < count; i++) {
+        entries[i] = s_entries[i];
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    // Entries are in marking order; phases on different cores interleave
+    uint64_t prev_us = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "%8llu us (+%6llu) %s", (unsigned long long)entries[i].time_us,
+                 (unsigned long long)(entries[i].time_us - prev_us), entries[i].phase);
+        prev_us = entries[i].time_us;
+    }
+}
@@ -0,0 +1,167 @@
+#include <string.h>
+#include <math.h>
+#include "cylinder_health.h"
+
+#define PENDING_KNOCK (1 << 0)
+#define PENDING_STROKE (1 << 1)
+#define PENDING_BOTH (PENDING_KNOCK | PENDING_STROKE)
+#define WINDOW_MASK (CYL_HEALTH_WINDOW_CYCLES - 1)
+
+esp_err_t cylinder_health_init(cylinder_health_t *ch, uint8_t num_cylinders) {
+    if (num_cylinders < 2 || num_cylinders > KNOCK_MAX_CYLINDERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(ch, 0, sizeof(*ch));
+    ch->num_cylinders = num_cylinders;
+    return ESP_OK;
+}
+
+static void welford_update(cyl_health_welford_t *w, float x) {
+    w->count++;
+    const float delta = x - w->mean;
+    w->mean += delta / (float)w->count;
+    w->m2 += delta * (x - w->mean);
+}
+
+static inline int16_t clamp_i16(int32_t x) {
+    return (int16_t)((x > INT16_MAX) ? INT16_MAX : (x < INT16_MIN) ? INT16_MIN : x);
+}
+
+// Push one cycle's values into the rolling window, replacing the oldest once full
+static void window_push(cylinder_health_t *ch, cyl_health_cylinder_t *c, int16_t deviation_bp, uint16_t knock_q8) {
+    if (ch->fill == CYL_HEALTH_WINDOW_CYCLES) {
+        const int32_t old_dev = c->deviation_bp[ch->head];
+        c->deviation_sum -= old_dev;
+        c->deviation_sq_sum -= (int64_t)old_dev * old_dev;
+        c->knock_sum -= c->knock_q8[ch->head];
+    }
+    c->deviation_bp[ch->head] = deviation_bp;
+    c->knock_q8[ch->head] = knock_q8;
+    c->deviation_sum += deviation_bp;
+    c->deviation_sq_sum += (int64_t)deviation_bp * deviation_bp;
+    c->knock_sum += knock_q8;
+}
+
+// Rolling mean vs the since-start baseline, in standard errors of a full-window mean
+static bool drifted(const cyl_health_welford_t *base, float rolling_mean) {
+    if (base->count < CYL_HEALTH_MIN_BASELINE_CYCLES) {
+        return false;
+    }
+    const float base_var = base->m2 / (float)(base->count - 1);
+    const float shift = rolling_mean - base->mean;
+    return shift * shift > CYL_HEALTH_DRIFT_SIGMAS * CYL_HEALTH_DRIFT_SIGMAS * base_var / CYL_HEALTH_WINDOW_CYCLES;
+}
+
+static void score_cylinder(const cylinder_health_t *ch, const cyl_health_cylinder_t *c, cyl_health_score_t *out) {
+    const int32_t n = ch->fill;
+    const float mean = (float)c->deviation_sum / (float)n;
+    const float var = (float)c->deviation_sq_sum / (float)n - mean * mean;
+    out->imbalance_bp = clamp_i16((int32_t)lrintf(mean));
+    out->stability_bp = (uint16_t)((var > 0.0f) ? fminf(sqrtf(var), (float)UINT16_MAX) : 0.0f);
+    out->knock_q8 = (uint16_t)(c->knock_sum / (uint32_t)n);
+
+    out->flags = 0;
+    if (n < CYL_HEALTH_WINDOW_CYCLES) {
+        out->flags |= CYL_HEALTH_FLAG_PARTIAL;
+    }
+    if (out->imbalance_bp > CYL_HEALTH_IMBALANCE_LIMIT_BP || out->imbalance_bp < -CYL_HEALTH_IMBALANCE_LIMIT_BP) {
+        out->flags |= CYL_HEALTH_FLAG_IMBALANCE;
+    }
+    if (out->knock_q8 > CYL_HEALTH_KNOCK_LIMIT_Q8) {
+        out->flags |= CYL_HEALTH_FLAG_KNOCK;
+    }
+    if (n == CYL_HEALTH_WINDOW_CYCLES &&
+        (drifted(&c->deviation, mean) || drifted(&c->knock, (float)c->knock_sum / (float)n))) {
+        out->flags |= CYL_HEALTH_FLAG_DRIFT;
+    }
+}
+
+// All cylinders have a knock score and a stroke time: score the cycle
+static void complete_cycle(cylinder_health_t *ch) {
+    uint32_t stroke_sum = 0;
+    for (uint8_t i = 0; i < ch->num_cylinders; i++) {
+        stroke_sum += ch->cyl[i].pending_stroke_us;
+    }
+    const int64_t mean_us = stroke_sum / ch->num_cylinders;
+
+    if (ch->fill < CYL_HEALTH_WINDOW_CYCLES) {
+        ch->fill++;
+    }
+    for (uint8_t i = 0; i < ch->num_cylinders; i++) {
+        cyl_health_cylinder_t *c = &ch->cyl[i];
+        const int16_t deviation_bp = clamp_i16((int32_t)(((int64_t)c->pending_stroke_us - mean_us) * 10000 / mean_us));
+        window_push(ch, c, deviation_bp, c->pending_knock_q8);
+        welford_update(&c->deviation, deviation_bp);
+        welford_update(&c->knock, c->pending_knock_q8);
+        score_cylinder(ch, c, &ch->scores[i]);
+        c->pending = 0;
+    }
+    ch->head = (ch->head + 1) & WINDOW_MASK;
+    ch->cycles++;
+}
+
+static bool cycle_complete(const cylinder_health_t *ch) {
+    for (uint8_t i = 0; i < ch->num_cylinders; i++) {
+        if (ch->cyl[i].pending != PENDING_BOTH) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool cylinder_health_on_window(cylinder_health_t *ch, const knock_window_t *window, uint16_t knock_q8) {
+    if (window->cylinder < 1 || window->cylinder > ch->num_cylinders) {
+        return false;
+    }
+
+    // The stroke ending at this TDC belongs to the previous cylinder, and the
+    // last one of a cycle arrives with the next cycle's first window: apply
+    // it and score before this window's knock starts the new cycle
+    const uint32_t cycles = ch->cycles;
+    if (window->stroke_cylinder >= 1 && window->stroke_cylinder <= ch->num_cylinders && window->stroke_us != 0) {
+        if (window->stroke_us > CYL_HEALTH_MAX_STROKE_US) {
+            // Not running steadily: start the cycle over rather than mix in a stall
+            for (uint8_t i = 0; i < ch->num_cylinders; i++) {
+                ch->cyl[i].pending = 0;
+            }
+        } else {
+            cyl_health_cylinder_t *s = &ch->cyl[window->stroke_cylinder - 1];
+            s->pending_stroke_us = window->stroke_us;
+            s->pending |= PENDING_STROKE;
+            if (cycle_complete(ch)) {
+                complete_cycle(ch);
+            }
+        }
+    }
+
+    cyl_health_cylinder_t *c = &ch->cyl[window->cylinder - 1];
+    c->pending_knock_q8 = knock_q8;
+    c->pending |= PENDING_KNOCK;
+    return ch->cycles != cycles;
+}
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)(v >> 8);
+}
+
+uint16_t cylinder_health_encode(const cylinder_health_t *ch, uint8_t *out, uint16_t capacity) {
+    const uint16_t len = CYL_HEALTH_PAYLOAD_HEADER_SIZE + ch->num_cylinders * CYL_HEALTH_PAYLOAD_CYL_SIZE;
+    if (capacity < len) {
+        return 0;
+    }
+    for (int i = 0; i < 4; i++) {
+        out[i] = (uint8_t)(ch->cycles >> (8 * i));
+    }
+    out[4] = ch->num_cylinders;
+    uint8_t *p = out + CYL_HEALTH_PAYLOAD_HEADER_SIZE;
+    for (uint8_t i = 0; i < ch->num_cylinders; i++) {
+        const cyl_health_score_t *s = &ch->scores[i];
+        put_u16(&p[0], (uint16_t)s->imbalance_bp);
+        put_u16(&p[2], s->stability_bp);
+        put_u16(&p[4], s->knock_q8);
+        p[6] = s->flags;
+        p += CYL_HEALTH_PAYLOAD_CYL_SIZE;
+    }
+    return len;
+}
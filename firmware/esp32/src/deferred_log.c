@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "ring_buffer.h"
+#include "deferred_log.h"
+
+#define TAG "CartelWorx-Log"
+#define DEFERRED_LOG_CORES 2
+
+static const char *const s_formats[DLOG_FORMAT_COUNT] = {
+#define DEFERRED_LOG_STRING(id, fmt) fmt,
+    DEFERRED_LOG_FORMATS(DEFERRED_LOG_STRING)
+#undef DEFERRED_LOG_STRING
+};
+
+static DRAM_ATTR uint8_t s_storage[DEFERRED_LOG_CORES][DEFERRED_LOG_RING_RECORDS * sizeof(deferred_log_record_t)];
+static DRAM_ATTR ring_buffer_spsc_t s_rings[DEFERRED_LOG_CORES];
+
+void deferred_log_init(void) {
+    for (uint8_t core = 0; core < DEFERRED_LOG_CORES; core++) {
+        ring_buffer_spsc_init(&s_rings[core], s_storage[core], sizeof(s_storage[core]), sizeof(deferred_log_record_t));
+    }
+}
+
+void IRAM_ATTR deferred_log_write(deferred_log_id_t id, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+    deferred_log_record_t rec;
+    rec.timestamp_us = (uint32_t)esp_timer_get_time();
+    rec.id = (uint16_t)id;
+    rec.nargs = nargs;
+    rec.args[0] = a0;
+    rec.args[1] = a1;
+    rec.args[2] = a2;
+    rec.args[3] = a3;
+
+    // Masked, nothing else on this core can push, and the task cannot migrate
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+    rec.core = (uint8_t)esp_cpu_get_core_id();
+    ring_buffer_spsc_push(&s_rings[rec.core], &rec);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+uint32_t deferred_log_get_dropped(void) {
+    uint32_t dropped = 0;
+    for (uint8_t core = 0; core < DEFERRED_LOG_CORES; core++) {
+        dropped += s_rings[core].overflows;
+    }
+    return dropped;
+}
+
+static void format_record(const deferred_log_record_t *rec) {
+    if (rec->id >= DLOG_FORMAT_COUNT) {
+        ESP_LOGW(TAG, "[%lu] unknown record %u", (unsigned long)rec->timestamp_us, rec->id);
+        return;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), s_formats[rec->id],
+             (unsigned long)rec->args[0], (unsigned long)rec->args[1],
+             (unsigned long)rec->args[2], (unsigned long)rec->args[3]);
+    ESP_LOGI(TAG, "[%lu us, core %u] %s", (unsigned long)rec->timestamp_us, rec->core, line);
+}
+
+void deferred_log_task(void *pvParameters) {
+    uint32_t reported_dropped = 0;
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(DEFERRED_LOG_DRAIN_PERIOD_MS));
+        for (uint8_t core = 0; core < DEFERRED_LOG_CORES; core++) {
+            deferred_log_record_t rec;
+            while (ring_buffer_spsc_pop(&s_rings[core], &rec)) {
+                format_record(&rec);
+            }
+        }
+        uint32_t dropped = deferred_log_get_dropped();
+        if (dropped != reported_dropped) {
+            ESP_LOGW(TAG, "%lu records dropped", (unsigned long)(dropped - reported_dropped));
+            reported_dropped = dropped;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#include <freertos/FreeRTOS.h>
+#include <esp_attr.h>
+#include "engine_state.h"
+
+// Odd while an update is in progress; plain stores in between are ordered by the fences
+typedef struct {
+    uint32_t sequence;
+    engine_crank_state_t state;
+} crank_part_t;
+
+typedef struct {
+    uint32_t sequence;
+    engine_obd_state_t state;
+} obd_part_t;
+
+static DRAM_ATTR crank_part_t s_crank;
+static DRAM_ATTR obd_part_t s_obd;
+
+// Forced inline: engine_state_publish_crank() runs in the crank ISR, out of IRAM
+static inline __attribute__((always_inline)) void seqlock_write_begin(uint32_t *sequence) {
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline __attribute__((always_inline)) void seqlock_write_end(uint32_t *sequence) {
+    __atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+void engine_state_init(void) {
+    s_crank = (crank_part_t){0};
+    s_obd = (obd_part_t){0};
+}
+
+void IRAM_ATTR engine_state_publish_crank(uint16_t rpm, uint8_t cylinder, uint64_t tdc_us) {
+    UBaseType_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+    seqlock_write_begin(&s_crank.sequence);
+    s_crank.state.tdc_us = tdc_us;
+    s_crank.state.tdc_count++;
+    s_crank.state.rpm = rpm;
+    s_crank.state.cylinder = cylinder;
+    seqlock_write_end(&s_crank.sequence);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+}
+
+void engine_state_publish_obd(const engine_obd_state_t *obd) {
+    UBaseType_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+    seqlock_write_begin(&s_obd.sequence);
+    s_obd.state = *obd;
+    seqlock_write_end(&s_obd.sequence);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+}
+
+void IRAM_ATTR engine_state_read_obd(engine_obd_state_t *out) {
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(&s_obd.sequence, __ATOMIC_ACQUIRE);
+        *out = s_obd.state;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&s_obd.sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+}
+
+void IRAM_ATTR engine_state_read(engine_state_t *out) {
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(&s_crank.sequence, __ATOMIC_ACQUIRE);
+        out->crank = s_crank.state;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&s_crank.sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+    engine_state_read_obd(&out->obd);
+}
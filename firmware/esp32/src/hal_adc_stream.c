@@ -0,0 +1,168 @@
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_adc/adc_continuous.h>
+#include "hal.h"
+
+#define TAG "CartelWorx-ADC"
+
+// ============================================================================
+// Continuous knock sensor acquisition over the ADC digital controller (DMA)
+//
+// The driver's DMA pool holds two conversion frames, one being filled while
+// the other waits for the consumer. Once a frame completes, the ISR records
+// its timestamp and invokes the registered callback; the consumer then copies
+// the frame out in one driver call and unpacks it into one of two sample
+// blocks, so the block handed back stays valid while the next one is read.
+// ============================================================================
+
+static adc_continuous_handle_t s_adc_handle = NULL;
+static hal_adc_block_ready_cb_t s_block_cb = NULL;
+
+static uint8_t s_raw_frame[HAL_ADC_KNOCK_STREAM_MAX_BLOCK * SOC_ADC_DIGI_RESULT_BYTES];
+static uint16_t s_blocks[2][HAL_ADC_KNOCK_STREAM_MAX_BLOCK];
+static uint8_t s_active_block = 0;
+
+static uint16_t s_block_len = 0;
+static uint32_t s_block_period_us = 0;
+
+// Written by the DMA ISR, read by the consumer task
+static volatile uint32_t s_blocks_done = 0;
+static volatile uint64_t s_last_block_us = 0;
+static volatile uint32_t s_overruns = 0;
+static uint32_t s_blocks_read = 0;
+
+static bool IRAM_ATTR adc_conv_done_isr(adc_continuous_handle_t handle,
+                                        const adc_continuous_evt_data_t *edata,
+                                        void *user_data) {
+    s_last_block_us = (uint64_t)esp_timer_get_time();
+    s_blocks_done++;
+    return (s_block_cb != NULL) ? s_block_cb() : false;
+}
+
+static bool IRAM_ATTR adc_pool_ovf_isr(adc_continuous_handle_t handle,
+                                       const adc_continuous_evt_data_t *edata,
+                                       void *user_data) {
+    s_overruns++;
+    return false;
+}
+
+esp_err_t hal_adc_knock_start_stream(uint32_t rate_hz,
+                                     uint16_t block_len,
+                                     hal_adc_block_ready_cb_t cb) {
+    if (s_adc_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (rate_hz < HAL_ADC_KNOCK_STREAM_RATE_MIN_HZ ||
+        rate_hz > HAL_ADC_KNOCK_STREAM_RATE_MAX_HZ ||
+        block_len == 0 || block_len > HAL_ADC_KNOCK_STREAM_MAX_BLOCK ||
+        (block_len % 2) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint32_t frame_bytes = (uint32_t)block_len * SOC_ADC_DIGI_RESULT_BYTES;
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = frame_bytes * 2, // Double-buffered DMA pool
+        .conv_frame_size = frame_bytes,
+    };
+    esp_err_t err = adc_continuous_new_handle(&handle_cfg, &s_adc_handle);
+    if (err != ESP_OK) {
+        s_adc_handle = NULL;
+        return err;
+    }
+
+    adc_digi_pattern_config_t pattern = {
+        .atten = ADC_ATTEN_DB_11,
+        .channel = HAL_ADC_KNOCK_SENSOR_CHANNEL,
+        .unit = ADC_UNIT_1,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = rate_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = adc_conv_done_isr,
+        .on_pool_ovf = adc_pool_ovf_isr,
+    };
+
+    s_block_cb = cb;
+    s_block_len = block_len;
+    s_block_period_us = (uint32_t)(((uint64_t)block_len * 1000000ULL) / rate_hz);
+    s_blocks_done = 0;
+    s_blocks_read = 0;
+    s_overruns = 0;
+
+    err = adc_continuous_config(s_adc_handle, &dig_cfg);
+    if (err == ESP_OK) {
+        err = adc_continuous_register_event_callbacks(s_adc_handle, &cbs, NULL);
+    }
+    if (err == ESP_OK) {
+        err = adc_continuous_start(s_adc_handle);
+    }
+    if (err != ESP_OK) {
+        adc_continuous_deinit(s_adc_handle);
+        s_adc_handle = NULL;
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Knock stream started: %lu Hz, %u samples/block (%lu us)",
+             (unsigned long)rate_hz, block_len, (unsigned long)s_block_period_us);
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_knock_stop_stream(void) {
+    if (s_adc_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    adc_continuous_stop(s_adc_handle);
+    esp_err_t err = adc_continuous_deinit(s_adc_handle);
+    s_adc_handle = NULL;
+    s_block_cb = NULL;
+    return err;
+}
+
+esp_err_t hal_adc_knock_get_block(const uint16_t **samples,
+                                  uint16_t *count,
+                                  uint64_t *timestamp_us) {
+    if (s_adc_handle == NULL || samples == NULL || count == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t out_bytes = 0;
+    esp_err_t err = adc_continuous_read(s_adc_handle, s_raw_frame,
+                                        (uint32_t)s_block_len * SOC_ADC_DIGI_RESULT_BYTES,
+                                        &out_bytes, 0);
+    if (err != ESP_OK) {
+        return ESP_ERR_TIMEOUT;
+    }
+    s_blocks_read++;
+
+    // Unpack into the block the caller is not holding
+    s_active_block ^= 1;
+    uint16_t *block = s_blocks[s_active_block];
+    uint16_t n = 0;
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= out_bytes; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&s_raw_frame[i];
+        if (p->type1.channel == HAL_ADC_KNOCK_SENSOR_CHANNEL) {
+            block[n++] = p->type1.data;
+        }
+    }
+
+    if (timestamp_us != NULL) {
+        // Frames still queued behind this one finished one block period apart
+        uint32_t pending = s_blocks_done - s_blocks_read;
+        *timestamp_us = s_last_block_us - (uint64_t)pending * s_block_period_us;
+    }
+    *samples = block;
+    *count = n;
+    return ESP_OK;
+}
+
+uint32_t hal_adc_knock_get_overrun_count(void) {
+    return s_overruns;
+}
@@ -0,0 +1,432 @@
+#include <string.h>
+#include <sdkconfig.h>
+
+#if CONFIG_BT_BLUEDROID_ENABLED
+
+#include <esp_log.h>
+#include <esp_bt.h>
+#include <esp_bt_main.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gatts_api.h>
+#include <esp_gatt_common_api.h>
+#include "hal.h"
+
+#define TAG "CartelWorx-BLE"
+
+// ============================================================================
+// BLE GATT server on the Bluedroid host
+//
+// Bluedroid builds the attribute table one call at a time: each characteristic
+// is added from the completion event of the previous one, and the service is
+// started after the last. All callbacks run on the Bluedroid BTC task.
+// ============================================================================
+
+#define BLE_GATT_NUM_HANDLES 12  // Service + 4 characteristics (declaration, value) + stream CCCD, with slack
+#define BLE_ADV_CONFIG_DATA (1 << 0)
+#define BLE_ADV_CONFIG_SCAN_RSP (1 << 1)
+
+// Not const: the Bluedroid GATT API takes non-const UUID pointers
+static uint8_t s_service_uuid128[ESP_UUID_LEN_128] = HAL_BLE_UUID128(HAL_BLE_SERVICE_UUID_ID);
+
+static const struct {
+    esp_gatt_perm_t perm;
+    esp_gatt_char_prop_t prop;
+} s_char_defs[HAL_BLE_CHAR_COUNT] = {
+    [HAL_BLE_CHAR_STREAM] = {ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY},
+    [HAL_BLE_CHAR_COMMAND] = {ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_WRITE_NR},
+    [HAL_BLE_CHAR_LATENCY] = {ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ},
+    [HAL_BLE_CHAR_STATS] = {ESP_GATT_PERM_READ, ESP_GATT_CHAR_PROP_BIT_READ},
+};
+
+static hal_ble_callbacks_t s_callbacks;
+static esp_gatt_if_t s_gatt_if = ESP_GATT_IF_NONE;
+static uint16_t s_service_handle;
+static uint16_t s_char_handles[HAL_BLE_CHAR_COUNT];
+static uint16_t s_cccd_handle;
+static uint16_t s_cccd_value;
+static hal_ble_char_t s_adding; // Characteristic whose ADD_CHAR_EVT is awaited
+static uint16_t s_conn_id;
+static esp_bd_addr_t s_peer_addr;
+static volatile bool s_connected = false;
+static volatile bool s_congested = false;
+static uint16_t s_mtu = HAL_BLE_DEFAULT_MTU;
+static hal_ble_link_params_t s_link;
+static bool s_conn_fallback_sent = false;
+static uint8_t s_adv_config_pending = BLE_ADV_CONFIG_DATA | BLE_ADV_CONFIG_SCAN_RSP;
+static bool s_advertise = false;
+
+// Value of the read in progress: a long read's Read Blob pages come from it
+static uint8_t s_read_snapshot[HAL_BLE_READ_MAX];
+static uint16_t s_read_handle; // 0 = none
+static uint16_t s_read_len;
+
+// Service UUID in the advertisement, name in the scan response: both do not fit in 31 bytes
+static esp_ble_adv_data_t s_adv_data = {
+    .set_scan_rsp = false,
+    .include_name = false,
+    .service_uuid_len = ESP_UUID_LEN_128,
+    .p_service_uuid = s_service_uuid128,
+    .flag = ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT,
+};
+
+static esp_ble_adv_data_t s_scan_rsp_data = {
+    .set_scan_rsp = true,
+    .include_name = true,
+};
+
+static esp_ble_adv_params_t s_adv_params = {
+    .adv_int_min = HAL_BLE_ADV_INTERVAL_MIN,
+    .adv_int_max = HAL_BLE_ADV_INTERVAL_MAX,
+    .adv_type = ADV_TYPE_IND,
+    .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+    .channel_map = ADV_CHNL_ALL,
+    .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+static hal_ble_char_t char_for_handle(uint16_t handle) {
+    for (int chr = 0; chr < HAL_BLE_CHAR_COUNT; chr++) {
+        if (s_char_handles[chr] == handle) {
+            return (hal_ble_char_t)chr;
+        }
+    }
+    return HAL_BLE_CHAR_COUNT;
+}
+
+static void add_char(hal_ble_char_t chr) {
+    esp_bt_uuid_t uuid = {.len = ESP_UUID_LEN_128, .uuid = {.uuid128 = HAL_BLE_UUID128(HAL_BLE_CHAR_UUID_ID(chr))}};
+    s_adding = chr;
+    esp_ble_gatts_add_char(s_service_handle, &uuid, s_char_defs[chr].perm, s_char_defs[chr].prop, NULL, NULL);
+}
+
+static void add_next_char(void) {
+    if (s_adding + 1 < HAL_BLE_CHAR_COUNT) {
+        add_char((hal_ble_char_t)(s_adding + 1));
+    } else {
+        esp_ble_gatts_start_service(s_service_handle);
+    }
+}
+
+// Ask for a short connection interval, maximum LL data length and (where the
+// controller has it) the 2M PHY; each request is optional for the client
+static void request_stream_profile(uint16_t interval_max) {
+    esp_ble_conn_update_params_t conn_params = {0};
+    memcpy(conn_params.bda, s_peer_addr, sizeof(esp_bd_addr_t));
+    conn_params.min_int = HAL_BLE_STREAM_CONN_INTERVAL_MIN;
+    conn_params.max_int = interval_max;
+    conn_params.latency = 0;
+    conn_params.timeout = HAL_BLE_STREAM_SUPERVISION_TIMEOUT;
+    if (esp_ble_gap_update_conn_params(&conn_params) != ESP_OK) {
+        ESP_LOGW(TAG, "Connection parameter request failed");
+    }
+}
+
+static void start_link_negotiation(void) {
+    s_conn_fallback_sent = false;
+    request_stream_profile(HAL_BLE_STREAM_CONN_INTERVAL_MAX);
+    if (esp_ble_gap_set_pkt_data_len(s_peer_addr, HAL_BLE_MAX_LL_OCTETS) != ESP_OK) {
+        ESP_LOGW(TAG, "Data length request failed, staying at %u octets", s_link.tx_octets);
+    }
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    if (esp_ble_gap_set_preferred_phy(s_peer_addr, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                      ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_OPTIONS_NO_PREF) != ESP_OK) {
+        ESP_LOGW(TAG, "2M PHY request failed, staying on 1M");
+    }
+#endif
+}
+
+static void handle_read(esp_gatt_if_t gatts_if, const struct gatts_read_evt_param *read) {
+    if (!read->need_rsp) {
+        return;
+    }
+    static esp_gatt_rsp_t rsp;
+    // A read at offset 0 takes a new snapshot; Read Blob pages of the same
+    // attribute are served from it, so a long read is one coherent value
+    if (read->offset == 0 || read->handle != s_read_handle) {
+        uint16_t len = 0;
+        if (read->handle == s_cccd_handle) {
+            s_read_snapshot[0] = (uint8_t)(s_cccd_value & 0xFF);
+            s_read_snapshot[1] = (uint8_t)(s_cccd_value >> 8);
+            len = 2;
+        } else {
+            const hal_ble_char_t chr = char_for_handle(read->handle);
+            if (chr != HAL_BLE_CHAR_COUNT && s_callbacks.on_read != NULL) {
+                len = s_callbacks.on_read(chr, s_read_snapshot, sizeof(s_read_snapshot));
+            }
+        }
+        s_read_handle = read->handle;
+        s_read_len = len;
+    }
+    const uint16_t len = s_read_len;
+    const uint16_t offset = (read->offset < len) ? read->offset : len;
+    uint16_t chunk = len - offset;
+    if (chunk > s_mtu - 1) {
+        chunk = s_mtu - 1;
+    }
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.attr_value.handle = read->handle;
+    rsp.attr_value.offset = offset;
+    rsp.attr_value.len = chunk;
+    memcpy(rsp.attr_value.value, s_read_snapshot + offset, chunk);
+    esp_ble_gatts_send_response(gatts_if, read->conn_id, read->trans_id, ESP_GATT_OK, &rsp);
+}
+
+static void handle_write(esp_gatt_if_t gatts_if, const struct gatts_write_evt_param *write) {
+    esp_gatt_status_t status = ESP_GATT_OK;
+    if (write->is_prep) {
+        status = ESP_GATT_REQ_NOT_SUPPORTED; // Commands fit in one ATT write
+    } else if (write->handle == s_cccd_handle && write->len == 2) {
+        s_cccd_value = (uint16_t)write->value[0] | ((uint16_t)write->value[1] << 8);
+        ESP_LOGI(TAG, "Stream notifications %s", (s_cccd_value & 0x0001) ? "enabled" : "disabled");
+    } else {
+        const hal_ble_char_t chr = char_for_handle(write->handle);
+        if (chr != HAL_BLE_CHAR_COUNT && s_callbacks.on_write != NULL) {
+            s_callbacks.on_write(chr, write->value, write->len);
+        }
+    }
+    if (write->need_rsp) {
+        esp_ble_gatts_send_response(gatts_if, write->conn_id, write->trans_id, status, NULL);
+    }
+}
+
+static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param) {
+    switch (event) {
+    case ESP_GATTS_REG_EVT:
+        ESP_LOGI(TAG, "GATT Server registered");
+        s_gatt_if = gatts_if;
+        {
+            esp_gatt_srvc_id_t service_id = {0};
+            service_id.is_primary = true;
+            service_id.id.inst_id = 0;
+            service_id.id.uuid.len = ESP_UUID_LEN_128;
+            memcpy(service_id.id.uuid.uuid.uuid128, s_service_uuid128, ESP_UUID_LEN_128);
+            esp_ble_gatts_create_service(gatts_if, &service_id, BLE_GATT_NUM_HANDLES);
+        }
+        break;
+    case ESP_GATTS_CREATE_EVT:
+        s_service_handle = param->create.service_handle;
+        ESP_LOGI(TAG, "Service created: handle=0x%x", s_service_handle);
+        add_char(HAL_BLE_CHAR_STREAM);
+        break;
+    case ESP_GATTS_ADD_CHAR_EVT:
+        s_char_handles[s_adding] = param->add_char.attr_handle;
+        ESP_LOGI(TAG, "Characteristic 0x%02X added: handle=0x%x", HAL_BLE_CHAR_UUID_ID(s_adding),
+                 param->add_char.attr_handle);
+        if (s_adding == HAL_BLE_CHAR_STREAM) {
+            // Clients subscribe through the CCCD; Bluedroid does not add it implicitly
+            esp_bt_uuid_t cccd_uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG}};
+            esp_ble_gatts_add_char_descr(s_service_handle, &cccd_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                         NULL, NULL);
+        } else {
+            add_next_char();
+        }
+        break;
+    case ESP_GATTS_ADD_CHAR_DESCR_EVT:
+        s_cccd_handle = param->add_char_descr.attr_handle;
+        add_next_char();
+        break;
+    case ESP_GATTS_START_EVT:
+        ESP_LOGI(TAG, "Service started");
+        break;
+    case ESP_GATTS_READ_EVT:
+        handle_read(gatts_if, &param->read);
+        break;
+    case ESP_GATTS_WRITE_EVT:
+        handle_write(gatts_if, &param->write);
+        break;
+    case ESP_GATTS_CONNECT_EVT:
+        s_conn_id = param->connect.conn_id;
+        memcpy(s_peer_addr, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+        s_link.conn_interval = param->connect.conn_params.interval;
+        s_link.latency = param->connect.conn_params.latency;
+        s_link.supervision_timeout = param->connect.conn_params.timeout;
+        s_link.tx_octets = HAL_BLE_DEFAULT_LL_OCTETS;
+        s_link.phy = 1;
+        s_cccd_value = 0;
+        s_read_handle = 0;
+        s_connected = true;
+        ESP_LOGI(TAG, "Client connected: conn_id=%u, interval=%u x 1.25 ms", s_conn_id, s_link.conn_interval);
+        if (s_callbacks.on_connect != NULL) {
+            s_callbacks.on_connect();
+        }
+        start_link_negotiation();
+        break;
+    case ESP_GATTS_DISCONNECT_EVT:
+        s_connected = false;
+        s_congested = false;
+        s_mtu = HAL_BLE_DEFAULT_MTU;
+        ESP_LOGI(TAG, "Client disconnected (reason 0x%x)", param->disconnect.reason);
+        if (s_callbacks.on_disconnect != NULL) {
+            s_callbacks.on_disconnect();
+        }
+        if (s_advertise) {
+            esp_ble_gap_start_advertising(&s_adv_params);
+        }
+        break;
+    case ESP_GATTS_MTU_EVT:
+        s_mtu = param->mtu.mtu;
+        ESP_LOGI(TAG, "MTU negotiated: %u", s_mtu);
+        break;
+    case ESP_GATTS_CONGEST_EVT:
+        // Stack TX buffers full: the caller holds frames until it drains
+        s_congested = param->congest.congested;
+        if (!s_congested && s_callbacks.on_tx_ready != NULL) {
+            s_callbacks.on_tx_ready();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
+    switch (event) {
+    case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+    case ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT:
+        s_adv_config_pending &= (event == ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT) ?
+                                ~BLE_ADV_CONFIG_DATA : ~BLE_ADV_CONFIG_SCAN_RSP;
+        if (s_adv_config_pending == 0 && s_advertise && !s_connected) {
+            esp_ble_gap_start_advertising(&s_adv_params);
+        }
+        break;
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+        if (param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+            ESP_LOGW(TAG, "Advertising start failed (status %d)", param->adv_start_cmpl.status);
+        }
+        break;
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+        if (param->update_conn_params.status != ESP_BT_STATUS_SUCCESS) {
+            // Client refused 7.5-15 ms: retry once with a wider window, then keep its choice
+            if (!s_conn_fallback_sent && s_connected) {
+                s_conn_fallback_sent = true;
+                ESP_LOGW(TAG, "Streaming interval rejected (status %d), retrying up to 30 ms",
+                         param->update_conn_params.status);
+                request_stream_profile(HAL_BLE_FALLBACK_CONN_INTERVAL_MAX);
+            }
+            break;
+        }
+        s_link.conn_interval = param->update_conn_params.conn_int;
+        s_link.latency = param->update_conn_params.latency;
+        s_link.supervision_timeout = param->update_conn_params.timeout;
+        ESP_LOGI(TAG, "Connection interval %u x 1.25 ms, latency %u, timeout %u x 10 ms",
+                 s_link.conn_interval, s_link.latency, s_link.supervision_timeout);
+        break;
+    case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+        if (param->pkt_data_length_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+            s_link.tx_octets = param->pkt_data_length_cmpl.params.tx_len;
+        }
+        ESP_LOGI(TAG, "LL data length: tx %u, rx %u octets", param->pkt_data_length_cmpl.params.tx_len,
+                 param->pkt_data_length_cmpl.params.rx_len);
+        break;
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+    case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+        if (param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+            s_link.phy = param->phy_update.tx_phy;
+        }
+        ESP_LOGI(TAG, "PHY: tx %u, rx %u", param->phy_update.tx_phy, param->phy_update.rx_phy);
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+esp_err_t hal_ble_init(const hal_ble_callbacks_t *callbacks) {
+    if (callbacks != NULL) {
+        s_callbacks = *callbacks;
+    }
+
+    esp_err_t err = esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
+    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+    if (err == ESP_OK) {
+        err = esp_bt_controller_init(&bt_cfg);
+    }
+    if (err == ESP_OK) {
+        err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+    }
+    if (err == ESP_OK) {
+        err = esp_bluedroid_init();
+    }
+    if (err == ESP_OK) {
+        err = esp_bluedroid_enable();
+    }
+    if (err == ESP_OK) {
+        err = esp_ble_gap_register_callback(gap_event_handler);
+    }
+    if (err == ESP_OK) {
+        err = esp_ble_gatts_register_callback(gatts_event_handler);
+    }
+    if (err == ESP_OK) {
+        err = esp_ble_gatts_app_register(0);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Bluedroid init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Configure MTU for high-speed data streaming
+    esp_ble_gatt_set_local_mtu(HAL_BLE_MTU_SIZE);
+    esp_ble_gap_set_device_name(HAL_BLE_DEVICE_NAME);
+    esp_ble_gap_config_adv_data(&s_adv_data);
+    esp_ble_gap_config_adv_data(&s_scan_rsp_data);
+    ESP_LOGI(TAG, "Bluedroid host ready");
+    return ESP_OK;
+}
+
+esp_err_t hal_ble_start_advertising(void) {
+    s_advertise = true;
+    if (s_adv_config_pending != 0 || s_connected) {
+        return ESP_OK; // Started once the advertising data is set, or on disconnect
+    }
+    return esp_ble_gap_start_advertising(&s_adv_params);
+}
+
+esp_err_t hal_ble_stop_advertising(void) {
+    s_advertise = false;
+    return esp_ble_gap_stop_advertising();
+}
+
+uint16_t hal_ble_get_char_handle(hal_ble_char_t chr) {
+    return (chr < HAL_BLE_CHAR_COUNT) ? s_char_handles[chr] : 0;
+}
+
+esp_err_t hal_ble_send_notify(uint16_t characteristic_handle,
+                               const uint8_t *data,
+                               uint16_t length,
+                               bool is_notification) {
+    if (!s_connected || s_gatt_if == ESP_GATT_IF_NONE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_congested) {
+        return ESP_ERR_NO_MEM;
+    }
+    // Bluedroid copies the value, so the caller's buffer may be reused at once
+    return esp_ble_gatts_send_indicate(s_gatt_if, s_conn_id, characteristic_handle, length,
+                                       (uint8_t *)data, !is_notification);
+}
+
+bool hal_ble_is_connected(void) {
+    return s_connected;
+}
+
+bool hal_ble_is_congested(void) {
+    return s_congested;
+}
+
+uint16_t hal_ble_get_mtu(void) {
+    return s_mtu;
+}
+
+esp_err_t hal_ble_request_mtu(uint16_t desired_mtu) {
+    // As a server Bluedroid only advertises its limit; the client starts the exchange
+    return esp_ble_gatt_set_local_mtu(desired_mtu);
+}
+
+esp_err_t hal_ble_get_link_params(hal_ble_link_params_t *out) {
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *out = s_link;
+    return ESP_OK;
+}
+
+#endif // CONFIG_BT_BLUEDROID_ENABLED
@@ -0,0 +1,418 @@
+#include <string.h>
+#include <sdkconfig.h>
+
+#if CONFIG_BT_NIMBLE_ENABLED
+
+#include <esp_log.h>
+#include <nimble/nimble_port.h>
+#include <nimble/nimble_port_freertos.h>
+#include <host/ble_hs.h>
+#include <host/ble_hs_hci.h>
+#include <host/util/util.h>
+#include <services/gap/ble_svc_gap.h>
+#include <services/gatt/ble_svc_gatt.h>
+#include "hal.h"
+
+#define TAG "CartelWorx-BLE"
+
+// ============================================================================
+// BLE GATT server on the NimBLE host
+//
+// Same service, characteristics and UUIDs as the Bluedroid build, for less
+// RAM and CPU: the attribute table is a static definition registered in one
+// call, and the host runs as a single task. Notifications are copied into
+// host mbufs; running out of them is the congestion signal, cleared when a
+// queued notification is sent.
+// ============================================================================
+
+#define BLE_LL_MAX_TX_TIME_US 2120  // 251 octets on the LE 1M PHY
+
+static const ble_uuid128_t s_service_uuid = {
+    .u = {.type = BLE_UUID_TYPE_128},
+    .value = HAL_BLE_UUID128(HAL_BLE_SERVICE_UUID_ID),
+};
+
+static const ble_uuid128_t s_char_uuids[HAL_BLE_CHAR_COUNT] = {
+    [HAL_BLE_CHAR_STREAM] = {.u = {.type = BLE_UUID_TYPE_128},
+                             .value = HAL_BLE_UUID128(HAL_BLE_CHAR_UUID_ID(HAL_BLE_CHAR_STREAM))},
+    [HAL_BLE_CHAR_COMMAND] = {.u = {.type = BLE_UUID_TYPE_128},
+                              .value = HAL_BLE_UUID128(HAL_BLE_CHAR_UUID_ID(HAL_BLE_CHAR_COMMAND))},
+    [HAL_BLE_CHAR_LATENCY] = {.u = {.type = BLE_UUID_TYPE_128},
+                              .value = HAL_BLE_UUID128(HAL_BLE_CHAR_UUID_ID(HAL_BLE_CHAR_LATENCY))},
+    [HAL_BLE_CHAR_STATS] = {.u = {.type = BLE_UUID_TYPE_128},
+                            .value = HAL_BLE_UUID128(HAL_BLE_CHAR_UUID_ID(HAL_BLE_CHAR_STATS))},
+};
+
+static hal_ble_callbacks_t s_callbacks;
+static uint16_t s_char_handles[HAL_BLE_CHAR_COUNT];
+static uint16_t s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+static volatile bool s_connected = false;
+static volatile bool s_congested = false;
+static uint16_t s_mtu = HAL_BLE_DEFAULT_MTU;
+static hal_ble_link_params_t s_link;
+static bool s_conn_fallback_sent = false;
+static uint8_t s_own_addr_type;
+static bool s_synced = false;
+static bool s_advertise = false;
+static uint8_t s_value_buf[HAL_BLE_READ_MAX]; // Host task only
+
+// Value of the read in progress (host task only). The access callback is
+// not told the offset, so the pages of a long read are predicted instead:
+// each response carries MTU - 1 bytes, and while the previous read of the
+// same characteristic has bytes left, the next read is its continuation
+// (a client that abandons a long read gets that value once more).
+static uint8_t s_read_snapshot[HAL_BLE_READ_MAX];
+static hal_ble_char_t s_read_chr = HAL_BLE_CHAR_COUNT; // COUNT = none
+static uint16_t s_read_len;
+static uint16_t s_read_sent;   // Bytes of the snapshot the client has been sent
+
+static int chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                      struct ble_gatt_access_ctxt *ctxt, void *arg);
+static int gap_event(struct ble_gap_event *event, void *arg);
+
+#define BLE_CHR(chr, chr_flags)                        \
+    {                                                  \
+        .uuid = &s_char_uuids[chr].u,                  \
+        .access_cb = chr_access,                       \
+        .arg = (void *)(uintptr_t)(chr),               \
+        .flags = (chr_flags),                          \
+        .val_handle = &s_char_handles[chr],            \
+    }
+
+// The stream characteristic's CCCD is added by the host for BLE_GATT_CHR_F_NOTIFY
+static const struct ble_gatt_chr_def s_chars[] = {
+    BLE_CHR(HAL_BLE_CHAR_STREAM, BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY),
+    BLE_CHR(HAL_BLE_CHAR_COMMAND, BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP),
+    BLE_CHR(HAL_BLE_CHAR_LATENCY, BLE_GATT_CHR_F_READ),
+    BLE_CHR(HAL_BLE_CHAR_STATS, BLE_GATT_CHR_F_READ),
+    {0},
+};
+
+static const struct ble_gatt_svc_def s_services[] = {
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = &s_service_uuid.u,
+        .characteristics = s_chars,
+    },
+    {0},
+};
+
+// Reads return the whole value; the host pages long reads through it by offset
+static int chr_access(uint16_t conn_handle, uint16_t attr_handle,
+                      struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    const hal_ble_char_t chr = (hal_ble_char_t)(uintptr_t)arg;
+    switch (ctxt->op) {
+    case BLE_GATT_ACCESS_OP_READ_CHR: {
+        if (chr != s_read_chr || s_read_sent >= s_read_len) {
+            // New read: snapshot the value for it and its Read Blob pages
+            s_read_len = 0;
+            if (s_callbacks.on_read != NULL) {
+                s_read_len = s_callbacks.on_read(chr, s_read_snapshot, sizeof(s_read_snapshot));
+            }
+            s_read_chr = chr;
+            s_read_sent = 0;
+        }
+        s_read_sent += s_mtu - 1;
+        return os_mbuf_append(ctxt->om, s_read_snapshot, s_read_len) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    case BLE_GATT_ACCESS_OP_WRITE_CHR: {
+        uint16_t len = 0;
+        if (ble_hs_mbuf_to_flat(ctxt->om, s_value_buf, sizeof(s_value_buf), &len) != 0) {
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+        if (s_callbacks.on_write != NULL) {
+            s_callbacks.on_write(chr, s_value_buf, len);
+        }
+        return 0;
+    }
+    default:
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+}
+
+static void start_advertising(void) {
+    // Service UUID in the advertisement, name in the scan response: both do not fit in 31 bytes
+    struct ble_hs_adv_fields fields = {0};
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.uuids128 = &s_service_uuid;
+    fields.num_uuids128 = 1;
+    fields.uuids128_is_complete = 1;
+    int rc = ble_gap_adv_set_fields(&fields);
+    if (rc == 0) {
+        struct ble_hs_adv_fields rsp = {0};
+        rsp.name = (const uint8_t *)HAL_BLE_DEVICE_NAME;
+        rsp.name_len = sizeof(HAL_BLE_DEVICE_NAME) - 1;
+        rsp.name_is_complete = 1;
+        rc = ble_gap_adv_rsp_set_fields(&rsp);
+    }
+    if (rc == 0) {
+        struct ble_gap_adv_params params = {0};
+        params.conn_mode = BLE_GAP_CONN_MODE_UND;
+        params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+        params.itvl_min = HAL_BLE_ADV_INTERVAL_MIN;
+        params.itvl_max = HAL_BLE_ADV_INTERVAL_MAX;
+        rc = ble_gap_adv_start(s_own_addr_type, NULL, BLE_HS_FOREVER, &params, gap_event, NULL);
+    }
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        ESP_LOGW(TAG, "Advertising start failed (rc %d)", rc);
+    }
+}
+
+static void update_link_from_desc(void) {
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(s_conn_handle, &desc) == 0) {
+        s_link.conn_interval = desc.conn_itvl;
+        s_link.latency = desc.conn_latency;
+        s_link.supervision_timeout = desc.supervision_timeout;
+    }
+}
+
+// Ask for a short connection interval, maximum LL data length and (where the
+// controller has it) the 2M PHY; each request is optional for the client
+static void request_stream_profile(uint16_t interval_max) {
+    struct ble_gap_upd_params params = {0};
+    params.itvl_min = HAL_BLE_STREAM_CONN_INTERVAL_MIN;
+    params.itvl_max = interval_max;
+    params.latency = 0;
+    params.supervision_timeout = HAL_BLE_STREAM_SUPERVISION_TIMEOUT;
+    if (ble_gap_update_params(s_conn_handle, &params) != 0) {
+        ESP_LOGW(TAG, "Connection parameter request failed");
+    }
+}
+
+static void start_link_negotiation(void) {
+    s_conn_fallback_sent = false;
+    request_stream_profile(HAL_BLE_STREAM_CONN_INTERVAL_MAX);
+    // NimBLE reports no completion for this; the controller applies it if the peer supports DLE
+    if (ble_hs_hci_util_set_data_len(s_conn_handle, HAL_BLE_MAX_LL_OCTETS, BLE_LL_MAX_TX_TIME_US) == 0) {
+        s_link.tx_octets = HAL_BLE_MAX_LL_OCTETS;
+    } else {
+        ESP_LOGW(TAG, "Data length request failed, staying at %u octets", s_link.tx_octets);
+    }
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    if (ble_gap_set_prefered_le_phy(s_conn_handle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                    BLE_GAP_LE_PHY_CODED_ANY) != 0) {
+        ESP_LOGW(TAG, "2M PHY request failed, staying on 1M");
+    }
+#endif
+}
+
+static int gap_event(struct ble_gap_event *event, void *arg) {
+    switch (event->type) {
+    case BLE_GAP_EVENT_CONNECT:
+        if (event->connect.status != 0) {
+            if (s_advertise) {
+                start_advertising();
+            }
+            break;
+        }
+        s_conn_handle = event->connect.conn_handle;
+        s_read_chr = HAL_BLE_CHAR_COUNT;
+        update_link_from_desc();
+        s_link.tx_octets = HAL_BLE_DEFAULT_LL_OCTETS;
+        s_link.phy = 1;
+        s_connected = true;
+        ESP_LOGI(TAG, "Client connected: handle=%u, interval=%u x 1.25 ms", s_conn_handle, s_link.conn_interval);
+        if (s_callbacks.on_connect != NULL) {
+            s_callbacks.on_connect();
+        }
+        start_link_negotiation();
+        break;
+    case BLE_GAP_EVENT_DISCONNECT:
+        s_connected = false;
+        s_congested = false;
+        s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        s_mtu = HAL_BLE_DEFAULT_MTU;
+        ESP_LOGI(TAG, "Client disconnected (reason 0x%x)", event->disconnect.reason);
+        if (s_callbacks.on_disconnect != NULL) {
+            s_callbacks.on_disconnect();
+        }
+        if (s_advertise) {
+            start_advertising();
+        }
+        break;
+    case BLE_GAP_EVENT_CONN_UPDATE_REQ:
+        return 0; // Accept the client's parameters
+    case BLE_GAP_EVENT_CONN_UPDATE:
+        if (event->conn_update.status != 0) {
+            // Client refused 7.5-15 ms: retry once with a wider window, then keep its choice
+            if (!s_conn_fallback_sent && s_connected) {
+                s_conn_fallback_sent = true;
+                ESP_LOGW(TAG, "Streaming interval rejected (status %d), retrying up to 30 ms",
+                         event->conn_update.status);
+                request_stream_profile(HAL_BLE_FALLBACK_CONN_INTERVAL_MAX);
+            }
+            break;
+        }
+        update_link_from_desc();
+        ESP_LOGI(TAG, "Connection interval %u x 1.25 ms, latency %u, timeout %u x 10 ms",
+                 s_link.conn_interval, s_link.latency, s_link.supervision_timeout);
+        break;
+    case BLE_GAP_EVENT_MTU:
+        s_mtu = event->mtu.value;
+        ESP_LOGI(TAG, "MTU negotiated: %u", s_mtu);
+        break;
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        if (event->subscribe.attr_handle == s_char_handles[HAL_BLE_CHAR_STREAM]) {
+            ESP_LOGI(TAG, "Stream notifications %s", event->subscribe.cur_notify ? "enabled" : "disabled");
+        }
+        break;
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        // A queued notification left the host: its mbufs are free again
+        if (s_congested) {
+            s_congested = false;
+            if (s_callbacks.on_tx_ready != NULL) {
+                s_callbacks.on_tx_ready();
+            }
+        }
+        break;
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        if (event->phy_updated.status == 0) {
+            s_link.phy = event->phy_updated.tx_phy;
+        }
+        ESP_LOGI(TAG, "PHY: tx %u, rx %u", event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+        break;
+#endif
+    case BLE_GAP_EVENT_ADV_COMPLETE:
+        if (s_advertise && !s_connected) {
+            start_advertising();
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static void on_sync(void) {
+    if (ble_hs_util_ensure_addr(0) != 0 || ble_hs_id_infer_auto(0, &s_own_addr_type) != 0) {
+        ESP_LOGE(TAG, "No usable BLE address");
+        return;
+    }
+    s_synced = true;
+    ESP_LOGI(TAG, "NimBLE host synced");
+    if (s_advertise && !s_connected) {
+        start_advertising();
+    }
+}
+
+static void on_reset(int reason) {
+    s_synced = false;
+    ESP_LOGW(TAG, "NimBLE host reset (reason %d)", reason);
+}
+
+static void host_task(void *param) {
+    nimble_port_run(); // Returns only after nimble_port_stop()
+    nimble_port_freertos_deinit();
+}
+
+esp_err_t hal_ble_init(const hal_ble_callbacks_t *callbacks) {
+    if (callbacks != NULL) {
+        s_callbacks = *callbacks;
+    }
+
+    // Brings up the controller and the host; the classic BT memory is released by the port
+    esp_err_t err = nimble_port_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "NimBLE init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    ble_hs_cfg.sync_cb = on_sync;
+    ble_hs_cfg.reset_cb = on_reset;
+
+    ble_svc_gap_init();
+    ble_svc_gatt_init();
+    int rc = ble_gatts_count_cfg(s_services);
+    if (rc == 0) {
+        rc = ble_gatts_add_svcs(s_services);
+    }
+    if (rc == 0) {
+        rc = ble_svc_gap_device_name_set(HAL_BLE_DEVICE_NAME);
+    }
+    if (rc != 0) {
+        ESP_LOGE(TAG, "GATT service registration failed (rc %d)", rc);
+        return ESP_FAIL;
+    }
+    // Configure MTU for high-speed data streaming
+    ble_att_set_preferred_mtu(HAL_BLE_MTU_SIZE);
+
+    nimble_port_freertos_init(host_task);
+    ESP_LOGI(TAG, "NimBLE host started");
+    return ESP_OK;
+}
+
+esp_err_t hal_ble_start_advertising(void) {
+    s_advertise = true;
+    if (s_synced && !s_connected) {
+        start_advertising(); // Otherwise started from on_sync or on disconnect
+    }
+    return ESP_OK;
+}
+
+esp_err_t hal_ble_stop_advertising(void) {
+    s_advertise = false;
+    const int rc = ble_gap_adv_stop();
+    return (rc == 0 || rc == BLE_HS_EALREADY) ? ESP_OK : ESP_FAIL;
+}
+
+uint16_t hal_ble_get_char_handle(hal_ble_char_t chr) {
+    return (chr < HAL_BLE_CHAR_COUNT) ? s_char_handles[chr] : 0;
+}
+
+esp_err_t hal_ble_send_notify(uint16_t characteristic_handle,
+                               const uint8_t *data,
+                               uint16_t length,
+                               bool is_notification) {
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Flagged before trying, so a NOTIFY_TX from the host task during the
+    // attempt still clears it. When no notification is in flight none will
+    // come at all; the caller then retries on a timeout
+    s_congested = true;
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(data, length);
+    if (om == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    // The host takes ownership of om, also on failure
+    const int rc = is_notification ? ble_gattc_notify_custom(s_conn_handle, characteristic_handle, om) :
+                                     ble_gattc_indicate_custom(s_conn_handle, characteristic_handle, om);
+    if (rc == BLE_HS_ENOMEM) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_congested = false;
+    return (rc == 0) ? ESP_OK : ESP_FAIL;
+}
+
+bool hal_ble_is_connected(void) {
+    return s_connected;
+}
+
+bool hal_ble_is_congested(void) {
+    return s_congested;
+}
+
+uint16_t hal_ble_get_mtu(void) {
+    return s_mtu;
+}
+
+esp_err_t hal_ble_request_mtu(uint16_t desired_mtu) {
+    if (ble_att_set_preferred_mtu(desired_mtu) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_connected && ble_gattc_exchange_mtu(s_conn_handle, NULL, NULL) != 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t hal_ble_get_link_params(hal_ble_link_params_t *out) {
+    if (!s_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *out = s_link;
+    return ESP_OK;
+}
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
@@ -0,0 +1,243 @@
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_intr_alloc.h>
+#include <driver/twai.h>
+#include "hal.h"
+
+#define TAG "CartelWorx-CAN"
+
+// ============================================================================
+// CAN/OBD-II interface on the ESP32 TWAI controller
+//
+// The driver's RX queue is the HAL RX buffer: the TWAI ISR posts frames into
+// it, and blocking reads sleep on that queue, so a waiting receiver task is
+// woken by the interrupt rather than by a timer.
+// ============================================================================
+
+#ifndef HAL_CAN_TX_GPIO
+#define HAL_CAN_TX_GPIO 5
+#endif
+#ifndef HAL_CAN_RX_GPIO
+#define HAL_CAN_RX_GPIO 4
+#endif
+#define HAL_CAN_TX_QUEUE_LEN 8
+#define HAL_CAN_TX_TIMEOUT_MS 10
+
+static bool s_can_active = false;
+static twai_filter_config_t s_hw_filter = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+
+// Software filter, only consulted when the hardware filter is a superset
+static uint32_t s_sw_ids[HAL_CAN_MAX_FILTERS];
+static uint32_t s_sw_masks[HAL_CAN_MAX_FILTERS];
+static uint8_t s_sw_count = 0;
+static bool s_sw_filter_enabled = false;
+static bool s_sw_standard_only = false; // Every filter is a standard ID: drop extended frames
+
+static bool sw_filter_accepts(uint32_t id) {
+    for (uint8_t i = 0; i < s_sw_count; i++) {
+        if ((id & s_sw_masks[i]) == (s_sw_ids[i] & s_sw_masks[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// twai_receive() that skips frames the software filter rejects, within one timeout
+static bool receive_accepted(twai_message_t *msg, TickType_t wait) {
+    const TickType_t start = xTaskGetTickCount();
+    TickType_t remaining = wait;
+    while (twai_receive(msg, remaining) == ESP_OK) {
+        if (msg->extd && s_sw_standard_only) {
+            // The standard-layout hardware filter compares only ID bits
+            // 31..21, so extended frames sharing those bits get through
+        } else if (!s_sw_filter_enabled || sw_filter_accepts(msg->identifier)) {
+            return true;
+        }
+        if (wait != portMAX_DELAY) {
+            const TickType_t elapsed = xTaskGetTickCount() - start;
+            remaining = (elapsed >= wait) ? 0 : wait - elapsed;
+        }
+    }
+    return false;
+}
+
+static esp_err_t can_driver_start(void) {
+    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)HAL_CAN_TX_GPIO,
+                                                                 (gpio_num_t)HAL_CAN_RX_GPIO,
+                                                                 TWAI_MODE_NORMAL);
+    g_config.rx_queue_len = HAL_CAN_RX_BUFFER_SIZE;
+    g_config.tx_queue_len = HAL_CAN_TX_QUEUE_LEN;
+#if CONFIG_TWAI_ISR_IN_IRAM
+    g_config.intr_flags |= ESP_INTR_FLAG_IRAM; // Keep receiving while flash writes disable the cache
+#endif
+    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
+
+    esp_err_t err = twai_driver_install(&g_config, &t_config, &s_hw_filter);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "TWAI install failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    err = twai_start();
+    if (err != ESP_OK) {
+        twai_driver_uninstall();
+    }
+    return err;
+}
+
+static void frame_from_twai(hal_can_frame_t *frame, const twai_message_t *msg, uint32_t now_us) {
+    frame->id = msg->identifier;
+    frame->dlc = (msg->data_length_code > HAL_CAN_MAX_DATA_LENGTH) ? HAL_CAN_MAX_DATA_LENGTH : msg->data_length_code;
+    memcpy(frame->data, msg->data, frame->dlc);
+    frame->timestamp_us = now_us;
+    frame->is_extended = msg->extd;
+}
+
+esp_err_t hal_can_init(void) {
+    if (s_can_active) {
+        return ESP_OK;
+    }
+    esp_err_t err = can_driver_start();
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_can_active = true;
+    ESP_LOGI(TAG, "CAN started: 500 kbps, RX depth %d", HAL_CAN_RX_BUFFER_SIZE);
+    return ESP_OK;
+}
+
+esp_err_t hal_can_set_filters(const uint32_t *ids,
+                              const uint32_t *masks,
+                              uint8_t count) {
+    if (count > HAL_CAN_MAX_FILTERS || (count > 0 && ids == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    twai_filter_config_t hw = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    bool exact = (count == 0);
+    bool all_standard = (count > 0);
+    if (count > 0) {
+        // Merge all entries into one single-filter code/mask: keep only the
+        // bits every entry cares about and agrees on
+        uint32_t care = HAL_CAN_STD_ID_MASK;
+        for (uint8_t i = 0; i < count; i++) {
+            const uint32_t mask = masks ? masks[i] : HAL_CAN_EXT_ID_MASK;
+            s_sw_ids[i] = ids[i];
+            s_sw_masks[i] = mask;
+            if (ids[i] > HAL_CAN_STD_ID_MASK) {
+                all_standard = false;
+            }
+            care &= mask & ~(ids[i] ^ ids[0]);
+        }
+        s_sw_count = count;
+
+        if (all_standard) {
+            const uint32_t code = ids[0] & care;
+            // Standard frame layout: ID in bits 31..21; mask bit 1 = don't care
+            hw.acceptance_code = code << 21;
+            hw.acceptance_mask = ((~care & HAL_CAN_STD_ID_MASK) << 21) | 0x001FFFFF;
+            hw.single_filter = true;
+
+            // Exact if every standard ID the hardware passes is in the
+            // requested set; extended frames are dropped in receive_accepted()
+            exact = true;
+            for (uint32_t id = 0; id <= HAL_CAN_STD_ID_MASK && exact; id++) {
+                if ((id & care) == code) {
+                    exact = sw_filter_accepts(id);
+                }
+            }
+        }
+    }
+
+    s_sw_count = count;
+    s_sw_filter_enabled = !exact;
+    s_sw_standard_only = all_standard;
+    s_hw_filter = hw;
+    ESP_LOGI(TAG, "CAN filter: code 0x%08lx mask 0x%08lx, software check %s",
+             (unsigned long)hw.acceptance_code, (unsigned long)hw.acceptance_mask,
+             s_sw_filter_enabled ? "on" : "off");
+
+    if (!s_can_active) {
+        return ESP_OK;
+    }
+    // Acceptance filter can only be changed while the driver is uninstalled
+    twai_stop();
+    twai_driver_uninstall();
+    esp_err_t err = can_driver_start();
+    s_can_active = (err == ESP_OK);
+    return err;
+}
+
+esp_err_t hal_can_send(const hal_can_frame_t *frame) {
+    if (!s_can_active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (frame == NULL || frame->dlc > HAL_CAN_MAX_DATA_LENGTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    twai_message_t msg = {0};
+    msg.identifier = frame->id;
+    msg.extd = frame->is_extended ? 1 : 0;
+    msg.data_length_code = frame->dlc;
+    memcpy(msg.data, frame->data, frame->dlc);
+    return twai_transmit(&msg, pdMS_TO_TICKS(HAL_CAN_TX_TIMEOUT_MS));
+}
+
+esp_err_t hal_can_read_frame(hal_can_frame_t *frame) {
+    if (!s_can_active || frame == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    twai_message_t msg;
+    if (!receive_accepted(&msg, 0)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    frame_from_twai(frame, &msg, (uint32_t)esp_timer_get_time());
+    return ESP_OK;
+}
+
+uint16_t hal_can_read_frames(hal_can_frame_t *frames,
+                             uint16_t max_frames,
+                             uint32_t timeout_ms) {
+    if (!s_can_active || frames == NULL || max_frames == 0) {
+        return 0;
+    }
+
+    const TickType_t wait = (timeout_ms == HAL_CAN_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    twai_message_t msg;
+    if (!receive_accepted(&msg, wait)) {
+        return 0;
+    }
+
+    // One timestamp per batch: the frames were all queued by the time we woke
+    const uint32_t now_us = (uint32_t)esp_timer_get_time();
+    uint16_t n = 0;
+    frame_from_twai(&frames[n++], &msg, now_us);
+    while (n < max_frames && receive_accepted(&msg, 0)) {
+        frame_from_twai(&frames[n++], &msg, now_us);
+    }
+    return n;
+}
+
+uint8_t hal_can_get_rx_count(void) {
+    twai_status_info_t status;
+    if (!s_can_active || twai_get_status_info(&status) != ESP_OK) {
+        return 0;
+    }
+    return (uint8_t)status.msgs_to_rx;
+}
+
+uint32_t hal_can_get_rx_overflow_count(void) {
+    twai_status_info_t status;
+    if (!s_can_active || twai_get_status_info(&status) != ESP_OK) {
+        return 0;
+    }
+    // Missed: RX queue full; overrun: controller FIFO full before the ISR ran
+    return status.rx_missed_count + status.rx_overrun_count;
+}
+
+bool hal_can_is_active(void) {
+    return s_can_active;
+}
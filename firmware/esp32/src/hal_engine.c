@@ -0,0 +1,204 @@
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_intr_alloc.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include "hal.h"
+
+#define TAG "CartelWorx-Crank"
+
+// ============================================================================
+// Engine position from a missing-tooth crank wheel (plus optional cam)
+//
+// Every crank tooth edge raises a GPIO interrupt. The ISR measures the tooth
+// period and finds the gap by its length: (missing + 1) teeth long, against
+// a threshold halfway between that and one tooth, so it holds under normal
+// acceleration. After the gap it counts teeth to get the angle. A cam
+// sensor read at the gap picks the revolution of the 720 degree cycle;
+// without one, the revolutions alternate from the first gap, which is
+// consistent but may be 360 degrees off. A tooth count that disagrees with
+// the gap, or a stall, drops sync until the next gap.
+//
+// The registered handler runs from this ISR, only while in sync, and can
+// read hal_get_crank_angle() for the edge. Everything on this path is in
+// IRAM, so it keeps running while flash writes disable the cache.
+// ============================================================================
+
+#ifndef HAL_CRANK_GPIO
+#define HAL_CRANK_GPIO 26
+#endif
+#ifndef HAL_CAM_GPIO
+#define HAL_CAM_GPIO 27                  // -1 without a cam sensor
+#endif
+#ifndef HAL_CRANK_TEETH
+#define HAL_CRANK_TEETH 60               // Tooth positions per revolution, missing ones included
+#endif
+#ifndef HAL_CRANK_MISSING_TEETH
+#define HAL_CRANK_MISSING_TEETH 2
+#endif
+#ifndef HAL_CRANK_FIRST_TOOTH_DEG
+#define HAL_CRANK_FIRST_TOOTH_DEG 0      // Crank angle of the first tooth after the gap
+#endif
+#define HAL_CRANK_REAL_TEETH (HAL_CRANK_TEETH - HAL_CRANK_MISSING_TEETH)
+#define HAL_CRANK_TOOTH_DEG (360 / HAL_CRANK_TEETH)
+#define HAL_CRANK_STALL_US 200000        // No edge for this long: stopped, resync
+#define HAL_CRANKING_RPM 250
+
+// Written by the crank ISR only
+static DRAM_ATTR hal_interrupt_handler_t s_handler = NULL;
+static DRAM_ATTR uint64_t s_last_edge_us = 0;
+static DRAM_ATTR uint32_t s_tooth_period_us = 0; // Regular tooth period, 0 = no reference yet
+static DRAM_ATTR uint16_t s_tooth = 0;           // Real teeth since the gap, 0 = first after it
+static DRAM_ATTR uint16_t s_angle = 0;
+static DRAM_ATTR bool s_second_rev = false;
+static DRAM_ATTR bool s_synced = false;
+
+static void IRAM_ATTR crank_edge_isr(void *arg) {
+    const uint64_t now_us = (uint64_t)esp_timer_get_time();
+    const uint64_t period_us = now_us - s_last_edge_us;
+    s_last_edge_us = now_us;
+
+    if (period_us > HAL_CRANK_STALL_US) {
+        // First edge, or the first after a stall: no period to compare against
+        s_synced = false;
+        s_tooth_period_us = 0;
+        return;
+    }
+    if (s_tooth_period_us == 0) {
+        s_tooth_period_us = (uint32_t)period_us;
+        return;
+    }
+
+    const bool gap = period_us * 2 > (uint64_t)s_tooth_period_us * (HAL_CRANK_MISSING_TEETH + 2);
+    if (gap) {
+        if (s_synced && s_tooth != HAL_CRANK_REAL_TEETH - 1) {
+            s_synced = false; // Lost or extra teeth since the last gap
+        } else {
+#if HAL_CAM_GPIO >= 0
+            // Cam high at the gap marks the first revolution
+            s_second_rev = gpio_ll_get_level(&GPIO, HAL_CAM_GPIO) == 0;
+#else
+            s_second_rev = s_synced ? !s_second_rev : false;
+#endif
+            s_synced = true;
+        }
+        s_tooth = 0;
+        s_tooth_period_us = (uint32_t)(period_us / (HAL_CRANK_MISSING_TEETH + 1));
+    } else {
+        s_tooth_period_us = (uint32_t)period_us;
+        if (s_synced && ++s_tooth >= HAL_CRANK_REAL_TEETH) {
+            s_synced = false; // Gap missed
+        }
+    }
+    if (!s_synced) {
+        return;
+    }
+
+    s_angle = (uint16_t)((HAL_CRANK_FIRST_TOOTH_DEG + s_tooth * HAL_CRANK_TOOTH_DEG +
+                          (s_second_rev ? 360 : 0)) % 720);
+    if (s_handler != NULL) {
+        s_handler();
+    }
+}
+
+esp_err_t hal_register_crank_interrupt(hal_interrupt_handler_t handler) {
+    if (handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpio_config_t crank_io = {
+        .pin_bit_mask = 1ULL << HAL_CRANK_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    esp_err_t err = gpio_config(&crank_io);
+    if (err != ESP_OK) {
+        return err;
+    }
+#if HAL_CAM_GPIO >= 0
+    gpio_config_t cam_io = {
+        .pin_bit_mask = 1ULL << HAL_CAM_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    err = gpio_config(&cam_io);
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
+
+    s_handler = handler;
+    // The interrupt is allocated on the calling task's core; another driver may own the service already
+    err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+    err = gpio_isr_handler_add((gpio_num_t)HAL_CRANK_GPIO, crank_edge_isr, NULL);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Crank input on GPIO %d: %d-%d wheel, cam GPIO %d",
+                 HAL_CRANK_GPIO, HAL_CRANK_TEETH, HAL_CRANK_MISSING_TEETH, HAL_CAM_GPIO);
+    }
+    return err;
+}
+
+uint16_t IRAM_ATTR hal_get_crank_angle(void) {
+    return s_angle;
+}
+
+uint16_t hal_get_rpm(void) {
+    const uint32_t period_us = __atomic_load_n(&s_tooth_period_us, __ATOMIC_RELAXED);
+    const uint32_t since_edge_us = (uint32_t)esp_timer_get_time() - (uint32_t)s_last_edge_us;
+    if (!s_synced || period_us == 0 || since_edge_us > HAL_CRANK_STALL_US) {
+        return 0;
+    }
+    return (uint16_t)(60000000UL / ((uint32_t)HAL_CRANK_TEETH * period_us));
+}
+
+bool hal_is_engine_cranking(void) {
+    const uint16_t rpm = hal_get_rpm();
+    return rpm > 0 && rpm < HAL_CRANKING_RPM;
+}
+
+// ============================================================================
+// Ignition advance
+//
+// The commanded advance is latched here, from the crank ISR, and the spark
+// output stage samples it at its next event; a single aligned 16-bit store
+// is atomic, so no lock is needed between the two.
+// ============================================================================
+
+static DRAM_ATTR int16_t s_ignition_timing = 0;
+
+esp_err_t IRAM_ATTR hal_set_ignition_timing(int16_t degrees_btdc) {
+    if (degrees_btdc < HAL_IGNITION_TIMING_MIN || degrees_btdc > HAL_IGNITION_TIMING_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    __atomic_store_n(&s_ignition_timing, degrees_btdc, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+int16_t IRAM_ATTR hal_get_ignition_timing(void) {
+    return __atomic_load_n(&s_ignition_timing, __ATOMIC_RELAXED);
+}
+
+// ============================================================================
+// Fuel and boost
+//
+// This board has no injector driver or boost control output yet. The
+// setters refuse every value, so a tuning command for them is acknowledged
+// as rejected rather than reported as applied.
+// ============================================================================
+
+esp_err_t hal_set_fuel_trim(int8_t percent) {
+    (void)percent;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t hal_set_boost_target(uint16_t kpa) {
+    (void)kpa;
+    return ESP_ERR_NOT_SUPPORTED;
+}
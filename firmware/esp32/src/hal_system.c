@@ -0,0 +1,24 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include "hal.h"
+
+// ============================================================================
+// System timing on esp_timer
+//
+// esp_timer_get_time() reads the 64-bit system timer and is itself in IRAM,
+// so the time base is usable from ISRs while flash writes disable the cache.
+// ============================================================================
+
+uint64_t IRAM_ATTR hal_get_time_us(void) {
+    return (uint64_t)esp_timer_get_time();
+}
+
+uint32_t hal_get_time_ms(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+void hal_delay_ms(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
@@ -0,0 +1,154 @@
+#include <math.h>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
+#include <esp_rom_sys.h>
+#include "knock_dsp.h"
+#include "knock_window.h"
+
+// Filter work buffer, shared by all windows (knock task only, not reentrant)
+static int16_t s_work[KNOCK_WINDOW_MAX_SAMPLES];
+
+static int16_t q14_from_float(float v) {
+    float scaled = v * (float)(1 << KNOCK_DSP_COEFF_SHIFT);
+    if (scaled > 32767.0f) {
+        return 32767;
+    }
+    if (scaled < -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(scaled);
+}
+
+static inline int16_t sat16(int32_t v) {
+    if (v > 32767) {
+        return 32767;
+    }
+    if (v < -32768) {
+        return -32768;
+    }
+    return (int16_t)v;
+}
+
+esp_err_t knock_dsp_init(knock_dsp_t *dsp,
+                         uint32_t sample_rate_hz,
+                         uint32_t center_hz,
+                         uint16_t q_x100,
+                         uint8_t num_sections) {
+    if (dsp == NULL || sample_rate_hz == 0 || center_hz == 0 ||
+        center_hz >= sample_rate_hz / 2 || q_x100 == 0 ||
+        num_sections == 0 || num_sections > KNOCK_DSP_MAX_SECTIONS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // RBJ band-pass, 0 dB peak gain
+    const float w0 = 2.0f * (float)M_PI * (float)center_hz / (float)sample_rate_hz;
+    const float alpha = sinf(w0) / (2.0f * ((float)q_x100 / 100.0f));
+    const float a0 = 1.0f + alpha;
+    knock_biquad_q14_t section = {
+        .b0 = q14_from_float(alpha / a0),
+        .a1 = q14_from_float(-2.0f * cosf(w0) / a0),
+        .a2 = q14_from_float((1.0f - alpha) / a0),
+    };
+
+    memset(dsp, 0, sizeof(*dsp));
+    for (uint8_t i = 0; i < num_sections; i++) {
+        dsp->sections[i] = section;
+    }
+    dsp->num_sections = num_sections;
+    dsp->sample_rate_hz = sample_rate_hz;
+    dsp->center_hz = center_hz;
+    return ESP_OK;
+}
+
+// y[n] = b0 * (x[n] - x[n-2]) - a1 * y[n-1] - a2 * y[n-2], in place
+static void IRAM_ATTR biquad_bandpass_q14(const knock_biquad_q14_t *c, int16_t *buf, uint16_t count) {
+    const int32_t b0 = c->b0;
+    const int32_t a1 = c->a1;
+    const int32_t a2 = c->a2;
+    int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+    for (uint16_t n = 0; n < count; n++) {
+        const int32_t x0 = buf[n];
+        // |a1*y1| <= 2^30, |a2*y2| < 2^29, b0 term < 2^27: fits the 32-bit accumulator
+        int32_t acc = b0 * (x0 - x2) - a1 * y1 - a2 * y2;
+        const int16_t y0 = sat16(acc >> KNOCK_DSP_COEFF_SHIFT);
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+        buf[n] = y0;
+    }
+}
+
+uint32_t IRAM_ATTR knock_dsp_window_energy(const knock_dsp_t *dsp,
+                                           const uint16_t *samples,
+                                           uint16_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    if (count > KNOCK_WINDOW_MAX_SAMPLES) {
+        count = KNOCK_WINDOW_MAX_SAMPLES;
+    }
+
+    // Remove the sensor bias so the first section does not ring on a DC step
+    uint32_t sum = 0;
+    for (uint16_t n = 0; n < count; n++) {
+        sum += samples[n];
+    }
+    const int32_t dc = (int32_t)(sum / count);
+
+    // 12-bit unsigned -> Q15 signed
+    for (uint16_t n = 0; n < count; n++) {
+        s_work[n] = (int16_t)(((int32_t)samples[n] - dc) << 3);
+    }
+    for (uint8_t s = 0; s < dsp->num_sections; s++) {
+        biquad_bandpass_q14(&dsp->sections[s], s_work, count);
+    }
+
+    uint64_t energy = 0;
+    for (uint16_t n = 0; n < count; n++) {
+        const int32_t y = s_work[n];
+        energy += (uint32_t)(y * y);
+    }
+    return (uint32_t)(energy / count);
+}
+
+void knock_dsp_benchmark(const knock_dsp_t *dsp,
+                         uint16_t window_len,
+                         uint16_t iterations,
+                         uint16_t redline_rpm,
+                         uint8_t num_cylinders,
+                         knock_dsp_benchmark_t *out) {
+    static uint16_t s_waveform[KNOCK_WINDOW_MAX_SAMPLES];
+    if (window_len > KNOCK_WINDOW_MAX_SAMPLES) {
+        window_len = KNOCK_WINDOW_MAX_SAMPLES;
+    }
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    // Decaying knock ringing on top of broadband noise, centred at mid-scale
+    uint32_t lcg = 0x12345678;
+    const float w = 2.0f * (float)M_PI * (float)dsp->center_hz / (float)dsp->sample_rate_hz;
+    for (uint16_t n = 0; n < window_len; n++) {
+        lcg = lcg * 1664525u + 1013904223u;
+        const float noise = (float)((int32_t)(lcg >> 22) - 512);
+        const float ring = 1200.0f * expf(-(float)n / 150.0f) * sinf(w * (float)n);
+        s_waveform[n] = (uint16_t)(2048.0f + ring + noise);
+    }
+
+    volatile uint32_t sink = 0;
+    const uint32_t start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < iterations; i++) {
+        sink += knock_dsp_window_energy(dsp, s_waveform, window_len);
+    }
+    const uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    (void)sink;
+
+    out->window_len = window_len;
+    out->cycles_per_window = cycles / iterations;
+    out->us_per_window = out->cycles_per_window / esp_rom_get_cpu_ticks_per_us();
+    // One cylinder event = 720 deg / cylinders; 120e6 us*rpm per 720 deg
+    out->budget_us = (redline_rpm && num_cylinders) ? 120000000UL / ((uint32_t)redline_rpm * num_cylinders) : 0;
+}
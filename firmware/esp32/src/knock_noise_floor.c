@@ -0,0 +1,45 @@
+#include <string.h>
+#include <esp_attr.h>
+#include "knock_noise_floor.h"
+
+void knock_noise_floor_init(knock_noise_floor_t *nf) {
+    memset(nf, 0, sizeof(*nf));
+}
+
+uint16_t IRAM_ATTR knock_noise_floor_update(knock_noise_floor_t *nf,
+                                            uint8_t cyl_index,
+                                            uint16_t rpm,
+                                            uint8_t load_pct,
+                                            uint32_t energy) {
+    uint32_t *level = &nf->level[knock_noise_floor_cell(cyl_index, rpm, load_pct)];
+    const uint32_t floor = *level;
+    if (floor == 0) {
+        // First window at this operating point seeds the cell, unless the
+        // input is dead (sensor unplugged, DC): seeding there would leave a
+        // floor that every later window scores as knock
+        if (energy >= KNOCK_FLOOR_MIN) {
+            *level = energy;
+        }
+        return 0;
+    }
+
+    uint64_t score = ((uint64_t)energy << KNOCK_SCORE_SHIFT) / floor;
+    if (score > UINT16_MAX) {
+        score = UINT16_MAX;
+    }
+
+    // Learn towards the clamped input so knock does not raise the floor.
+    // Steps are at least 1 either way (the shift already rounds negative
+    // deltas down), so small floors still converge.
+    uint64_t clamp = (uint64_t)floor * KNOCK_FLOOR_CLAMP_RATIO;
+    uint32_t input = (energy > clamp) ? (uint32_t)clamp : energy;
+    int64_t delta = (int64_t)input - (int64_t)floor;
+    int64_t step = delta >> KNOCK_FLOOR_ALPHA_SHIFT;
+    if (step == 0 && delta > 0) {
+        step = 1;
+    }
+    int64_t next = (int64_t)floor + step;
+    *level = (next > KNOCK_FLOOR_MIN) ? (uint32_t)next : KNOCK_FLOOR_MIN;
+
+    return (uint16_t)score;
+}
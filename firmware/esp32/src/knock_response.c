@@ -0,0 +1,68 @@
+#include <string.h>
+#include <esp_attr.h>
+#include "hal.h"
+#include "knock_response.h"
+
+void knock_response_init(knock_response_t *kr, int16_t base_timing) {
+    memset(kr, 0, sizeof(*kr));
+    kr->base_timing = base_timing;
+    kr->applied_timing = INT16_MIN; // Forces the first write
+}
+
+void knock_response_on_window(knock_response_t *kr,
+                              uint8_t cyl_index,
+                              bool knock,
+                              uint64_t close_us,
+                              uint64_t now_us) {
+    if (cyl_index >= KNOCK_MAX_CYLINDERS) {
+        return;
+    }
+    int8_t retard = kr->retard[cyl_index];
+
+    if (knock) {
+        kr->clean_windows[cyl_index] = 0;
+        retard = (retard + KNOCK_RETARD_STEP_DEG > KNOCK_RETARD_MAX_DEG) ? KNOCK_RETARD_MAX_DEG
+                                                                         : retard + KNOCK_RETARD_STEP_DEG;
+        uint32_t detect_us = (uint32_t)(now_us - close_us);
+        if (detect_us > kr->stats.detect_latency_max_us) {
+            kr->stats.detect_latency_max_us = detect_us;
+        }
+        kr->stats.knock_events++;
+        __atomic_store_n(&kr->retard[cyl_index], retard, __ATOMIC_RELAXED);
+        // Published after the retard, so the ISR that clears it sees the new value
+        __atomic_store_n(&kr->pending_us[cyl_index], (uint32_t)close_us | 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    if (retard > 0 && ++kr->clean_windows[cyl_index] >= KNOCK_RECOVER_WINDOWS) {
+        kr->clean_windows[cyl_index] = 0;
+        __atomic_store_n(&kr->retard[cyl_index], retard - 1, __ATOMIC_RELAXED);
+    }
+}
+
+void IRAM_ATTR knock_response_before_firing(knock_response_t *kr, uint8_t cyl_index, uint64_t now_us) {
+    if (cyl_index >= KNOCK_MAX_CYLINDERS) {
+        return;
+    }
+    const uint32_t pending = __atomic_exchange_n(&kr->pending_us[cyl_index], 0, __ATOMIC_ACQUIRE);
+    int16_t timing = __atomic_load_n(&kr->base_timing, __ATOMIC_RELAXED) -
+                     __atomic_load_n(&kr->retard[cyl_index], __ATOMIC_RELAXED);
+    if (timing < HAL_IGNITION_TIMING_MIN) {
+        timing = HAL_IGNITION_TIMING_MIN;
+    } else if (timing > HAL_IGNITION_TIMING_MAX) {
+        timing = HAL_IGNITION_TIMING_MAX;
+    }
+    if (timing != kr->applied_timing) {
+        hal_set_ignition_timing(timing);
+        kr->applied_timing = timing;
+    }
+
+    if (pending != 0) {
+        const uint32_t latency_us = (uint32_t)now_us - pending;
+        kr->stats.applied_events++;
+        kr->stats.apply_latency_us = latency_us;
+        if (latency_us > kr->stats.apply_latency_max_us) {
+            kr->stats.apply_latency_max_us = latency_us;
+        }
+    }
+}
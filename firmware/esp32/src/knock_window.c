@@ -0,0 +1,125 @@
+#include <string.h>
+#include <esp_attr.h>
+#include "knock_window.h"
+
+esp_err_t knock_window_scheduler_init(knock_window_scheduler_t *sched,
+                                      const knock_window_config_t *config) {
+    if (sched == NULL || config == NULL ||
+        config->num_cylinders == 0 || config->num_cylinders > KNOCK_MAX_CYLINDERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (uint8_t i = 0; i < config->num_cylinders; i++) {
+        const knock_window_cyl_t *ev = &config->events[i];
+        if (ev->tdc_angle >= KNOCK_CYCLE_DEGREES || ev->start_atdc >= ev->end_atdc) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (i > 0 && ev->tdc_angle <= config->events[i - 1].tdc_angle) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    memset(sched, 0, sizeof(*sched));
+    sched->config = *config;
+    return ESP_OK;
+}
+
+bool IRAM_ATTR knock_window_on_crank_edge(knock_window_scheduler_t *sched,
+                                          uint16_t crank_angle,
+                                          uint64_t now_us,
+                                          knock_window_t *out) {
+    if (!sched->primed) {
+        // Resume at the first TDC ahead of the current position
+        sched->next_event = 0;
+        for (uint8_t i = 0; i < sched->config.num_cylinders; i++) {
+            if (sched->config.events[i].tdc_angle > crank_angle) {
+                sched->next_event = i;
+                break;
+            }
+        }
+        sched->prev_angle = crank_angle;
+        sched->prev_edge_us = now_us;
+        sched->prev_tdc_us = 0;
+        sched->primed = true;
+        return false;
+    }
+
+    const uint16_t step = (crank_angle + KNOCK_CYCLE_DEGREES - sched->prev_angle) % KNOCK_CYCLE_DEGREES;
+    const uint32_t dt_us = (uint32_t)(now_us - sched->prev_edge_us);
+    const uint16_t prev_angle = sched->prev_angle;
+    sched->prev_angle = crank_angle;
+    sched->prev_edge_us = now_us;
+    if (step == 0 || dt_us == 0) {
+        return false;
+    }
+
+    // TDC crossed if it lies in (prev_angle, crank_angle]
+    const knock_window_cyl_t *ev = &sched->config.events[sched->next_event];
+    const uint16_t to_tdc = (ev->tdc_angle + KNOCK_CYCLE_DEGREES - prev_angle) % KNOCK_CYCLE_DEGREES;
+    if (to_tdc == 0 || to_tdc > step) {
+        return false;
+    }
+    const uint8_t prev_event = (sched->next_event + sched->config.num_cylinders - 1) % sched->config.num_cylinders;
+    sched->next_event = (sched->next_event + 1) % sched->config.num_cylinders;
+
+    // Project window edges forward at the current tooth speed (Q16 us/deg)
+    const uint32_t past_tdc = step - to_tdc;
+    const uint64_t us_per_deg_q16 = ((uint64_t)dt_us << 16) / step;
+    const uint32_t open_deg = (ev->start_atdc > past_tdc) ? ev->start_atdc - past_tdc : 0;
+    const uint32_t close_deg = (ev->end_atdc > past_tdc) ? ev->end_atdc - past_tdc : 0;
+
+    // TDC-to-TDC time is the previous cylinder's power stroke: crank-tooth
+    // timing resolved per cylinder, interpolated within the tooth like the window edges
+    const uint64_t tdc_us = now_us - ((past_tdc * us_per_deg_q16) >> 16);
+    out->stroke_us = (sched->prev_tdc_us != 0) ? (uint32_t)(tdc_us - sched->prev_tdc_us) : 0;
+    out->stroke_cylinder = sched->config.events[prev_event].cylinder;
+    sched->prev_tdc_us = tdc_us;
+
+    out->cylinder = ev->cylinder;
+    out->open_us = now_us + ((open_deg * us_per_deg_q16) >> 16);
+    out->close_us = now_us + ((close_deg * us_per_deg_q16) >> 16);
+    // rpm = deg/s / 6
+    out->rpm = (uint16_t)((((uint64_t)1000000 << 16) / 6) / (us_per_deg_q16 ? us_per_deg_q16 : 1));
+    return true;
+}
+
+uint16_t knock_window_collect(knock_window_buffer_t *wb,
+                              const uint16_t *block,
+                              uint16_t from,
+                              uint16_t count,
+                              uint64_t block_end_us,
+                              uint32_t sample_period_ns,
+                              bool *complete) {
+    *complete = false;
+    if (count == 0 || from >= count) {
+        return count;
+    }
+
+    // Sample i was taken (count - 1 - i) periods before block_end_us
+    const int64_t end_after_open_ns = ((int64_t)block_end_us - (int64_t)wb->window.open_us) * 1000;
+    const int64_t end_after_close_ns = ((int64_t)block_end_us - (int64_t)wb->window.close_us) * 1000;
+    if (end_after_open_ns < 0) {
+        // Window opens after this block: nothing here is wanted
+        return count;
+    }
+
+    int32_t first = (int32_t)count - 1 - (int32_t)(end_after_open_ns / sample_period_ns);
+    int32_t last = count;
+    if (end_after_close_ns >= 0) {
+        last = (int32_t)count - 1 - (int32_t)(end_after_close_ns / sample_period_ns);
+        *complete = true;
+    }
+    if (first < from) {
+        first = from;
+    }
+    if (last < first) {
+        last = first;
+    }
+
+    uint32_t n = (uint32_t)(last - first);
+    if (n > (uint32_t)(KNOCK_WINDOW_MAX_SAMPLES - wb->count)) {
+        n = KNOCK_WINDOW_MAX_SAMPLES - wb->count; // Truncate very long (low RPM) windows
+    }
+    memcpy(&wb->samples[wb->count], &block[first], n * sizeof(uint16_t));
+    wb->count += n;
+    return (uint16_t)last;
+}
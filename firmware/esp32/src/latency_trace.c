@@ -0,0 +1,74 @@
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_cpu.h>
+#include "latency_trace.h"
+
+typedef struct {
+    uint32_t buckets[LATENCY_STAGE_COUNT][LATENCY_TRACE_BUCKETS];
+    uint32_t max_us[LATENCY_STAGE_COUNT];
+} core_histograms_t;
+
+static DRAM_ATTR core_histograms_t s_trace[LATENCY_TRACE_CORES];
+
+void IRAM_ATTR latency_trace_record(latency_stage_t stage, uint32_t latency_us) {
+    if ((unsigned)stage >= LATENCY_STAGE_COUNT) {
+        return;
+    }
+    core_histograms_t *h = &s_trace[esp_cpu_get_core_id()];
+    uint32_t bucket = 31 - __builtin_clz(latency_us | 1);
+    if (bucket >= LATENCY_TRACE_BUCKETS) {
+        bucket = LATENCY_TRACE_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&h->buckets[stage][bucket], 1, __ATOMIC_RELAXED);
+    // Only this core writes its max; a racing ISR can at worst lose a tie
+    if (latency_us > h->max_us[stage]) {
+        h->max_us[stage] = latency_us;
+    }
+}
+
+void latency_trace_get(latency_stage_t stage, latency_histogram_t *out) {
+    memset(out, 0, sizeof(*out));
+    if ((unsigned)stage >= LATENCY_STAGE_COUNT) {
+        return;
+    }
+    for (uint8_t core = 0; core < LATENCY_TRACE_CORES; core++) {
+        const core_histograms_t *h = &s_trace[core];
+        for (uint8_t b = 0; b < LATENCY_TRACE_BUCKETS; b++) {
+            out->buckets[b] += __atomic_load_n(&h->buckets[stage][b], __ATOMIC_RELAXED);
+        }
+        if (h->max_us[stage] > out->max_us) {
+            out->max_us = h->max_us[stage];
+        }
+    }
+}
+
+void latency_trace_reset(void) {
+    memset(s_trace, 0, sizeof(s_trace));
+}
+
+static inline uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+uint16_t latency_trace_serialize(uint8_t *out, uint16_t capacity) {
+    if (capacity < LATENCY_TRACE_SERIALIZED_SIZE) {
+        return 0;
+    }
+    uint8_t *p = out;
+    *p++ = LATENCY_TRACE_FORMAT_VERSION;
+    *p++ = LATENCY_STAGE_COUNT;
+    *p++ = LATENCY_TRACE_BUCKETS;
+    for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        latency_histogram_t h;
+        latency_trace_get((latency_stage_t)stage, &h);
+        p = put_u32(p, h.max_us);
+        for (uint8_t b = 0; b < LATENCY_TRACE_BUCKETS; b++) {
+            p = put_u32(p, h.buckets[b]);
+        }
+    }
+    return (uint16_t)(p - out);
+}
@@ -4,197 +4,1012 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
-#include <freertos/queue.h>
+#include <freertos/event_groups.h>
 #include <esp_system.h>
 #include <esp_log.h>
 #include <esp_timer.h>
+#include <esp_attr.h>
+#include <esp_pm.h>
 #include <nvs_flash.h>
-#include <esp_bt.h>
-#include <esp_bt_main.h>
-#include <esp_gap_ble_api.h>
-#include <esp_gatts_api.h>
+#include "hal.h"
+#include "ring_buffer.h"
+#include "knock_window.h"
+#include "knock_dsp.h"
+#include "knock_noise_floor.h"
+#include "knock_response.h"
+#include "latency_trace.h"
+#include "deferred_log.h"
+#include "runtime_stats.h"
+#include "rtos_arena.h"
+#include "boot_trace.h"
+#include "obd_pid.h"
+#include "pid_scheduler.h"
+#include "ble_tx_stream.h"
+#include "cw_protocol.h"
+#include "sensor_burst.h"
+#include "tuning_command.h"
+#include "tuning_map.h"
+#include "telemetry_log.h"
+#include "engine_state.h"
+#include "cylinder_health.h"
 
 #define TAG "CartelWorx-Main"
 
+// === Knock Acquisition Configuration ===
+#define KNOCK_SAMPLE_RATE_HZ 50000   // Nyquist well above the 15-20 kHz knock band
+#define KNOCK_SAMPLE_PERIOD_NS (1000000000UL / KNOCK_SAMPLE_RATE_HZ)
+#define KNOCK_DMA_BLOCK_SAMPLES 128  // 2.56 ms per block; windows are assembled from blocks
+#define KNOCK_WINDOW_QUEUE_LEN 8      // Power of 2
+#define KNOCK_RESONANCE_HZ 17000      // Band-pass centre, set per engine (bore size)
+#define KNOCK_FILTER_Q_X100 300       // Q 3.0 per section
+#define KNOCK_FILTER_SECTIONS 2       // 4th-order band-pass
+#define KNOCK_REDLINE_RPM 8000
+#define KNOCK_THRESHOLD_Q8 (3 * KNOCK_SCORE_UNITY) // Knock when band energy > 3x learned floor
+#define KNOCK_BASE_TIMING_DEG 10      // Degrees BTDC until a tuning map supplies it
+#define KNOCK_STREAM_CYCLES 16        // Engine cycles per SERVICE_KNOCK_STREAM burst
+#define CYL_HEALTH_RECORD_CYCLES 32   // Scores stream every cycle; one per this many is recorded
+#define ENGINE_STOP_TIMEOUT_US 500000 // No knock windows for this long: engine stopped
+
+// === CAN Configuration ===
+#define CAN_RX_BATCH_MAX 32          // Frames drained per wakeup
+#define PID_STATS_LOG_PERIOD_US 10000000 // Achieved vs. requested rates
+
+// === BLE Configuration ===
+#define BLE_TX_STREAM_SIZE 4096      // Length-prefixed notification frames
+#define BLE_COALESCE_DEADLINE_US 5000 // Max time a frame waits for others to share its packet
+#define BLE_PLAYBACK_BURST 4         // Recorded packets sent per wakeup, between live frames
+#define BLE_CONGESTED_RETRY_MS 15    // Resend attempt while congested, about one connection interval
+#define BLE_LINK_PARAMS_SIZE 11      // Link block appended to the stats read
+
+// === Tuning Configuration ===
+#define TUNING_COMMAND_QUEUE_LEN 16  // Power of 2
+
+// === Diagnostics Configuration ===
+#define RUNTIME_STATS_PERIOD_MS 5000 // CPU shares are averaged over this period
+
+// === System Event Bits ===
+#define SYSTEM_EVENT_BLE_CONNECTED (1 << 0)
+#define SYSTEM_EVENT_CAN_ACTIVE (1 << 1)
+#define SYSTEM_EVENT_ENGINE_RUNNING (1 << 2)
+
 // === Forward Declarations ===
 void knock_monitoring_task(void *pvParameters);
 void can_request_sender_task(void *pvParameters);
 void can_receiver_task(void *pvParameters);
 void ble_communication_task(void *pvParameters);
-void ble_gatt_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+void system_monitor_task(void *pvParameters);
+void tuning_control_task(void *pvParameters);
+void init_bluetooth(void);
 
 // === Global Variables ===
-static esp_gatt_if_t gatt_if = 0;
-static uint16_t service_handle, char_handle;
-static SemaphoreHandle_t knock_semaphore;
-static QueueHandle_t ble_tx_queue;
-
-// === GATT Service Definition ===
-static const esp_bt_uuid_t primary_service_uuid = {
-    .len = ESP_UUID_LEN_128,
-    .uuid = {0xCC, 0xCC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xCC, 0xCC, 0xCC, 0xCC}, // CartelWorx Service UUID
+static TaskHandle_t ble_task_handle;
+static EventGroupHandle_t system_events; // Link and engine state, waited on instead of polled
+static uint8_t ble_tx_storage[BLE_TX_STREAM_SIZE];
+static ble_tx_stream_t ble_tx_stream; // Producers -> BLE task, frames built in place
+static TaskHandle_t knock_task_handle;
+static uint64_t knock_last_window_us;
+static RingBuffer<knock_window_t, KNOCK_WINDOW_QUEUE_LEN> knock_window_queue; // Crank ISR -> knock task
+static knock_window_scheduler_t knock_scheduler;
+static knock_window_buffer_t knock_window; // Kept off the task stack (1 KB of samples)
+static knock_dsp_t knock_dsp;
+static knock_noise_floor_t knock_floor;
+static knock_response_t knock_resp; // Knock task -> crank ISR retard
+static uint16_t knock_last_score[KNOCK_MAX_CYLINDERS]; // Latest score (Q8), by cylinder - 1
+static uint32_t knock_event_count[KNOCK_MAX_CYLINDERS];
+static int32_t knock_stream_scores[KNOCK_MAX_CYLINDERS * KNOCK_STREAM_CYCLES]; // [cylinder][cycle]
+static uint8_t knock_stream_fill[KNOCK_MAX_CYLINDERS];
+static uint64_t knock_stream_base_us;
+static uint8_t knock_stream_seq;
+static cylinder_health_t cylinder_health; // Knock task only
+static uint8_t cylinder_health_seq;
+static telemetry_playback_t ble_playback;   // Flash log replay in progress (BLE task)
+static uint32_t ble_playback_since;         // Requested start sequence (BLE host writes)
+static bool ble_playback_requested;
+static uint8_t ble_playback_seq;
+static runtime_stats_t runtime_stats_latest; // Last snapshot, served on BLE reads
+static SemaphoreHandle_t runtime_stats_mutex;
+
+// OBD-II polling targets: fast engine state first, slow temperatures last
+static const pid_sched_config_t obd_poll_config[] = {
+    {0x0C, 3, 50}, // RPM
+    {0x0B, 3, 50}, // MAP
+    {0x04, 2, 20}, // Calculated load
+    {0x0E, 2, 20}, // Timing advance
+    {0x11, 2, 20}, // TPS
+    {0x14, 1, 10}, // O2 sensor
+    {0x0F, 0, 1},  // IAT
+    {0x05, 0, 1},  // Coolant
 };
+static pid_scheduler_t pid_sched;
+static SemaphoreHandle_t pid_sched_mutex;   // Shared by CAN sender and receiver
+static TaskHandle_t can_sender_task_handle;
+static obd_isotp_rx_t obd_isotp_rx[OBD_NUM_ECUS];
+static engine_obd_state_t obd_state;        // Responses merged so far (CAN receiver only)
+static RingBuffer<tuning_command_t, TUNING_COMMAND_QUEUE_LEN> tuning_command_queue; // BLE host -> control task
+static TaskHandle_t tuning_task_handle;
+static int16_t tuning_timing_offset;  // Degrees on top of the mapped timing (control task writes)
+static tuning_map_set_t timing_maps;  // Base timing, degrees BTDC by RPM x MAP kPa (read per firing)
+static int8_t tuning_fuel_trim;       // Percent in effect
+static uint16_t tuning_boost_target;  // kPa in effect, 0 = none set
 
-static const esp_bt_uuid_t notify_char_uuid = {
-    .len = ESP_UUID_LEN_128,
-    .uuid = {0xCC, 0xC1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xCC, 0xCC, 0xCC, 0xCC}, // Notify characteristic
+// 4-cylinder, firing order 1-3-4-2, knock window 10-70 deg ATDC
+static const knock_window_config_t knock_window_config = {
+    4,
+    {
+        {1, 0, 10, 70},
+        {3, 180, 10, 70},
+        {4, 360, 10, 70},
+        {2, 540, 10, 70},
+    },
 };
 
-static const esp_bt_uuid_t write_char_uuid = {
-    .len = ESP_UUID_LEN_128,
-    .uuid = {0xCC, 0xC2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xCC, 0xCC, 0xCC, 0xCC}, // Write characteristic
+// Flat base timing (kept in flash). Nothing replaces it yet: a calibrated map
+// would go in through tuning_map_set_begin_update()/_commit(), which no
+// command calls so far
+static const tuning_map_t default_timing_map = {
+    2, 2,
+    {0, KNOCK_REDLINE_RPM},
+    {0, 255},
+    {KNOCK_BASE_TIMING_DEG, KNOCK_BASE_TIMING_DEG, KNOCK_BASE_TIMING_DEG, KNOCK_BASE_TIMING_DEG},
 };
 
 // === Task Implementations ===
+
+// Runs in the ADC DMA ISR once per completed block
+static bool IRAM_ATTR knock_block_ready_isr(void) {
+    BaseType_t higher_priority_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(knock_task_handle, &higher_priority_woken);
+    return higher_priority_woken == pdTRUE;
+}
+
+// Runs on every crank tooth edge; at each TDC schedules that cylinder's knock
+// window and sets the timing (with its knock retard) of the cylinder firing next
+static void IRAM_ATTR crank_edge_isr(void) {
+    knock_window_t window;
+    const uint64_t now_us = hal_get_time_us();
+    if (knock_window_on_crank_edge(&knock_scheduler, hal_get_crank_angle(), now_us, &window)) {
+        knock_window_queue.push(window);
+        engine_state_publish_crank(window.rpm, window.cylinder, now_us);
+        // Mapped timing for this operating point plus the app's live offset, applied below
+        engine_obd_state_t obd;
+        engine_state_read_obd(&obd);
+        const int16_t base = tuning_map_set_lookup(&timing_maps, window.rpm, obd.map_kpa) +
+                             __atomic_load_n(&tuning_timing_offset, __ATOMIC_RELAXED);
+        knock_response_set_base(&knock_resp, base);
+        const uint32_t applied = knock_resp.stats.applied_events;
+        knock_response_before_firing(&knock_resp, knock_window_next_cylinder(&knock_scheduler) - 1, now_us);
+        if (knock_resp.stats.applied_events != applied) {
+            latency_trace_record(LATENCY_STAGE_KNOCK_RETARD, knock_resp.stats.apply_latency_us);
+        }
+    }
+}
+
+// Collect one score per cylinder per cycle; every KNOCK_STREAM_CYCLES cycles
+// record them as one delta-encoded burst with a channel per cylinder, and
+// stream it too while the app is connected
+static void knock_stream_record(uint8_t cyl, uint64_t open_us, uint16_t score) {
+    const uint8_t num_cyl = knock_window_config.num_cylinders;
+    bool empty = true;
+    for (uint8_t c = 0; c < num_cyl; c++) {
+        empty = empty && knock_stream_fill[c] == 0;
+    }
+    if (empty) {
+        knock_stream_base_us = open_us;
+    }
+    knock_stream_scores[cyl * KNOCK_STREAM_CYCLES + knock_stream_fill[cyl]++] = score;
+    if (knock_stream_fill[cyl] < KNOCK_STREAM_CYCLES) {
+        return;
+    }
+
+    // A cylinder that missed windows shortens the burst for all of them
+    uint8_t cycles = KNOCK_STREAM_CYCLES;
+    uint8_t ids[KNOCK_MAX_CYLINDERS];
+    for (uint8_t c = 0; c < num_cyl; c++) {
+        if (knock_stream_fill[c] < cycles) {
+            cycles = knock_stream_fill[c];
+        }
+        ids[c] = c + 1;
+    }
+    if (cycles > 0 && cycles < KNOCK_STREAM_CYCLES) {
+        for (uint8_t c = 1; c < num_cyl; c++) {
+            memmove(&knock_stream_scores[c * cycles], &knock_stream_scores[c * KNOCK_STREAM_CYCLES],
+                    cycles * sizeof(int32_t));
+        }
+    }
+    memset(knock_stream_fill, 0, sizeof(knock_stream_fill));
+    if (cycles < 2) {
+        return;
+    }
+
+    sensor_burst_t burst;
+    burst.channel_count = num_cyl;
+    burst.sample_count = cycles;
+    burst.base_timestamp_us = (uint32_t)knock_stream_base_us;
+    burst.period_us = (uint32_t)((open_us - knock_stream_base_us) / (cycles - 1));
+    burst.channel_ids = ids;
+    burst.samples = knock_stream_scores;
+
+    const uint16_t max_payload = sensor_burst_max_size(num_cyl, cycles);
+    const uint8_t seq = knock_stream_seq++;
+    // Encoded once into the recorder's stream, then copied to the BLE stream.
+    // Both are shared with core 1 tasks: never wait for their locks, drop instead
+    uint8_t *frame = telemetry_log_try_reserve(CW_FRAME_OVERHEAD + max_payload);
+    if (frame != NULL) {
+        uint16_t len = sensor_burst_encode(&burst, frame + CW_FRAME_HEADER_SIZE, max_payload);
+        len = cw_frame_finish(frame, CW_SERVICE_KNOCK_STREAM, seq, len);
+        if (hal_ble_is_connected()) {
+            ble_tx_stream_try_write(&ble_tx_stream, frame, len);
+        }
+        telemetry_log_commit(len);
+        return;
+    }
+    if (!hal_ble_is_connected()) {
+        return;
+    }
+    frame = ble_tx_stream_try_reserve(&ble_tx_stream, CW_FRAME_OVERHEAD + max_payload);
+    if (frame == NULL) {
+        return;
+    }
+    uint16_t len = sensor_burst_encode(&burst, frame + CW_FRAME_HEADER_SIZE, max_payload);
+    ble_tx_stream_commit(&ble_tx_stream, cw_frame_finish(frame, CW_SERVICE_KNOCK_STREAM, seq, len));
+}
+
+// Stream each cycle's scores while connected; record one per CYL_HEALTH_RECORD_CYCLES
+static void cylinder_health_publish(void) {
+    const bool stream = hal_ble_is_connected();
+    const bool record = cylinder_health.cycles % CYL_HEALTH_RECORD_CYCLES == 0;
+    if (!stream && !record) {
+        return;
+    }
+    uint8_t frame[CW_FRAME_OVERHEAD + CYL_HEALTH_MAX_PAYLOAD];
+    uint16_t len = cylinder_health_encode(&cylinder_health, frame + CW_FRAME_HEADER_SIZE, CYL_HEALTH_MAX_PAYLOAD);
+    len = cw_frame_finish(frame, CW_SERVICE_CYLINDER_HEALTH, cylinder_health_seq++, len);
+    if (stream) {
+        ble_tx_stream_try_write(&ble_tx_stream, frame, len);
+    }
+    if (record) {
+        uint8_t *slot = telemetry_log_try_reserve(len);
+        if (slot != NULL) {
+            memcpy(slot, frame, len);
+            telemetry_log_commit(len);
+        }
+    }
+}
+
+// Hand each scheduled window its slice of the block; samples outside every window are dropped
+static void knock_process_block(const uint16_t *samples, uint16_t count, uint64_t block_end_us) {
+    uint16_t pos = 0;
+    while (pos < count) {
+        if (!knock_window.armed) {
+            knock_window_t next;
+            if (!knock_window_queue.pop(next)) {
+                return;
+            }
+            knock_window_arm(&knock_window, &next);
+            knock_last_window_us = next.open_us;
+        }
+
+        bool complete;
+        pos = knock_window_collect(&knock_window, samples, pos, count, block_end_us, KNOCK_SAMPLE_PERIOD_NS, &complete);
+        if (!complete) {
+            return;
+        }
+        knock_window.armed = false;
+        if (knock_window.count > 0 && knock_window.window.cylinder >= 1 &&
+            knock_window.window.cylinder <= KNOCK_MAX_CYLINDERS) {
+            const uint8_t cyl = knock_window.window.cylinder - 1;
+            uint32_t energy = knock_dsp_window_energy(&knock_dsp, knock_window.samples, knock_window.count);
+            // Speed measured at this window's TDC, load as last reported by the ECU
+            engine_obd_state_t obd;
+            engine_state_read_obd(&obd);
+            uint16_t score = knock_noise_floor_update(&knock_floor, cyl, knock_window.window.rpm, obd.load_pct, energy);
+            knock_last_score[cyl] = score;
+            const bool knock = score > KNOCK_THRESHOLD_Q8;
+            if (knock) {
+                knock_event_count[cyl]++;
+            }
+            const uint64_t scored_us = hal_get_time_us();
+            latency_trace_record(LATENCY_STAGE_KNOCK_SCORE, (uint32_t)(scored_us - block_end_us));
+            knock_response_on_window(&knock_resp, cyl, knock, knock_window.window.close_us, scored_us);
+            if (knock) {
+                DLOG3(DLOG_KNOCK_EVENT, cyl + 1, score, knock_response_get_retard(&knock_resp, cyl));
+            }
+            knock_stream_record(cyl, knock_window.window.open_us, score);
+            if (cylinder_health_on_window(&cylinder_health, &knock_window.window, score)) {
+                cylinder_health_publish();
+            }
+        }
+    }
+}
+
 void knock_monitoring_task(void *pvParameters) {
     ESP_LOGI(TAG, "Knock monitoring task started");
+    knock_task_handle = xTaskGetCurrentTaskHandle();
+    ESP_ERROR_CHECK(knock_window_scheduler_init(&knock_scheduler, &knock_window_config));
+    ESP_ERROR_CHECK(knock_dsp_init(&knock_dsp, KNOCK_SAMPLE_RATE_HZ, KNOCK_RESONANCE_HZ,
+                                   KNOCK_FILTER_Q_X100, KNOCK_FILTER_SECTIONS));
+    knock_noise_floor_init(&knock_floor);
+    knock_response_init(&knock_resp, KNOCK_BASE_TIMING_DEG);
+    ESP_ERROR_CHECK(tuning_map_set_init(&timing_maps, &default_timing_map));
+    ESP_ERROR_CHECK(cylinder_health_init(&cylinder_health, knock_window_config.num_cylinders));
+
+#ifdef KNOCK_DSP_BENCHMARK
+    knock_dsp_benchmark_t bench;
+    knock_dsp_benchmark(&knock_dsp, KNOCK_WINDOW_MAX_SAMPLES, 100, KNOCK_REDLINE_RPM,
+                        knock_window_config.num_cylinders, &bench);
+    ESP_LOGI(TAG, "Knock DSP: %lu cycles (%lu us) per %u-sample window, budget %lu us @ %d RPM",
+             (unsigned long)bench.cycles_per_window, (unsigned long)bench.us_per_window,
+             bench.window_len, (unsigned long)bench.budget_us, KNOCK_REDLINE_RPM);
+#endif
+
+    ESP_ERROR_CHECK(hal_register_crank_interrupt(crank_edge_isr));
+    ESP_ERROR_CHECK(hal_adc_knock_start_stream(KNOCK_SAMPLE_RATE_HZ, KNOCK_DMA_BLOCK_SAMPLES, knock_block_ready_isr));
+    boot_trace_mark("knock armed");
+
+    bool engine_running = false;
+    bool erase_allowed = false;
     while (1) {
-        // Process engine cycle data
-        // In real implementation: acquire ADC, process signal, detect knock
-        vTaskDelay(pdMS_TO_TICKS(1));
+        // Sleep until DMA hands over a block; no tick-bound polling
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        const uint16_t *samples;
+        uint16_t count;
+        uint64_t block_end_us = 0;
+        while (hal_adc_knock_get_block(&samples, &count, &block_end_us) == ESP_OK) {
+            knock_process_block(samples, count, block_end_us);
+        }
+
+        // Crank-scheduled windows are the engine-running signal; publish edges only
+        bool running = knock_last_window_us != 0 &&
+                       (int64_t)(block_end_us - knock_last_window_us) < ENGINE_STOP_TIMEOUT_US;
+        if (block_end_us != 0 && running != engine_running) {
+            engine_running = running;
+            if (running) {
+                // Health baselines are per run: this engine start, this temperature
+                cylinder_health_init(&cylinder_health, knock_window_config.num_cylinders);
+                xEventGroupSetBits(system_events, SYSTEM_EVENT_ENGINE_RUNNING);
+            } else {
+                xEventGroupClearBits(system_events, SYSTEM_EVENT_ENGINE_RUNNING);
+            }
+        }
+        // Flash erases stall all code outside IRAM: only once the engine has been
+        // quiet for the stop timeout, counting boot as activity in case it is cranking
+        const bool erase = (int64_t)(block_end_us - knock_last_window_us) >= ENGINE_STOP_TIMEOUT_US;
+        if (block_end_us != 0 && erase != erase_allowed) {
+            erase_allowed = erase;
+            telemetry_log_set_erase_allowed(erase);
+        }
+        // The DMA pool is drained and the next block is a full block away:
+        // the one point where a page program's cache stall costs nothing
+        telemetry_log_program_slot();
     }
 }
 
 void can_request_sender_task(void *pvParameters) {
     ESP_LOGI(TAG, "CAN request sender task started");
-    int pid_index = 0;
-    const uint32_t pids[] = {0x010C, 0x010F, 0x010B, 0x010E, 0x0114, 0x0111}; // RPM, IAT, MAP, Timing, O2, TPS
+    can_sender_task_handle = xTaskGetCurrentTaskHandle();
+    uint64_t next_stats_log_us = hal_get_time_us() + PID_STATS_LOG_PERIOD_US;
     
     while (1) {
-        // Send OBD-II PID request
-        uint32_t pid = pids[pid_index % 6];
-        pid_index++;
+        xEventGroupWaitBits(system_events, SYSTEM_EVENT_CAN_ACTIVE, pdFALSE, pdTRUE, portMAX_DELAY);
+        uint8_t pids[OBD_MAX_PIDS_PER_REQUEST];
+        uint64_t now_us = hal_get_time_us();
+        xSemaphoreTake(pid_sched_mutex, portMAX_DELAY);
+        if (pid_sched.awaiting_response && now_us - pid_sched.request_sent_us >= PID_SCHED_RESPONSE_TIMEOUT_US) {
+            DLOG1(DLOG_OBD_TIMEOUT, now_us - pid_sched.request_sent_us);
+        }
+        uint8_t count = pid_scheduler_next_batch(&pid_sched, now_us, pids, OBD_MAX_PIDS_PER_REQUEST);
+        uint64_t wake_us = pid_scheduler_next_event_us(&pid_sched);
+        xSemaphoreGive(pid_sched_mutex);
         
-        // In real implementation: can_send_frame(OBD_REQUEST_ID, request_data, length)
-        ESP_LOGI(TAG, "Polling PID: 0x%04X", pid);
+        if (count > 0) {
+            hal_can_frame_t request;
+            obd_build_mode01_request(pids, count, &request);
+            DLOG1(DLOG_OBD_POLL, count);
+            hal_can_send(&request);
+        }
         
-        vTaskDelay(pdMS_TO_TICKS(50)); // 20Hz polling rate
+        if (now_us >= next_stats_log_us) {
+            pid_sched_stats_t stats[PID_SCHED_MAX_ENTRIES];
+            uint8_t n = 0;
+            xSemaphoreTake(pid_sched_mutex, portMAX_DELAY);
+            while (n < PID_SCHED_MAX_ENTRIES && pid_scheduler_get_stats(&pid_sched, n, &stats[n])) {
+                n++;
+            }
+            xSemaphoreGive(pid_sched_mutex);
+            for (uint8_t i = 0; i < n; i++) {
+                ESP_LOGI(TAG, "PID 0x%02X: %u.%u/%u Hz, %lu timeouts", stats[i].pid,
+                         stats[i].achieved_hz_x10 / 10, stats[i].achieved_hz_x10 % 10, stats[i].target_hz,
+                         (unsigned long)stats[i].timeouts);
+            }
+            next_stats_log_us = now_us + PID_STATS_LOG_PERIOD_US;
+        }
+        
+        // Pipeline: the receiver wakes us as soon as the response is in;
+        // otherwise sleep until the next PID falls due or the request times out
+        now_us = hal_get_time_us();
+        TickType_t wait = 1;
+        if (wake_us > now_us) {
+            wait = pdMS_TO_TICKS((wake_us - now_us + 999) / 1000);
+            if (wait == 0) {
+                wait = 1;
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+// Reassemble one ECU response frame; flow control is sent as soon as a first frame arrives
+static void obd_handle_response_frame(const hal_can_frame_t *frame) {
+    const uint8_t ecu = (uint8_t)((frame->id - OBD_RESPONSE_ID_BASE) & (OBD_NUM_ECUS - 1));
+    obd_isotp_rx_t *rx = &obd_isotp_rx[ecu];
+    obd_isotp_result_t result = obd_isotp_feed(rx, frame);
+    if (result == OBD_ISOTP_NEED_FLOW_CONTROL) {
+        hal_can_frame_t flow_control;
+        obd_build_flow_control(frame->id, &flow_control);
+        hal_can_send(&flow_control);
+        return;
+    }
+    if (result != OBD_ISOTP_COMPLETE) {
+        return;
+    }
+
+    obd_pid_value_t values[OBD_MAX_PIDS_PER_REQUEST];
+    uint8_t count = obd_parse_mode01_response(rx->buffer, rx->expected, values, OBD_MAX_PIDS_PER_REQUEST);
+    // Merge the whole response, then publish it as one snapshot update
+    const uint64_t now_us = hal_get_time_us();
+    for (uint8_t i = 0; i < count; i++) {
+        const float value = obd_pid_decode(&values[i]);
+        switch (values[i].pid) {
+        case 0x0C:
+            obd_state.rpm = (uint16_t)value;
+            break;
+        case 0x0B:
+            obd_state.map_kpa = (uint16_t)value;
+            break;
+        case 0x04:
+            obd_state.load_pct = (uint8_t)(value + 0.5f);
+            break;
+        case 0x11:
+            obd_state.tps_pct = (uint8_t)(value + 0.5f);
+            break;
+        case 0x0E:
+            obd_state.timing_advance_deg = (int8_t)value;
+            break;
+        case 0x05:
+            obd_state.coolant_c = (int16_t)value;
+            break;
+        case 0x0F:
+            obd_state.iat_c = (int16_t)value;
+            break;
+        default:
+            break;
+        }
+    }
+    if (count > 0) {
+        obd_state.updated_us = now_us;
+        engine_state_publish_obd(&obd_state);
+    }
+
+    xSemaphoreTake(pid_sched_mutex, portMAX_DELAY);
+    const uint64_t request_sent_us = pid_sched.request_sent_us;
+    if (pid_scheduler_on_response(&pid_sched, now_us, ecu, values, count)) {
+        latency_trace_record(LATENCY_STAGE_CAN_RESPONSE, (uint32_t)(now_us - request_sent_us));
+    }
+    xSemaphoreGive(pid_sched_mutex);
+    if (can_sender_task_handle != NULL) {
+        xTaskNotifyGive(can_sender_task_handle);
     }
 }
 
 void can_receiver_task(void *pvParameters) {
     ESP_LOGI(TAG, "CAN receiver task started");
+    static hal_can_frame_t frames[CAN_RX_BATCH_MAX]; // Kept off the 2 KB task stack
+
     while (1) {
-        // Process received CAN frames
-        // In real implementation: hal_can_read_available_frame(...)
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Sleep until the RX interrupt queues a frame, then drain everything pending
+        uint16_t count = hal_can_read_frames(frames, CAN_RX_BATCH_MAX, HAL_CAN_WAIT_FOREVER);
+        for (uint16_t i = 0; i < count; i++) {
+            obd_handle_response_frame(&frames[i]);
+        }
+    }
+}
+
+// START or END of a flash log replay, queued behind the live frames
+static void ble_playback_marker(uint8_t event, uint32_t value) {
+    uint8_t *frame = ble_tx_stream_reserve(&ble_tx_stream, CW_FRAME_OVERHEAD + TELEMETRY_PLAYBACK_MARKER_SIZE);
+    if (frame == NULL) {
+        return;
+    }
+    uint8_t *payload = frame + CW_FRAME_HEADER_SIZE;
+    payload[0] = event;
+    for (int i = 0; i < 4; i++) {
+        payload[1 + i] = (uint8_t)(value >> (8 * i));
+    }
+    ble_tx_stream_commit(&ble_tx_stream, cw_frame_finish(frame, CW_SERVICE_TELEMETRY_PLAYBACK, ble_playback_seq++,
+                                                         TELEMETRY_PLAYBACK_MARKER_SIZE));
+}
+
+// Start a requested replay, or send its next few packets straight from mapped flash
+static void ble_service_playback(uint16_t stream_handle) {
+    if (__atomic_exchange_n(&ble_playback_requested, false, __ATOMIC_ACQUIRE)) {
+        if (ble_playback.active) {
+            telemetry_log_playback_end(&ble_playback);
+        }
+        const uint32_t since = __atomic_load_n(&ble_playback_since, __ATOMIC_RELAXED);
+        if (telemetry_log_playback_begin(&ble_playback, since)) {
+            ble_playback_marker(TELEMETRY_PLAYBACK_START, ble_playback.sequence);
+        } else {
+            ble_playback_marker(TELEMETRY_PLAYBACK_END, 0);
+        }
+        return; // The marker goes out first, with the live frames
+    }
+    for (int i = 0; i < BLE_PLAYBACK_BURST && ble_playback.active; i++) {
+        const uint8_t *span;
+        const uint16_t length = telemetry_log_playback_next(&ble_playback, hal_ble_get_mtu() - HAL_BLE_NOTIFY_OVERHEAD,
+                                                            &span);
+        if (length == 0) {
+            ble_playback_marker(TELEMETRY_PLAYBACK_END, ble_playback.sequence);
+            telemetry_log_playback_end(&ble_playback);
+            break;
+        }
+        if (hal_ble_send_notify(stream_handle, span, length, true) == ESP_ERR_NO_MEM) {
+            break; // Resent from the same offset on on_tx_ready
+        }
+        telemetry_log_playback_advance(&ble_playback, length);
     }
 }
 
 void ble_communication_task(void *pvParameters) {
     ESP_LOGI(TAG, "BLE communication task started");
-    uint8_t tx_data[512];
+    ble_task_handle = xTaskGetCurrentTaskHandle();
+    ble_tx_stream_set_consumer(&ble_tx_stream, ble_task_handle);
+    
+    // The stack takes hundreds of ms to come up: done here, on core 1, while
+    // the knock and CAN tasks are already running
+    init_bluetooth();
+    boot_trace_mark("ble ready");
+    boot_trace_report();
+    bool pending = false;
+    uint64_t pending_since_us = 0; // Commit time of the oldest frame waiting to go out
+    
+    while (1) {
+        xEventGroupWaitBits(system_events, SYSTEM_EVENT_BLE_CONNECTED, pdFALSE, pdTRUE, portMAX_DELAY);
+        
+        // Woken by every committed frame, by congestion clearing, by a disconnect, or by the flush deadline.
+        // While congested the wait is bounded: the host may free its buffers without reporting it
+        TickType_t wait = portMAX_DELAY;
+        if (hal_ble_is_congested()) {
+            wait = pdMS_TO_TICKS(BLE_CONGESTED_RETRY_MS);
+        } else if (!pending && ble_playback.active) {
+            wait = 0; // Replay runs flat out while the live stream is idle
+        } else if (pending) {
+            uint64_t deadline_us = pending_since_us + BLE_COALESCE_DEADLINE_US;
+            uint64_t now_us = hal_get_time_us();
+            wait = 0;
+            if (deadline_us > now_us) {
+                wait = pdMS_TO_TICKS((deadline_us - now_us + 999) / 1000);
+                if (wait == 0) {
+                    wait = 1;
+                }
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        
+        if (!hal_ble_is_connected()) {
+            // Drop what was queued for the old connection
+            const uint8_t *span;
+            bool full;
+            uint16_t length;
+            while ((length = ble_tx_stream_peek_span(&ble_tx_stream, BLE_TX_STREAM_SIZE, &span, &full)) > 0) {
+                ble_tx_stream_release_span(&ble_tx_stream, length);
+            }
+            pending = false;
+            if (ble_playback.active) {
+                telemetry_log_playback_end(&ble_playback);
+            }
+            __atomic_store_n(&ble_playback_requested, false, __ATOMIC_RELAXED);
+            continue;
+        }
+        
+        const uint16_t stream_handle = hal_ble_get_char_handle(HAL_BLE_CHAR_STREAM);
+        while (1) {
+            // Pack as many whole frames as the negotiated ATT payload holds
+            const uint8_t *span;
+            bool full;
+            uint16_t length = ble_tx_stream_peek_span(&ble_tx_stream, hal_ble_get_mtu() - HAL_BLE_NOTIFY_OVERHEAD,
+                                                      &span, &full);
+            if (length == 0) {
+                pending = false;
+                break;
+            }
+            const uint64_t now_us = hal_get_time_us();
+            uint32_t commit_us;
+            pending = true;
+            pending_since_us = now_us;
+            if (ble_tx_stream_oldest_commit(&ble_tx_stream, &commit_us)) {
+                pending_since_us = now_us - (uint32_t)((uint32_t)now_us - commit_us);
+            }
+            if (!full && now_us - pending_since_us < BLE_COALESCE_DEADLINE_US) {
+                break; // Room left: give other producers until the deadline
+            }
+            // Notify straight from the ring; latency runs from the oldest frame's commit
+            esp_err_t err = hal_ble_send_notify(stream_handle, span, length, true);
+            if (err == ESP_ERR_NO_MEM) {
+                break; // Host congested: keep the frames until on_tx_ready or the retry
+            }
+            if (err == ESP_OK) {
+                latency_trace_record(LATENCY_STAGE_BLE_NOTIFY, (uint32_t)(hal_get_time_us() - pending_since_us));
+            }
+            ble_tx_stream_release_span(&ble_tx_stream, length);
+            pending = false;
+        }
+        // Recorded frames only fill packets the live stream leaves idle
+        if (!pending) {
+            ble_service_playback(stream_handle);
+        }
+    }
+}
+
+// Samples stack, CPU, heap and queue telemetry for sizing tasks from data
+void system_monitor_task(void *pvParameters) {
+    ESP_LOGI(TAG, "System monitor task started");
+    runtime_stats_t stats;
     
     while (1) {
-        // Check if there's data to transmit
-        if (xQueueReceive(ble_tx_queue, tx_data, pdMS_TO_TICKS(100)) == pdTRUE) {
-            // Send data via BLE notification
-            if (gatt_if != 0) {
-                // esp_ble_gatts_send_indicate(gatt_if, ..., tx_data, length, false);
-            }
-        }
-    }
-}
-
-// === GATT Event Handler ===
-void ble_gatt_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param) {
-    switch (event) {
-    case ESP_GATTS_REG_EVT:
-        ESP_LOGI(TAG, "GATT Server registered");
-        gatt_if = gatts_if;
-        // Create GATT service
-        esp_ble_gatts_create_service(gatts_if, &primary_service_uuid, 1);
-        break;
-    case ESP_GATTS_CREATE_EVT:
-        service_handle = param->create.service_handle;
-        ESP_LOGI(TAG, "Service created: handle=0x%x", service_handle);
-        // Add characteristics
-        esp_ble_gatts_add_char(service_handle, &notify_char_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY, NULL, NULL);
-        break;
-    case ESP_GATTS_WRITE_EVT:
-        ESP_LOGI(TAG, "Write event on handle: 0x%x, len: %d", param->write.handle, param->write.len);
-        // Process incoming command from mobile app
-        break;
+        vTaskDelay(pdMS_TO_TICKS(RUNTIME_STATS_PERIOD_MS));
+        
+        runtime_counters_t counters = {};
+        counters.knock_window_depth = knock_window_queue.count();
+        counters.ble_tx_bytes = ring_buffer_count(&ble_tx_stream.ring);
+        counters.knock_window_overflows = knock_window_queue.overflows();
+        counters.adc_overruns = hal_adc_knock_get_overrun_count();
+        counters.can_rx_overflows = hal_can_get_rx_overflow_count();
+        counters.ble_tx_dropped = ble_tx_stream.dropped + ble_tx_stream.busy + ble_tx_stream.oversize;
+        counters.log_dropped = deferred_log_get_dropped();
+        telemetry_log_stats_t telemetry;
+        telemetry_log_get_stats(&telemetry);
+        counters.telemetry_dropped = telemetry.frames_dropped;
+        counters.telemetry_drive_full = telemetry.drive_full;
+        runtime_stats_sample(&stats, &counters);
+        runtime_stats_log(&stats);
+        
+        xSemaphoreTake(runtime_stats_mutex, portMAX_DELAY);
+        runtime_stats_latest = stats;
+        xSemaphoreGive(runtime_stats_mutex);
+    }
+}
+
+// Value in effect for one tuning parameter
+static int16_t tuning_current_value(uint8_t param) {
+    switch (param) {
+    case TUNING_PARAM_TIMING_OFFSET:
+        return tuning_timing_offset;
+    case TUNING_PARAM_FUEL_TRIM:
+        return tuning_fuel_trim;
+    case TUNING_PARAM_BOOST_TARGET:
+        return (int16_t)tuning_boost_target;
     default:
-        break;
+        return 0;
     }
 }
 
+// Acknowledge a command on the stream characteristic, echoing its sequence number.
+// Without wait the ack is dropped if another task holds the stream
+static void tuning_send_ack(const tuning_command_t *cmd, tuning_status_t status, bool wait) {
+    const uint16_t max_len = CW_FRAME_OVERHEAD + TUNING_ACK_PAYLOAD_SIZE;
+    uint8_t *frame = wait ? ble_tx_stream_reserve(&ble_tx_stream, max_len) :
+                            ble_tx_stream_try_reserve(&ble_tx_stream, max_len);
+    if (frame == NULL) {
+        return;
+    }
+    uint16_t len = tuning_ack_write(frame + CW_FRAME_HEADER_SIZE, cmd->param, status,
+                                    tuning_current_value(cmd->param));
+    ble_tx_stream_commit(&ble_tx_stream, cw_frame_finish(frame, CW_SERVICE_TUNING_ADJUSTMENT, cmd->sequence, len));
+}
+
+static tuning_status_t tuning_apply(const tuning_command_t *cmd) {
+    switch (cmd->param) {
+    case TUNING_PARAM_TIMING_OFFSET:
+        // Picked up by the crank ISR at the next firing, with knock retard on top
+        __atomic_store_n(&tuning_timing_offset, cmd->value, __ATOMIC_RELAXED);
+        return TUNING_STATUS_OK;
+    case TUNING_PARAM_FUEL_TRIM:
+        if (hal_set_fuel_trim((int8_t)cmd->value) != ESP_OK) {
+            return TUNING_STATUS_REJECTED;
+        }
+        tuning_fuel_trim = (int8_t)cmd->value;
+        return TUNING_STATUS_OK;
+    case TUNING_PARAM_BOOST_TARGET:
+        if (hal_set_boost_target((uint16_t)cmd->value) != ESP_OK) {
+            return TUNING_STATUS_REJECTED;
+        }
+        tuning_boost_target = (uint16_t)cmd->value;
+        return TUNING_STATUS_OK;
+    default:
+        return TUNING_STATUS_UNKNOWN_PARAM;
+    }
+}
+
+// Applies live adjustments from the app; woken by each queued command, so a
+// slider move takes effect well within one connection interval
+void tuning_control_task(void *pvParameters) {
+    ESP_LOGI(TAG, "Tuning control task started");
+    tuning_task_handle = xTaskGetCurrentTaskHandle();
+    tuning_command_t cmd;
+    
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (tuning_command_queue.pop(cmd)) {
+            tuning_status_t status = (tuning_status_t)cmd.status;
+            if (status == TUNING_STATUS_OK) {
+                status = tuning_apply(&cmd);
+                latency_trace_record(LATENCY_STAGE_TUNING_COMMAND, (uint32_t)hal_get_time_us() - cmd.received_us);
+            }
+            tuning_send_ack(&cmd, status, true);
+        }
+    }
+}
+
+// === BLE Callbacks (BLE host task) ===
+static void ble_on_connect(void) {
+    xEventGroupSetBits(system_events, SYSTEM_EVENT_BLE_CONNECTED);
+}
+
+static void ble_on_disconnect(void) {
+    xEventGroupClearBits(system_events, SYSTEM_EVENT_BLE_CONNECTED);
+    if (ble_task_handle != NULL) {
+        xTaskNotifyGive(ble_task_handle); // Let it discard the stale frames
+    }
+}
+
+static void ble_on_tx_ready(void) {
+    if (ble_task_handle != NULL) {
+        xTaskNotifyGive(ble_task_handle);
+    }
+}
+
+// What the link actually negotiated: u16 mtu, u16 conn_interval (1.25 ms),
+// u16 latency, u16 supervision_timeout (10 ms), u16 tx_octets, u8 phy.
+// Little-endian, all zero while not connected
+static_assert(RUNTIME_STATS_SERIALIZED_MAX + BLE_LINK_PARAMS_SIZE <= HAL_BLE_READ_MAX,
+              "Stats read value must fit one attribute value");
+static uint16_t ble_link_serialize(uint8_t *out, uint16_t capacity) {
+    if (capacity < BLE_LINK_PARAMS_SIZE) {
+        return 0;
+    }
+    hal_ble_link_params_t link = {};
+    uint16_t mtu = 0;
+    if (hal_ble_get_link_params(&link) == ESP_OK) {
+        mtu = hal_ble_get_mtu();
+    }
+    const uint16_t fields[5] = {mtu, link.conn_interval, link.latency, link.supervision_timeout, link.tx_octets};
+    for (int i = 0; i < 5; i++) {
+        out[2 * i] = (uint8_t)(fields[i] & 0xFF);
+        out[2 * i + 1] = (uint8_t)(fields[i] >> 8);
+    }
+    out[10] = link.phy;
+    return BLE_LINK_PARAMS_SIZE;
+}
+
+// Snapshot per read; the backend pages long reads through it
+static uint16_t ble_on_read(hal_ble_char_t chr, uint8_t *out, uint16_t capacity) {
+    uint16_t len = 0;
+    if (chr == HAL_BLE_CHAR_LATENCY) {
+        len = latency_trace_serialize(out, capacity);
+    } else if (chr == HAL_BLE_CHAR_STATS) {
+        xSemaphoreTake(runtime_stats_mutex, portMAX_DELAY);
+        len = runtime_stats_serialize(&runtime_stats_latest, out, capacity);
+        xSemaphoreGive(runtime_stats_mutex);
+        if (len > 0) {
+            len += ble_link_serialize(out + len, capacity - len); // After the task list
+        }
+    }
+    return len;
+}
+
+// Check and queue only: the control task applies it, so the host is never held up
+static void ble_on_write(hal_ble_char_t chr, const uint8_t *data, uint16_t length) {
+    if (chr != HAL_BLE_CHAR_COMMAND) {
+        return;
+    }
+    cw_frame_header_t header;
+    if (cw_frame_check(data, length, &header) && header.service == CW_SERVICE_TELEMETRY_PLAYBACK) {
+        if (header.payload_len == TELEMETRY_PLAYBACK_REQUEST_SIZE && ble_task_handle != NULL) {
+            const uint8_t *payload = data + CW_FRAME_HEADER_SIZE;
+            const uint32_t since = (uint32_t)payload[0] | ((uint32_t)payload[1] << 8) |
+                                   ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+            __atomic_store_n(&ble_playback_since, since, __ATOMIC_RELAXED);
+            __atomic_store_n(&ble_playback_requested, true, __ATOMIC_RELEASE);
+            xTaskNotifyGive(ble_task_handle);
+        }
+        return;
+    }
+    tuning_command_t cmd = {};
+    tuning_status_t status = tuning_command_parse(data, length, (uint32_t)hal_get_time_us(), &cmd);
+    if (status != TUNING_STATUS_OK) {
+        ESP_LOGW(TAG, "Tuning command refused: param 0x%02x, status %d", cmd.param, status);
+        if (status == TUNING_STATUS_BAD_FRAME) {
+            return; // No sequence number worth echoing
+        }
+    }
+    // Refusals are queued too: the control task sends every ack, since
+    // reserving stream space may block and this is the BT host task
+    cmd.status = (uint8_t)status;
+    if (tuning_command_queue.push(cmd)) {
+        if (tuning_task_handle != NULL) {
+            xTaskNotifyGive(tuning_task_handle);
+        }
+        return;
+    }
+    ESP_LOGW(TAG, "Tuning command refused: param 0x%02x, queue full", cmd.param);
+    tuning_send_ack(&cmd, TUNING_STATUS_QUEUE_FULL, false);
+}
+
 // === Bluetooth LE Initialization ===
 void init_bluetooth(void) {
     ESP_ERROR_CHECK(nvs_flash_init());
-    ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
-    
-    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_bt_controller_init(&bt_cfg));
-    ESP_ERROR_CHECK(esp_bt_controller_enable(ESP_BT_MODE_BLE));
-    ESP_ERROR_CHECK(esp_bluedroid_init());
-    ESP_ERROR_CHECK(esp_bluedroid_enable());
-    
-    // Register GATT server callbacks
-    ESP_ERROR_CHECK(esp_ble_gatts_register_callback(ble_gatt_event_handler));
-    ESP_ERROR_CHECK(esp_ble_gatts_app_register(0));
+    boot_trace_mark("nvs");
     
-    // Configure MTU for high-speed data streaming
-    esp_ble_gatt_set_local_mtu(517);
+    // Host stack chosen at build time: NimBLE, or Bluedroid (see platformio.ini)
+    hal_ble_callbacks_t callbacks = {};
+    callbacks.on_connect = ble_on_connect;
+    callbacks.on_disconnect = ble_on_disconnect;
+    callbacks.on_tx_ready = ble_on_tx_ready;
+    callbacks.on_read = ble_on_read;
+    callbacks.on_write = ble_on_write;
+    ESP_ERROR_CHECK(hal_ble_init(&callbacks));
+    boot_trace_mark("ble host");
+    ESP_ERROR_CHECK(hal_ble_start_advertising());
+}
+
+// The arena is sized for this fixed set of objects, so running out means it
+// was built too small: stop at boot rather than run with a task missing
+static void check_created(const void *handle, const char *what) {
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "Cannot create %s: RTOS arena exhausted", what);
+        abort();
+    }
 }
 
 // === Main Entry Point ===
 void app_main(void) {
     ESP_LOGI(TAG, "=== CartelWorx SDK v0.1.0 FreeRTOS Startup ===");
+    system_events = rtos_arena_create_event_group();
+    check_created(system_events, "system event group");
+    runtime_stats_mutex = rtos_arena_create_mutex();
+    check_created(runtime_stats_mutex, "runtime stats mutex");
+    deferred_log_init();
+    engine_state_init();
+    if (telemetry_log_init() != ESP_OK) {
+        ESP_LOGW(TAG, "No telemetry partition: recording disabled");
+    }
     
-    // Initialize Bluetooth
-    init_bluetooth();
+#if CONFIG_PM_ENABLE
+    // Idle cores drop to light sleep between wakeups; the ADC and TWAI drivers
+    // hold their own PM locks while streaming
+    esp_pm_config_t pm_config = {};
+    pm_config.max_freq_mhz = 240;
+    pm_config.min_freq_mhz = 80;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm_config.light_sleep_enable = true;
+#endif
+    esp_err_t pm_err = esp_pm_configure(&pm_config);
+    if (pm_err != ESP_OK) {
+        // Runs at full clock without light sleep: costs power, not function
+        ESP_LOGW(TAG, "Power management not configured: %s", esp_err_to_name(pm_err));
+    }
+#endif
+    
+    boot_trace_mark("core init");
+    
+    // Initialize CAN before the tasks that use it
+    ESP_ERROR_CHECK(hal_can_init());
+    const uint32_t obd_filter_id = OBD_RESPONSE_ID_BASE;
+    const uint32_t obd_filter_mask = OBD_RESPONSE_ID_MASK;
+    ESP_ERROR_CHECK(hal_can_set_filters(&obd_filter_id, &obd_filter_mask, 1));
+    xEventGroupSetBits(system_events, SYSTEM_EVENT_CAN_ACTIVE);
+    boot_trace_mark("can");
     
     // Create synchronization primitives
-    knock_semaphore = xSemaphoreCreateBinary();
-    ble_tx_queue = xQueueCreate(64, 512);
+    pid_sched_mutex = rtos_arena_create_mutex();
+    check_created(pid_sched_mutex, "PID scheduler mutex");
+    ESP_ERROR_CHECK(pid_scheduler_init(&pid_sched, obd_poll_config,
+                                       sizeof(obd_poll_config) / sizeof(obd_poll_config[0]),
+                                       hal_get_time_us()));
+    if (!ble_tx_stream_init(&ble_tx_stream, ble_tx_storage, sizeof(ble_tx_storage))) {
+        ESP_LOGE(TAG, "BLE TX stream init failed");
+    }
     
-    // Create FreeRTOS tasks
+    // Create FreeRTOS tasks (TCBs and stacks come from the static arena).
+    // The real-time path starts first so knock protection covers cranking;
+    // the BLE stack is brought up afterwards by its own task
     // Task 1: Real-time knock detection (Core 0, High Priority)
-    xTaskCreatePinnedToCore(
+    check_created(rtos_arena_create_task(
         knock_monitoring_task,
         "knock_monitor",
         4096,
         NULL,
         configMAX_PRIORITIES - 1, // Highest priority
-        NULL,
         0 // Core 0
-    );
+    ), "knock_monitor task");
     
     // Task 2: CAN PID request sender (Core 1, Medium Priority)
-    xTaskCreatePinnedToCore(
+    check_created(rtos_arena_create_task(
         can_request_sender_task,
         "can_sender",
         2048,
         NULL,
         5,
-        NULL,
         1 // Core 1
-    );
+    ), "can_sender task");
     
     // Task 3: CAN response receiver (Core 1, Medium Priority)
-    xTaskCreatePinnedToCore(
+    check_created(rtos_arena_create_task(
         can_receiver_task,
         "can_receiver",
         2048,
         NULL,
         5,
+        1 // Core 1
+    ), "can_receiver task");
+    
+    boot_trace_mark("realtime tasks");
+    
+    // Task 4: Live tuning commands (Core 1, above BLE so writes apply at once)
+    check_created(rtos_arena_create_task(
+        tuning_control_task,
+        "tuning_ctrl",
+        2048,
         NULL,
+        4,
         1 // Core 1
-    );
+    ), "tuning_ctrl task");
     
-    // Task 4: BLE communication (Core 1, Low Priority)
-    xTaskCreatePinnedToCore(
+    // Task 5: BLE bring-up, then communication (Core 1, Low Priority)
+    check_created(rtos_arena_create_task(
         ble_communication_task,
         "ble_comm",
-        2048,
+        3072,
         NULL,
         3,
+        1 // Core 1
+    ), "ble_comm task");
+    
+    // Task 6: Deferred log formatting (Core 1, Lowest Priority)
+    check_created(rtos_arena_create_task(
+        deferred_log_task,
+        "log_drain",
+        3072,
+        NULL,
+        1,
+        1 // Core 1
+    ), "log_drain task");
+    
+    // Task 7: Runtime stats reporter (Core 1, Lowest Priority)
+    check_created(rtos_arena_create_task(
+        system_monitor_task,
+        "sys_monitor",
+        3072,
+        NULL,
+        1,
+        1 // Core 1
+    ), "sys_monitor task");
+    
+    // Task 8: Flash telemetry writer (Core 1, Lowest Priority)
+    check_created(rtos_arena_create_task(
+        telemetry_log_task,
+        "telemetry",
+        2048,
         NULL,
+        1,
         1 // Core 1
-    );
+    ), "telemetry task");
     
     ESP_LOGI(TAG, "All tasks created successfully");
+    rtos_arena_report(sizeof(ble_tx_storage) + sizeof(ble_tx_stream) + sizeof(knock_window_queue) +
+                      sizeof(knock_window) + sizeof(knock_floor) + sizeof(knock_stream_scores) +
+                      sizeof(obd_isotp_rx) + sizeof(runtime_stats_latest) + sizeof(timing_maps) +
+                      sizeof(cylinder_health));
     ESP_LOGI(TAG, "CartelWorx firmware ready for vehicle diagnostics");
 }
@@ -0,0 +1,167 @@
+#include <string.h>
+#include "obd_pid.h"
+
+#define ISOTP_PCI_SINGLE 0x0
+#define ISOTP_PCI_FIRST 0x1
+#define ISOTP_PCI_CONSECUTIVE 0x2
+#define ISOTP_PCI_FLOW_CONTROL 0x3
+#define ISOTP_PAD_BYTE 0x00
+
+// Data bytes per Mode 01 PID 0x00-0x5F (SAE J1979), 0 = unknown
+static const uint8_t s_pid_lengths[0x60] = {
+    4, 4, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1,   // 0x00
+    2, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2,   // 0x10
+    4, 2, 2, 2, 4, 4, 4, 4, 4, 4, 4, 4, 1, 1, 1, 1,   // 0x20
+    1, 2, 2, 1, 4, 4, 4, 4, 4, 4, 4, 4, 2, 2, 2, 2,   // 0x30
+    4, 4, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 4,   // 0x40
+    4, 1, 1, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2, 2, 1,   // 0x50
+};
+
+esp_err_t obd_build_mode01_request(const uint8_t *pids, uint8_t count, hal_can_frame_t *out) {
+    if (pids == NULL || out == NULL || count == 0 || count > OBD_MAX_PIDS_PER_REQUEST) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(out, ISOTP_PAD_BYTE, sizeof(*out));
+    out->id = OBD_FUNCTIONAL_REQUEST_ID;
+    out->dlc = HAL_CAN_MAX_DATA_LENGTH;       // ISO 15765-4 requires padded frames
+    out->is_extended = false;
+    out->data[0] = (ISOTP_PCI_SINGLE << 4) | (uint8_t)(1 + count);
+    out->data[1] = OBD_MODE_CURRENT_DATA;
+    memcpy(&out->data[2], pids, count);
+    return ESP_OK;
+}
+
+void obd_build_flow_control(uint32_t response_id, hal_can_frame_t *out) {
+    memset(out, ISOTP_PAD_BYTE, sizeof(*out));
+    out->id = OBD_PHYSICAL_REQUEST_BASE + ((response_id - OBD_RESPONSE_ID_BASE) & (OBD_NUM_ECUS - 1));
+    out->dlc = HAL_CAN_MAX_DATA_LENGTH;
+    out->is_extended = false;
+    out->data[0] = ISOTP_PCI_FLOW_CONTROL << 4;  // Clear to send
+    out->data[1] = 0;                            // Block size: send everything
+    out->data[2] = 0;                            // STmin: no separation
+}
+
+obd_isotp_result_t obd_isotp_feed(obd_isotp_rx_t *rx, const hal_can_frame_t *frame) {
+    if (frame->dlc == 0) {
+        return OBD_ISOTP_ERROR;
+    }
+    const uint8_t pci = frame->data[0] >> 4;
+
+    switch (pci) {
+    case ISOTP_PCI_SINGLE: {
+        const uint8_t len = frame->data[0] & 0x0F;
+        if (len == 0 || len > frame->dlc - 1) {
+            obd_isotp_reset(rx);
+            return OBD_ISOTP_ERROR;
+        }
+        memcpy(rx->buffer, &frame->data[1], len);
+        rx->expected = len;
+        rx->received = len;
+        rx->active = false;
+        return OBD_ISOTP_COMPLETE;
+    }
+    case ISOTP_PCI_FIRST: {
+        const uint16_t len = ((uint16_t)(frame->data[0] & 0x0F) << 8) | frame->data[1];
+        if (frame->dlc < HAL_CAN_MAX_DATA_LENGTH || len <= 7 || len > OBD_ISOTP_MAX_PAYLOAD) {
+            obd_isotp_reset(rx);
+            return OBD_ISOTP_ERROR;
+        }
+        memcpy(rx->buffer, &frame->data[2], 6);
+        rx->expected = len;
+        rx->received = 6;
+        rx->next_seq = 1;
+        rx->active = true;
+        return OBD_ISOTP_NEED_FLOW_CONTROL;
+    }
+    case ISOTP_PCI_CONSECUTIVE: {
+        if (!rx->active) {
+            return OBD_ISOTP_ERROR;
+        }
+        if ((frame->data[0] & 0x0F) != rx->next_seq) {
+            obd_isotp_reset(rx);
+            return OBD_ISOTP_ERROR;
+        }
+        uint16_t chunk = rx->expected - rx->received;
+        if (chunk > frame->dlc - 1) {
+            chunk = frame->dlc - 1;
+        }
+        memcpy(&rx->buffer[rx->received], &frame->data[1], chunk);
+        rx->received += chunk;
+        rx->next_seq = (rx->next_seq + 1) & 0x0F;
+        if (rx->received < rx->expected) {
+            return OBD_ISOTP_INCOMPLETE;
+        }
+        rx->active = false;
+        return OBD_ISOTP_COMPLETE;
+    }
+    default:
+        // Flow control from the ECU only applies to our transmissions
+        return OBD_ISOTP_INCOMPLETE;
+    }
+}
+
+uint8_t obd_pid_data_length(uint8_t pid) {
+    return (pid < sizeof(s_pid_lengths)) ? s_pid_lengths[pid] : 0;
+}
+
+uint8_t obd_parse_mode01_response(const uint8_t *payload,
+                                  uint16_t len,
+                                  obd_pid_value_t *values,
+                                  uint8_t max_values) {
+    if (len < 1 || payload[0] != (OBD_MODE_CURRENT_DATA + OBD_POSITIVE_RESPONSE_OFFSET)) {
+        return 0;
+    }
+
+    uint8_t n = 0;
+    uint16_t pos = 1;
+    while (pos < len && n < max_values) {
+        const uint8_t pid = payload[pos];
+        const uint8_t data_len = obd_pid_data_length(pid);
+        if (data_len == 0 || pos + 1 + data_len > len) {
+            break;
+        }
+        values[n].pid = pid;
+        values[n].len = data_len;
+        memcpy(values[n].data, &payload[pos + 1], data_len);
+        n++;
+        pos += 1 + data_len;
+    }
+    return n;
+}
+
+float obd_pid_decode(const obd_pid_value_t *value) {
+    const float a = value->data[0];
+    const float b = (value->len > 1) ? value->data[1] : 0.0f;
+
+    switch (value->pid) {
+    case 0x0C: // Engine RPM
+        return (256.0f * a + b) / 4.0f;
+    case 0x05: // Coolant temperature
+    case 0x0F: // Intake air temperature
+    case 0x46: // Ambient air temperature
+        return a - 40.0f;
+    case 0x0B: // Intake manifold pressure
+    case 0x0D: // Vehicle speed
+        return a;
+    case 0x0E: // Timing advance
+        return a / 2.0f - 64.0f;
+    case 0x10: // MAF air flow rate, g/s
+        return (256.0f * a + b) / 100.0f;
+    case 0x04: // Calculated load
+    case 0x11: // Throttle position
+    case 0x2F: // Fuel level
+    case 0x45: // Relative throttle position
+        return a * 100.0f / 255.0f;
+    default:
+        if (value->pid >= 0x14 && value->pid <= 0x1B) {
+            return a / 200.0f; // O2 sensor voltage
+        }
+        break;
+    }
+
+    uint32_t raw = 0;
+    for (uint8_t i = 0; i < value->len; i++) {
+        raw = (raw << 8) | value->data[i];
+    }
+    return (float)raw;
+}
@@ -0,0 +1,190 @@
+#include <string.h>
+#include "pid_scheduler.h"
+
+esp_err_t pid_scheduler_init(pid_scheduler_t *sched,
+                             const pid_sched_config_t *configs,
+                             uint8_t count,
+                             uint64_t now_us) {
+    if (sched == NULL || configs == NULL || count == 0 || count > PID_SCHED_MAX_ENTRIES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(sched, 0, sizeof(*sched));
+    for (uint8_t i = 0; i < count; i++) {
+        if (configs[i].target_hz == 0 || configs[i].target_hz > 1000 ||
+            obd_pid_data_length(configs[i].pid) == 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        pid_sched_entry_t *e = &sched->entries[i];
+        e->config = configs[i];
+        e->period_us = 1000000UL / configs[i].target_hz;
+        e->next_due_us = now_us;
+    }
+    sched->count = count;
+    sched->responder = PID_SCHED_NO_RESPONDER;
+    sched->latency_us = PID_SCHED_RESPONSE_TIMEOUT_US / 4; // Refined by the first responses
+    sched->rate_window_start_us = now_us;
+    return ESP_OK;
+}
+
+static void roll_rate_window(pid_scheduler_t *sched, uint64_t now_us) {
+    const uint64_t elapsed = now_us - sched->rate_window_start_us;
+    if (elapsed < PID_SCHED_RATE_WINDOW_US) {
+        return;
+    }
+    for (uint8_t i = 0; i < sched->count; i++) {
+        pid_sched_entry_t *e = &sched->entries[i];
+        uint64_t hz_x10 = ((uint64_t)e->window_responses * 10000000ULL) / elapsed;
+        e->achieved_hz_x10 = (hz_x10 > UINT16_MAX) ? UINT16_MAX : (uint16_t)hz_x10;
+        e->window_responses = 0;
+    }
+    sched->rate_window_start_us = now_us;
+}
+
+static void update_latency(pid_scheduler_t *sched, uint32_t sample_us) {
+    int32_t delta = (int32_t)sample_us - (int32_t)sched->latency_us;
+    sched->latency_us = (uint32_t)((int32_t)sched->latency_us + (delta >> PID_SCHED_LATENCY_SHIFT));
+}
+
+// Highest priority, then most overdue, among unselected entries due by `until`
+static int pick_entry(const pid_scheduler_t *sched, const bool *chosen, uint64_t until) {
+    int best = -1;
+    for (uint8_t i = 0; i < sched->count; i++) {
+        const pid_sched_entry_t *e = &sched->entries[i];
+        if (chosen[i] || e->next_due_us > until) {
+            continue;
+        }
+        if (best < 0) {
+            best = i;
+            continue;
+        }
+        const pid_sched_entry_t *b = &sched->entries[best];
+        if (e->config.priority > b->config.priority ||
+            (e->config.priority == b->config.priority && e->next_due_us < b->next_due_us)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+uint8_t pid_scheduler_next_batch(pid_scheduler_t *sched,
+                                 uint64_t now_us,
+                                 uint8_t *pids,
+                                 uint8_t max_pids) {
+    if (sched->awaiting_response) {
+        if (now_us - sched->request_sent_us < PID_SCHED_RESPONSE_TIMEOUT_US) {
+            return 0;
+        }
+        // No answer: release the slot and count a miss against every PID in flight
+        for (uint8_t i = 0; i < sched->count; i++) {
+            if (sched->entries[i].in_flight) {
+                sched->entries[i].in_flight = false;
+                sched->entries[i].timeouts++;
+            }
+        }
+        sched->awaiting_response = false;
+        sched->responder = PID_SCHED_NO_RESPONDER; // It may be gone: take whichever ECU answers next
+        update_latency(sched, PID_SCHED_RESPONSE_TIMEOUT_US);
+    }
+    roll_rate_window(sched, now_us);
+
+    if (max_pids > OBD_MAX_PIDS_PER_REQUEST) {
+        max_pids = OBD_MAX_PIDS_PER_REQUEST;
+    }
+    bool chosen[PID_SCHED_MAX_ENTRIES] = {false};
+    uint8_t n = 0;
+
+    // Overdue PIDs first, then top up with PIDs due before the response returns
+    const uint64_t horizons[2] = {now_us, now_us + sched->latency_us};
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        if (pass == 1 && n == 0) {
+            break; // Nothing due yet: wait rather than send only pulled-ahead PIDs
+        }
+        while (n < max_pids) {
+            int idx = pick_entry(sched, chosen, horizons[pass]);
+            if (idx < 0) {
+                break;
+            }
+            chosen[idx] = true;
+            pids[n++] = sched->entries[idx].config.pid;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < sched->count; i++) {
+        if (!chosen[i]) {
+            continue;
+        }
+        pid_sched_entry_t *e = &sched->entries[i];
+        e->in_flight = true;
+        e->next_due_us += e->period_us;
+        if (e->next_due_us < now_us) {
+            e->next_due_us = now_us; // Fell behind: do not burst to catch up
+        }
+    }
+    sched->awaiting_response = true;
+    sched->request_sent_us = now_us;
+    return n;
+}
+
+uint64_t pid_scheduler_next_event_us(const pid_scheduler_t *sched) {
+    if (sched->awaiting_response) {
+        return sched->request_sent_us + PID_SCHED_RESPONSE_TIMEOUT_US;
+    }
+    uint64_t next = UINT64_MAX;
+    for (uint8_t i = 0; i < sched->count; i++) {
+        if (sched->entries[i].next_due_us < next) {
+            next = sched->entries[i].next_due_us;
+        }
+    }
+    return next;
+}
+
+bool pid_scheduler_on_response(pid_scheduler_t *sched,
+                               uint64_t now_us,
+                               uint8_t ecu,
+                               const obd_pid_value_t *values,
+                               uint8_t count) {
+    if (!sched->awaiting_response ||
+        (sched->responder != PID_SCHED_NO_RESPONDER && ecu != sched->responder)) {
+        // Another ECU's answer, or one arriving after the request was settled
+        roll_rate_window(sched, now_us);
+        return false;
+    }
+    sched->responder = ecu;
+    update_latency(sched, (uint32_t)(now_us - sched->request_sent_us));
+    sched->awaiting_response = false;
+    for (uint8_t v = 0; v < count; v++) {
+        for (uint8_t i = 0; i < sched->count; i++) {
+            pid_sched_entry_t *e = &sched->entries[i];
+            if (e->config.pid == values[v].pid) {
+                e->window_responses++;
+                e->in_flight = false;
+                break;
+            }
+        }
+    }
+    // Left out of the reply: unsupported, or dropped by the ECU
+    for (uint8_t i = 0; i < sched->count; i++) {
+        if (sched->entries[i].in_flight) {
+            sched->entries[i].in_flight = false;
+            sched->entries[i].timeouts++;
+        }
+    }
+    roll_rate_window(sched, now_us);
+    return true;
+}
+
+bool pid_scheduler_get_stats(const pid_scheduler_t *sched, uint8_t index, pid_sched_stats_t *out) {
+    if (index >= sched->count || out == NULL) {
+        return false;
+    }
+    const pid_sched_entry_t *e = &sched->entries[index];
+    out->pid = e->config.pid;
+    out->priority = e->config.priority;
+    out->target_hz = e->config.target_hz;
+    out->achieved_hz_x10 = e->achieved_hz_x10;
+    out->timeouts = e->timeouts;
+    return true;
+}
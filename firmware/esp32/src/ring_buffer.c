@@ -0,0 +1,139 @@
+#include "ring_buffer.h"
+
+// head/tail are element indices; size is in bytes, capacity in elements
+
+bool ring_buffer_init(ring_buffer_t *rb,
+                      uint8_t *buffer,
+                      uint32_t buffer_size,
+                      uint32_t element_size) {
+    if (rb == NULL || buffer == NULL || element_size == 0 ||
+        buffer_size < element_size || (buffer_size % element_size) != 0) {
+        return false;
+    }
+    rb->buffer = buffer;
+    rb->size = buffer_size;
+    rb->element_size = element_size;
+    ring_buffer_clear(rb);
+    return true;
+}
+
+bool ring_buffer_push(ring_buffer_t *rb, const void *element) {
+    if (rb == NULL || element == NULL) {
+        return false;
+    }
+    const uint32_t capacity = ring_buffer_capacity(rb);
+    memcpy(rb->buffer + rb->head * rb->element_size, element, rb->element_size);
+    rb->head = (rb->head + 1) % capacity;
+    if (rb->count == capacity) {
+        rb->tail = (rb->tail + 1) % capacity; // Overwrote the oldest element
+    } else {
+        rb->count++;
+    }
+    return true;
+}
+
+uint32_t ring_buffer_push_multiple(ring_buffer_t *rb,
+                                     const void *elements,
+                                     uint32_t count) {
+    if (rb == NULL || elements == NULL) {
+        return 0;
+    }
+    const uint8_t *src = (const uint8_t *)elements;
+    for (uint32_t i = 0; i < count; i++) {
+        ring_buffer_push(rb, src + i * rb->element_size);
+    }
+    return count;
+}
+
+bool ring_buffer_pop(ring_buffer_t *rb, void *element) {
+    if (rb == NULL || element == NULL || rb->count == 0) {
+        return false;
+    }
+    memcpy(element, rb->buffer + rb->tail * rb->element_size, rb->element_size);
+    rb->tail = (rb->tail + 1) % ring_buffer_capacity(rb);
+    rb->count--;
+    return true;
+}
+
+uint32_t ring_buffer_pop_multiple(ring_buffer_t *rb,
+                                    void *elements,
+                                    uint32_t count) {
+    if (rb == NULL || elements == NULL) {
+        return 0;
+    }
+    uint8_t *dst = (uint8_t *)elements;
+    uint32_t n = 0;
+    while (n < count && ring_buffer_pop(rb, dst + n * rb->element_size)) {
+        n++;
+    }
+    return n;
+}
+
+bool ring_buffer_peek(const ring_buffer_t *rb, void *element) {
+    return ring_buffer_peek_at(rb, 0, element);
+}
+
+bool ring_buffer_peek_at(const ring_buffer_t *rb,
+                         uint32_t index,
+                         void *element) {
+    if (rb == NULL || element == NULL || index >= rb->count) {
+        return false;
+    }
+    const uint32_t slot = (rb->tail + index) % ring_buffer_capacity(rb);
+    memcpy(element, rb->buffer + slot * rb->element_size, rb->element_size);
+    return true;
+}
+
+void *ring_buffer_get_write_region(ring_buffer_t *rb, uint32_t *out_size) {
+    if (rb == NULL || out_size == NULL || ring_buffer_is_full(rb)) {
+        if (out_size != NULL) {
+            *out_size = 0;
+        }
+        return NULL;
+    }
+    // Contiguous free space runs to the end of the buffer or up to tail
+    const uint32_t capacity = ring_buffer_capacity(rb);
+    const uint32_t elements = (rb->head >= rb->tail) ? capacity - rb->head : rb->tail - rb->head;
+    *out_size = elements * rb->element_size;
+    return rb->buffer + rb->head * rb->element_size;
+}
+
+bool ring_buffer_advance_write(ring_buffer_t *rb, uint32_t bytes_written) {
+    if (rb == NULL || (bytes_written % rb->element_size) != 0) {
+        return false;
+    }
+    const uint32_t elements = bytes_written / rb->element_size;
+    if (elements > ring_buffer_available(rb)) {
+        return false;
+    }
+    rb->head = (rb->head + elements) % ring_buffer_capacity(rb);
+    rb->count += elements;
+    return true;
+}
+
+const void *ring_buffer_get_read_region(const ring_buffer_t *rb, uint32_t *out_size) {
+    if (rb == NULL || out_size == NULL || rb->count == 0) {
+        if (out_size != NULL) {
+            *out_size = 0;
+        }
+        return NULL;
+    }
+    // Contiguous data runs up to head or to the end of the buffer
+    const uint32_t capacity = ring_buffer_capacity(rb);
+    const uint32_t elements = (rb->tail < rb->head) ? rb->head - rb->tail : capacity - rb->tail;
+    *out_size = elements * rb->element_size;
+    return rb->buffer + rb->tail * rb->element_size;
+}
+
+bool ring_buffer_advance_read(ring_buffer_t *rb, uint32_t bytes_read) {
+    if (rb == NULL || (bytes_read % rb->element_size) != 0) {
+        return false;
+    }
+    const uint32_t elements = bytes_read / rb->element_size;
+    if (elements > rb->count) {
+        return false;
+    }
+    rb->tail = (rb->tail + elements) % ring_buffer_capacity(rb);
+    rb->count -= elements;
+    return true;
+}
@@ -0,0 +1,71 @@
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include "rtos_arena.h"
+
+#define TAG "CartelWorx-Arena"
+
+static StaticTask_t s_tcbs[RTOS_ARENA_MAX_TASKS];
+static StackType_t s_stacks[RTOS_ARENA_STACK_BYTES] __attribute__((aligned(RTOS_ARENA_STACK_ALIGN)));
+static StaticSemaphore_t s_semaphores[RTOS_ARENA_MAX_SEMAPHORES];
+static StaticEventGroup_t s_event_groups[RTOS_ARENA_MAX_EVENT_GROUPS];
+static uint8_t s_task_count;
+static uint8_t s_semaphore_count;
+static uint8_t s_event_group_count;
+static uint32_t s_stack_used;
+
+TaskHandle_t rtos_arena_create_task(TaskFunction_t fn,
+                                    const char *name,
+                                    uint32_t stack_bytes,
+                                    void *arg,
+                                    UBaseType_t priority,
+                                    BaseType_t core) {
+    const uint32_t size = (stack_bytes + RTOS_ARENA_STACK_ALIGN - 1) & ~(uint32_t)(RTOS_ARENA_STACK_ALIGN - 1);
+    if (s_task_count >= RTOS_ARENA_MAX_TASKS || size > RTOS_ARENA_STACK_BYTES - s_stack_used) {
+        ESP_LOGE(TAG, "No room for task %s (%lu bytes stack, %lu free)", name,
+                 (unsigned long)size, (unsigned long)(RTOS_ARENA_STACK_BYTES - s_stack_used));
+        return NULL;
+    }
+    // ESP-IDF stack depth is in bytes (StackType_t is uint8_t)
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(fn, name, size, arg, priority,
+                                                      &s_stacks[s_stack_used], &s_tcbs[s_task_count], core);
+    s_task_count++;
+    s_stack_used += size;
+    return task;
+}
+
+SemaphoreHandle_t rtos_arena_create_mutex(void) {
+    if (s_semaphore_count >= RTOS_ARENA_MAX_SEMAPHORES) {
+        ESP_LOGE(TAG, "No room for mutex (max %d)", RTOS_ARENA_MAX_SEMAPHORES);
+        return NULL;
+    }
+    return xSemaphoreCreateMutexStatic(&s_semaphores[s_semaphore_count++]);
+}
+
+EventGroupHandle_t rtos_arena_create_event_group(void) {
+    if (s_event_group_count >= RTOS_ARENA_MAX_EVENT_GROUPS) {
+        ESP_LOGE(TAG, "No room for event group (max %d)", RTOS_ARENA_MAX_EVENT_GROUPS);
+        return NULL;
+    }
+    return xEventGroupCreateStatic(&s_event_groups[s_event_group_count++]);
+}
+
+void rtos_arena_get_usage(rtos_arena_usage_t *out) {
+    out->tasks = s_task_count;
+    out->semaphores = s_semaphore_count;
+    out->event_groups = s_event_group_count;
+    out->stack_used = s_stack_used;
+    out->footprint = sizeof(s_tcbs) + sizeof(s_stacks) + sizeof(s_semaphores) + sizeof(s_event_groups);
+}
+
+void rtos_arena_report(uint32_t app_static_bytes) {
+    rtos_arena_usage_t usage;
+    rtos_arena_get_usage(&usage);
+    ESP_LOGI(TAG, "Tasks %u/%d, stacks %lu/%d bytes, mutexes %u/%d, event groups %u/%d",
+             usage.tasks, RTOS_ARENA_MAX_TASKS, (unsigned long)usage.stack_used, RTOS_ARENA_STACK_BYTES,
+             usage.semaphores, RTOS_ARENA_MAX_SEMAPHORES, usage.event_groups, RTOS_ARENA_MAX_EVENT_GROUPS);
+    ESP_LOGI(TAG, "Static footprint %lu bytes (arena %lu, buffers %lu); heap free %lu, min %lu",
+             (unsigned long)(usage.footprint + app_static_bytes), (unsigned long)usage.footprint,
+             (unsigned long)app_static_bytes,
+             (unsigned long)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+}
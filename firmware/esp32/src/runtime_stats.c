@@ -0,0 +1,128 @@
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "runtime_stats.h"
+
+#define TAG "CartelWorx-Stats"
+#define RUNTIME_STATS_SCAN_MAX (RUNTIME_STATS_MAX_TASKS + 4) // Headroom for tasks created mid-scan
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+static TaskStatus_t s_status[RUNTIME_STATS_SCAN_MAX];
+static TaskHandle_t s_prev_handle[RUNTIME_STATS_SCAN_MAX];
+static uint32_t s_prev_runtime[RUNTIME_STATS_SCAN_MAX];
+static UBaseType_t s_prev_count;
+static uint32_t s_prev_total;
+
+// Run-time counter of the same task at the previous snapshot, 0 if it is new
+static uint32_t previous_runtime(TaskHandle_t handle) {
+    for (UBaseType_t i = 0; i < s_prev_count; i++) {
+        if (s_prev_handle[i] == handle) {
+            return s_prev_runtime[i];
+        }
+    }
+    return 0;
+}
+#endif
+
+void runtime_stats_sample(runtime_stats_t *out, const runtime_counters_t *counters) {
+    memset(out, 0, sizeof(*out));
+    out->counters = *counters;
+    out->heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    out->heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    uint32_t total = 0;
+    UBaseType_t n = uxTaskGetSystemState(s_status, RUNTIME_STATS_SCAN_MAX, &total);
+    const uint32_t elapsed = total - s_prev_total;
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        const TaskStatus_t *st = &s_status[i];
+        const uint32_t delta = st->ulRunTimeCounter - previous_runtime(st->xHandle);
+        const uint16_t permille = elapsed ? (uint16_t)(((uint64_t)delta * 1000) / elapsed) : 0;
+        const uint8_t core = (st->xCoreID < RUNTIME_STATS_CORES) ? (uint8_t)st->xCoreID : RUNTIME_STATS_CORES;
+
+        for (uint8_t c = 0; c < RUNTIME_STATS_CORES; c++) {
+            if (st->xHandle == xTaskGetIdleTaskHandleForCPU(c)) {
+                out->idle_permille[c] = permille;
+            }
+        }
+        if (out->task_count < RUNTIME_STATS_MAX_TASKS) {
+            runtime_task_stats_t *t = &out->tasks[out->task_count++];
+            strncpy(t->name, st->pcTaskName, sizeof(t->name) - 1);
+            t->core = core;
+            t->priority = (uint8_t)st->uxCurrentPriority;
+            t->cpu_permille = permille;
+            t->stack_free_min = st->usStackHighWaterMark; // Bytes on ESP-IDF
+        }
+        s_prev_handle[i] = st->xHandle;
+        s_prev_runtime[i] = st->ulRunTimeCounter;
+    }
+    s_prev_count = n;
+    s_prev_total = total;
+#endif
+}
+
+void runtime_stats_log(const runtime_stats_t *stats) {
+    const runtime_counters_t *c = &stats->counters;
+    ESP_LOGI(TAG, "heap %lu (min %lu), idle %u/%u permille, queued: knock %lu ble %lu, "
+             "drops: knock %lu adc %lu can %lu ble %lu log %lu telemetry %lu (drive full %lu)",
+             (unsigned long)stats->heap_free, (unsigned long)stats->heap_min_free,
+             stats->idle_permille[0], stats->idle_permille[1],
+             (unsigned long)c->knock_window_depth, (unsigned long)c->ble_tx_bytes,
+             (unsigned long)c->knock_window_overflows, (unsigned long)c->adc_overruns,
+             (unsigned long)c->can_rx_overflows, (unsigned long)c->ble_tx_dropped, (unsigned long)c->log_dropped,
+             (unsigned long)c->telemetry_dropped, (unsigned long)c->telemetry_drive_full);
+    for (uint8_t i = 0; i < stats->task_count; i++) {
+        const runtime_task_stats_t *t = &stats->tasks[i];
+        ESP_LOGI(TAG, "  %-16s core %u prio %2u cpu %3u permille stack free %lu",
+                 t->name, t->core, t->priority, t->cpu_permille, (unsigned long)t->stack_free_min);
+    }
+}
+
+static inline uint8_t *put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static inline uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    p = put_u16(p, (uint16_t)v);
+    return put_u16(p, (uint16_t)(v >> 16));
+}
+
+uint16_t runtime_stats_serialize(const runtime_stats_t *stats, uint8_t *out, uint16_t capacity) {
+    if (capacity < RUNTIME_STATS_SERIALIZED_MAX) {
+        return 0;
+    }
+    uint8_t *p = out;
+    *p++ = RUNTIME_STATS_FORMAT_VERSION;
+    *p++ = stats->task_count;
+    for (uint8_t c = 0; c < RUNTIME_STATS_CORES; c++) {
+        p = put_u16(p, stats->idle_permille[c]);
+    }
+    p = put_u32(p, stats->heap_free);
+    p = put_u32(p, stats->heap_min_free);
+    p = put_u32(p, stats->counters.knock_window_depth);
+    p = put_u32(p, stats->counters.ble_tx_bytes);
+    p = put_u32(p, stats->counters.knock_window_overflows);
+    p = put_u32(p, stats->counters.adc_overruns);
+    p = put_u32(p, stats->counters.can_rx_overflows);
+    p = put_u32(p, stats->counters.ble_tx_dropped);
+    p = put_u32(p, stats->counters.log_dropped);
+    p = put_u32(p, stats->counters.telemetry_dropped);
+    p = put_u32(p, stats->counters.telemetry_drive_full);
+    for (uint8_t i = 0; i < stats->task_count; i++) {
+        const runtime_task_stats_t *t = &stats->tasks[i];
+        memset(p, 0, configMAX_TASK_NAME_LEN);
+        memcpy(p, t->name, strnlen(t->name, configMAX_TASK_NAME_LEN));
+        p += configMAX_TASK_NAME_LEN;
+        *p++ = t->core;
+        *p++ = t->priority;
+        p = put_u16(p, t->cpu_permille);
+        p = put_u32(p, t->stack_free_min);
+    }
+    return (uint16_t)(p - out);
+}
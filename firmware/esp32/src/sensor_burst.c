@@ -0,0 +1,124 @@
+#include "sensor_burst.h"
+
+static inline uint32_t zigzag_encode(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Returns bytes written, 0 if it does not fit
+static inline uint16_t put_varint(uint8_t *out, uint16_t pos, uint16_t capacity, uint32_t v) {
+    uint16_t start = pos;
+    do {
+        if (pos >= capacity) {
+            return 0;
+        }
+        uint8_t byte = v & 0x7F;
+        v >>= 7;
+        out[pos++] = byte | (v ? 0x80 : 0);
+    } while (v);
+    return pos - start;
+}
+
+// Returns bytes consumed, 0 if truncated or longer than 32 bits
+static inline uint16_t get_varint(const uint8_t *in, uint16_t pos, uint16_t len, uint32_t *v) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < SENSOR_BURST_VARINT_MAX && pos + i < len; i++) {
+        value |= (uint32_t)(in[pos + i] & 0x7F) << (7 * i);
+        if ((in[pos + i] & 0x80) == 0) {
+            *v = value;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+uint16_t sensor_burst_encode(const sensor_burst_t *burst, uint8_t *out, uint16_t capacity) {
+    if (burst->channel_count == 0 || burst->channel_count > SENSOR_BURST_MAX_CHANNELS ||
+        burst->sample_count == 0 || burst->sample_count > SENSOR_BURST_MAX_SAMPLES ||
+        capacity < SENSOR_BURST_HEADER_SIZE) {
+        return 0;
+    }
+    out[0] = burst->channel_count;
+    out[1] = burst->sample_count;
+    out[2] = (uint8_t)(burst->base_timestamp_us);
+    out[3] = (uint8_t)(burst->base_timestamp_us >> 8);
+    out[4] = (uint8_t)(burst->base_timestamp_us >> 16);
+    out[5] = (uint8_t)(burst->base_timestamp_us >> 24);
+    uint16_t pos = SENSOR_BURST_HEADER_SIZE;
+    uint16_t n = put_varint(out, pos, capacity, burst->period_us);
+    if (n == 0) {
+        return 0;
+    }
+    pos += n;
+
+    for (uint8_t ch = 0; ch < burst->channel_count; ch++) {
+        if (pos >= capacity) {
+            return 0;
+        }
+        out[pos++] = burst->channel_ids[ch];
+        const int32_t *s = &burst->samples[(uint32_t)ch * burst->sample_count];
+        int32_t prev = 0; // Keyframe is the delta from zero
+        for (uint8_t i = 0; i < burst->sample_count; i++) {
+            // Wrapping difference: decodes back exactly even across the int32 range
+            int32_t delta = (int32_t)((uint32_t)s[i] - (uint32_t)prev);
+            n = put_varint(out, pos, capacity, zigzag_encode(delta));
+            if (n == 0) {
+                return 0;
+            }
+            pos += n;
+            prev = s[i];
+        }
+    }
+    return pos;
+}
+
+bool sensor_burst_decode(const uint8_t *in,
+                         uint16_t len,
+                         uint8_t *channel_ids,
+                         int32_t *samples,
+                         sensor_burst_t *out) {
+    if (len < SENSOR_BURST_HEADER_SIZE) {
+        return false;
+    }
+    const uint8_t channels = in[0];
+    const uint8_t count = in[1];
+    if (channels == 0 || channels > SENSOR_BURST_MAX_CHANNELS ||
+        count == 0 || count > SENSOR_BURST_MAX_SAMPLES) {
+        return false;
+    }
+    out->channel_count = channels;
+    out->sample_count = count;
+    out->base_timestamp_us = (uint32_t)in[2] | ((uint32_t)in[3] << 8) |
+                             ((uint32_t)in[4] << 16) | ((uint32_t)in[5] << 24);
+    uint16_t pos = SENSOR_BURST_HEADER_SIZE;
+    uint16_t n = get_varint(in, pos, len, &out->period_us);
+    if (n == 0) {
+        return false;
+    }
+    pos += n;
+
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        if (pos >= len) {
+            return false;
+        }
+        channel_ids[ch] = in[pos++];
+        int32_t *s = &samples[(uint32_t)ch * count];
+        int32_t prev = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t zz;
+            n = get_varint(in, pos, len, &zz);
+            if (n == 0) {
+                return false;
+            }
+            pos += n;
+            prev = (int32_t)((uint32_t)prev + (uint32_t)zigzag_decode(zz));
+            s[i] = prev;
+        }
+    }
+    out->channel_ids = channel_ids;
+    out->samples = samples;
+    return pos == len;
+}
@@ -0,0 +1,399 @@
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include "telemetry_log.h"
+#include "ble_tx_stream.h"
+
+#define TAG "CartelWorx-Telemetry"
+
+#define TELEMETRY_STAGE_SIZE (4 * TELEMETRY_PAGE_SIZE)
+#define TELEMETRY_RECORD_PREFIX BLE_TX_STREAM_HEADER_SIZE
+#define TELEMETRY_RECORD_END 0xFFFF  // Erased prefix: no more frames in this sector
+
+static const esp_partition_t *s_part;
+static const uint8_t *s_map; // Whole partition, memory-mapped
+static esp_partition_mmap_handle_t s_map_handle;
+static uint32_t s_sectors;
+static uint32_t s_erase_target;  // Erased headroom to build while erasing is allowed
+
+static uint8_t s_stream_storage[TELEMETRY_STREAM_SIZE];
+static ble_tx_stream_t s_stream; // Producers -> writer task
+static bool s_ready = false;
+
+// Writer state; the lock covers what playback reads, never a flash operation
+static SemaphoreHandle_t s_lock;
+static StaticSemaphore_t s_lock_storage;
+static uint32_t s_head;          // Sector being (or last) written
+static uint32_t s_head_seq;      // Its sequence number, 0 = none yet
+static bool s_head_open = false; // Head has a header and accepts frames
+static uint32_t s_flush_pos;     // Head bytes already in flash
+static uint32_t s_erased_ahead;  // Sectors after the head erased (or being erased) for it
+static bool s_erase_allowed = false;
+static bool s_playback_active = false;
+static telemetry_log_stats_t s_stats;
+
+// Program slots, knock task -> writer
+static SemaphoreHandle_t s_slot;
+static StaticSemaphore_t s_slot_storage;
+static uint32_t s_slot_us;       // When the last slot was handed out
+
+static uint8_t s_stage[TELEMETRY_STAGE_SIZE]; // Head bytes from s_flush_pos, not yet in flash
+static uint32_t s_stage_len;
+
+static inline uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void write_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline const uint8_t *sector_ptr(uint32_t sector) {
+    return s_map + sector * TELEMETRY_SECTOR_SIZE;
+}
+
+// Sequence number of a sector holding frames, 0 if it has none
+static uint32_t sector_sequence(uint32_t sector) {
+    const uint8_t *p = sector_ptr(sector);
+    const uint32_t seq = read_u32(p + 4);
+    return (read_u32(p) == TELEMETRY_SECTOR_MAGIC && seq != 0xFFFFFFFF) ? seq : 0;
+}
+
+static bool sector_erased(uint32_t sector) {
+    const uint32_t *p = (const uint32_t *)sector_ptr(sector);
+    for (uint32_t i = 0; i < TELEMETRY_SECTOR_SIZE / sizeof(uint32_t); i++) {
+        if (p[i] != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Find the newest sector; after a reset it is closed, since its last frame may be torn
+static void locate_head(void) {
+    uint32_t head = s_sectors - 1;
+    uint32_t head_seq = 0;
+    for (uint32_t s = 0; s < s_sectors; s++) {
+        const uint32_t seq = sector_sequence(s);
+        if (seq > head_seq) {
+            head_seq = seq;
+            head = s;
+        }
+    }
+    uint32_t erased = 0;
+    while (erased + 1 < s_sectors && sector_erased((head + 1 + erased) % s_sectors)) {
+        erased++;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_head = head;
+    s_head_seq = head_seq;
+    s_head_open = false;
+    s_erased_ahead = erased;
+    xSemaphoreGive(s_lock);
+    ESP_LOGI(TAG, "%lu sectors, head sequence %lu, %lu erased ahead", (unsigned long)s_sectors,
+             (unsigned long)head_seq, (unsigned long)erased);
+}
+
+// Wait until the knock task has just gone idle; a slot the writer was too late for is skipped
+static void wait_program_slot(void) {
+    while (1) {
+        xSemaphoreTake(s_slot, portMAX_DELAY);
+        const uint32_t age_us = (uint32_t)esp_timer_get_time() - __atomic_load_n(&s_slot_us, __ATOMIC_RELAXED);
+        if (age_us < TELEMETRY_PROGRAM_SLOT_US) {
+            return;
+        }
+    }
+}
+
+// Program staged bytes one flash page per program slot, so each stall is a
+// single page program that falls between two knock blocks
+static void flush_stage(void) {
+    uint32_t done = 0;
+    while (done < s_stage_len) {
+        // Page-aligned chunks, so the driver never splits one into two programs
+        const uint32_t offset = s_head * TELEMETRY_SECTOR_SIZE + s_flush_pos + done;
+        uint32_t chunk = TELEMETRY_PAGE_SIZE - offset % TELEMETRY_PAGE_SIZE;
+        if (chunk > s_stage_len - done) {
+            chunk = s_stage_len - done;
+        }
+        wait_program_slot();
+        if (esp_partition_write(s_part, offset, s_stage + done, chunk) != ESP_OK) {
+            s_stats.write_errors++;
+            break;
+        }
+        done += chunk;
+    }
+    s_stats.bytes_written += done;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_flush_pos += s_stage_len; // A failed page is skipped, not retried over programmed bits
+    xSemaphoreGive(s_lock);
+    s_stage_len = 0;
+}
+
+// Erase the oldest sector into the headroom, if erasing is allowed now
+static bool erase_one_ahead(void) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    const bool allowed = s_erase_allowed && !s_playback_active && s_erased_ahead + 1 < s_sectors;
+    const uint32_t target = (s_head + 1 + s_erased_ahead) % s_sectors;
+    if (allowed) {
+        s_erased_ahead++; // Claimed first: playback starts past it from here on
+    }
+    xSemaphoreGive(s_lock);
+    if (!allowed) {
+        return false;
+    }
+    if (esp_partition_erase_range(s_part, target * TELEMETRY_SECTOR_SIZE, TELEMETRY_SECTOR_SIZE) != ESP_OK) {
+        s_stats.write_errors++;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_erased_ahead--;
+        xSemaphoreGive(s_lock);
+        return false;
+    }
+    return true;
+}
+
+static bool open_next_sector(void) {
+    if (s_erased_ahead == 0 && !erase_one_ahead()) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_head = (s_head + 1) % s_sectors;
+    s_head_seq++;
+    s_erased_ahead--;
+    s_flush_pos = 0;
+    s_head_open = true;
+    xSemaphoreGive(s_lock);
+    write_u32(s_stage, TELEMETRY_SECTOR_MAGIC);
+    write_u32(s_stage + 4, s_head_seq);
+    s_stage_len = TELEMETRY_SECTOR_HEADER_SIZE;
+    return true;
+}
+
+static void append_frame(const uint8_t *frame, uint16_t len) {
+    const uint32_t record = TELEMETRY_RECORD_PREFIX + len;
+    if (s_head_open && s_flush_pos + s_stage_len + record > TELEMETRY_SECTOR_SIZE) {
+        flush_stage();
+        s_head_open = false; // Frames never straddle sectors
+    }
+    if (!s_head_open && !open_next_sector()) {
+        s_stats.frames_dropped++;
+        s_stats.drive_full++;
+        return;
+    }
+    if (s_stage_len + record > sizeof(s_stage)) {
+        flush_stage();
+    }
+    s_stage[s_stage_len] = (uint8_t)(len & 0xFF);
+    s_stage[s_stage_len + 1] = (uint8_t)(len >> 8);
+    memcpy(s_stage + s_stage_len + TELEMETRY_RECORD_PREFIX, frame, len);
+    s_stage_len += record;
+}
+
+esp_err_t telemetry_log_init(void) {
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_storage);
+    s_slot = xSemaphoreCreateBinaryStatic(&s_slot_storage);
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)TELEMETRY_PARTITION_SUBTYPE,
+                                      TELEMETRY_PARTITION_LABEL);
+    if (s_part == NULL) {
+        ESP_LOGW(TAG, "No telemetry partition, recorder off");
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_sectors = s_part->size / TELEMETRY_SECTOR_SIZE;
+    if (s_sectors < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const void *map;
+    esp_err_t err = esp_partition_mmap(s_part, 0, s_sectors * TELEMETRY_SECTOR_SIZE, ESP_PARTITION_MMAP_DATA,
+                                       &map, &s_map_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_map = (const uint8_t *)map;
+    if (!ble_tx_stream_init(&s_stream, s_stream_storage, sizeof(s_stream_storage))) {
+        return ESP_ERR_NO_MEM;
+    }
+    // Everything but the head and the retained history is erased at a stop
+    s_erase_target = (s_sectors > TELEMETRY_RETAIN_SECTORS + 2) ? s_sectors - 1 - TELEMETRY_RETAIN_SECTORS : 1;
+    s_stats.sectors = s_sectors;
+    s_stats.erase_target = s_erase_target;
+    s_ready = true;
+    return ESP_OK;
+}
+
+uint8_t *telemetry_log_reserve(uint16_t max_len) {
+    if (!s_ready) {
+        return NULL;
+    }
+    return ble_tx_stream_reserve(&s_stream, max_len);
+}
+
+uint8_t *telemetry_log_try_reserve(uint16_t max_len) {
+    if (!s_ready) {
+        return NULL;
+    }
+    return ble_tx_stream_try_reserve(&s_stream, max_len);
+}
+
+void telemetry_log_commit(uint16_t len) {
+    ble_tx_stream_commit(&s_stream, len);
+}
+
+void telemetry_log_program_slot(void) {
+    if (!s_ready) {
+        return;
+    }
+    __atomic_store_n(&s_slot_us, (uint32_t)esp_timer_get_time(), __ATOMIC_RELAXED);
+    xSemaphoreGive(s_slot); // Binary: slots missed by the writer do not pile up
+}
+
+void telemetry_log_set_erase_allowed(bool allowed) {
+    __atomic_store_n(&s_erase_allowed, allowed, __ATOMIC_RELAXED);
+    if (allowed && s_ready && s_stream.consumer != NULL) {
+        xTaskNotifyGive(s_stream.consumer); // Start erasing ahead now
+    }
+}
+
+void telemetry_log_get_stats(telemetry_log_stats_t *out) {
+    if (s_lock == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    out->head_sequence = s_head_seq;
+    out->erased_ahead = s_erased_ahead;
+    out->frames_dropped += s_stream.dropped + s_stream.busy;
+    xSemaphoreGive(s_lock);
+}
+
+// Move to the next sector written before the snapshot's head
+static bool playback_next_sector(telemetry_playback_t *pb) {
+    if (pb->sequence == pb->last_sequence) {
+        return false;
+    }
+    uint32_t sector = pb->sector;
+    for (uint32_t i = 1; i < s_sectors; i++) {
+        sector = (sector + 1) % s_sectors;
+        const uint32_t seq = sector_sequence(sector);
+        if (seq > pb->sequence && seq <= pb->last_sequence) {
+            pb->sector = sector;
+            pb->sequence = seq;
+            pb->offset = TELEMETRY_SECTOR_HEADER_SIZE;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool telemetry_log_playback_begin(telemetry_playback_t *pb, uint32_t since_sequence) {
+    memset(pb, 0, sizeof(*pb));
+    if (!s_ready) {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    // Sectors claimed for erasing follow the head; the oldest data follows them
+    const uint32_t start = (s_head + 1 + s_erased_ahead) % s_sectors;
+    pb->last_sequence = s_head_seq;
+    pb->last_end = s_head_open ? s_flush_pos : TELEMETRY_SECTOR_SIZE;
+    s_playback_active = true;
+    xSemaphoreGive(s_lock);
+
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        const uint32_t sector = (start + i) % s_sectors;
+        const uint32_t seq = sector_sequence(sector);
+        if (seq != 0 && seq >= since_sequence && seq <= pb->last_sequence) {
+            pb->sector = sector;
+            pb->sequence = seq;
+            pb->offset = TELEMETRY_SECTOR_HEADER_SIZE;
+            pb->active = true;
+            return true;
+        }
+    }
+    telemetry_log_playback_end(pb);
+    return false;
+}
+
+uint16_t telemetry_log_playback_next(telemetry_playback_t *pb, uint16_t max_bytes, const uint8_t **span) {
+    while (pb->active) {
+        const uint8_t *sector = sector_ptr(pb->sector);
+        const uint32_t limit = (pb->sequence == pb->last_sequence) ? pb->last_end : TELEMETRY_SECTOR_SIZE;
+        uint32_t pos = pb->offset;
+        while (pos + TELEMETRY_RECORD_PREFIX <= limit) {
+            const uint16_t len = (uint16_t)sector[pos] | ((uint16_t)sector[pos + 1] << 8);
+            const uint32_t end = pos + TELEMETRY_RECORD_PREFIX + len;
+            if (len == TELEMETRY_RECORD_END || end > limit) {
+                break;
+            }
+            if (end - pb->offset > max_bytes) {
+                if (pos == pb->offset) {
+                    pb->offset = pos = end; // Cannot fit any packet: skip it
+                    continue;
+                }
+                break;
+            }
+            pos = end;
+        }
+        if (pos > pb->offset) {
+            *span = sector + pb->offset;
+            return (uint16_t)(pos - pb->offset);
+        }
+        if (!playback_next_sector(pb)) {
+            pb->active = false;
+        }
+    }
+    return 0;
+}
+
+void telemetry_log_playback_advance(telemetry_playback_t *pb, uint16_t len) {
+    pb->offset += len;
+    pb->bytes += len;
+}
+
+void telemetry_log_playback_end(telemetry_playback_t *pb) {
+    pb->active = false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_playback_active = false;
+    xSemaphoreGive(s_lock);
+}
+
+void telemetry_log_task(void *pvParameters) {
+    if (!s_ready) {
+        vTaskDelete(NULL);
+        return;
+    }
+    ble_tx_stream_set_consumer(&s_stream, xTaskGetCurrentTaskHandle());
+    locate_head(); // Reads the mapped partition; frames queue in RAM meanwhile
+
+    TickType_t last_flush = xTaskGetTickCount();
+    while (1) {
+        // Woken by each committed frame, or by the timeout that pushes partial pages out
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(TELEMETRY_FLUSH_PERIOD_MS));
+
+        const uint8_t *frame;
+        uint16_t len;
+        while (ble_tx_stream_peek(&s_stream, &frame, &len)) {
+            append_frame(frame, len);
+            ble_tx_stream_release(&s_stream, len);
+            if (s_stage_len >= TELEMETRY_PAGE_SIZE) {
+                flush_stage();
+                last_flush = xTaskGetTickCount();
+            }
+        }
+        if (s_stage_len > 0 && xTaskGetTickCount() - last_flush >= pdMS_TO_TICKS(TELEMETRY_FLUSH_PERIOD_MS)) {
+            flush_stage();
+            last_flush = xTaskGetTickCount();
+        }
+
+        // Build erased headroom while allowed, one sector per pass so new frames keep moving
+        if (s_erased_ahead < s_erase_target && erase_one_ahead()) {
+            xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#include "tuning_command.h"
+#include "hal.h"
+
+tuning_status_t tuning_command_parse(const uint8_t *data, uint16_t len, uint32_t received_us,
+                                     tuning_command_t *out) {
+    cw_frame_header_t header;
+    if (!cw_frame_check(data, len, &header) ||
+        header.service != CW_SERVICE_TUNING_ADJUSTMENT ||
+        header.payload_len != TUNING_COMMAND_PAYLOAD_SIZE) {
+        return TUNING_STATUS_BAD_FRAME;
+    }
+    const uint8_t *payload = data + CW_FRAME_HEADER_SIZE;
+    out->param = payload[0];
+    out->sequence = header.sequence;
+    out->value = (int16_t)((uint16_t)payload[1] | ((uint16_t)payload[2] << 8));
+    out->received_us = received_us;
+
+    int16_t min, max;
+    switch (out->param) {
+    case TUNING_PARAM_TIMING_OFFSET:
+        min = -TUNING_TIMING_OFFSET_MAX;
+        max = TUNING_TIMING_OFFSET_MAX;
+        break;
+    case TUNING_PARAM_FUEL_TRIM:
+        min = HAL_FUEL_TRIM_MIN;
+        max = HAL_FUEL_TRIM_MAX;
+        break;
+    case TUNING_PARAM_BOOST_TARGET:
+        min = 0;
+        max = TUNING_BOOST_TARGET_MAX;
+        break;
+    default:
+        return TUNING_STATUS_UNKNOWN_PARAM;
+    }
+    if (out->value < min || out->value > max) {
+        return TUNING_STATUS_OUT_OF_RANGE;
+    }
+    return TUNING_STATUS_OK;
+}
@@ -0,0 +1,146 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_attr.h>
+#include "tuning_map.h"
+
+#define FRAC_ONE (1 << TUNING_MAP_FRAC_BITS)
+#define RECIP_SHIFT 16
+
+static bool axis_valid(const uint16_t *axis, uint8_t bins, uint8_t max_bins) {
+    if (bins < 2 || bins > max_bins) {
+        return false;
+    }
+    for (uint8_t i = 1; i < bins; i++) {
+        if (axis[i] <= axis[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void axis_reciprocals(const uint16_t *axis, uint8_t bins, uint32_t *recip) {
+    for (uint8_t i = 0; i + 1 < bins; i++) {
+        // Rounded up, so a value on the upper breakpoint reaches a full Q8 one
+        const uint32_t span = (uint32_t)(axis[i + 1] - axis[i]);
+        recip[i] = ((1u << RECIP_SHIFT) + span - 1) / span;
+    }
+    recip[bins - 1] = 0;
+}
+
+esp_err_t tuning_map_prepare(tuning_map_t *map) {
+    if (!axis_valid(map->rpm_axis, map->rpm_bins, TUNING_MAP_MAX_RPM_BINS) ||
+        !axis_valid(map->load_axis, map->load_bins, TUNING_MAP_MAX_LOAD_BINS)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    axis_reciprocals(map->rpm_axis, map->rpm_bins, map->rpm_recip);
+    axis_reciprocals(map->load_axis, map->load_bins, map->load_recip);
+
+    // Each slot starts the search at the last bin whose breakpoint is at or
+    // below the slot's first RPM; lookups then step past at most the
+    // breakpoints that fall inside one 64 RPM slot
+    uint8_t bin = 0;
+    for (uint32_t slot = 0; slot < TUNING_MAP_RPM_LUT_SIZE; slot++) {
+        const uint32_t rpm = slot << TUNING_MAP_RPM_LUT_SHIFT;
+        while (bin + 2 < map->rpm_bins && map->rpm_axis[bin + 1] <= rpm) {
+            bin++;
+        }
+        map->rpm_lut[slot] = bin;
+    }
+    return ESP_OK;
+}
+
+// Fraction of the way from axis[bin] to axis[bin + 1], clamped to [0, 1] in Q8.
+// Forced inline: part of the IRAM lookup
+static inline __attribute__((always_inline)) uint32_t axis_fraction(const uint16_t *axis, const uint32_t *recip, uint8_t bin, uint16_t x) {
+    if (x <= axis[bin]) {
+        return 0;
+    }
+    const uint32_t frac = ((uint32_t)(x - axis[bin]) * recip[bin]) >> (RECIP_SHIFT - TUNING_MAP_FRAC_BITS);
+    return (frac > FRAC_ONE) ? FRAC_ONE : frac;
+}
+
+int16_t IRAM_ATTR tuning_map_lookup(const tuning_map_t *map, uint16_t rpm, uint16_t load) {
+    uint32_t slot = (uint32_t)rpm >> TUNING_MAP_RPM_LUT_SHIFT;
+    if (slot >= TUNING_MAP_RPM_LUT_SIZE) {
+        slot = TUNING_MAP_RPM_LUT_SIZE - 1;
+    }
+    uint8_t r = map->rpm_lut[slot];
+    while (r + 2 < map->rpm_bins && rpm >= map->rpm_axis[r + 1]) {
+        r++;
+    }
+
+    // Largest l <= load_bins - 2 with load_axis[l] <= load (or 0)
+    uint8_t l = 0;
+    uint8_t hi = map->load_bins - 1;
+    while (hi - l > 1) {
+        const uint8_t mid = (uint8_t)((l + hi) >> 1);
+        if (load >= map->load_axis[mid]) {
+            l = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const int32_t fr = (int32_t)axis_fraction(map->rpm_axis, map->rpm_recip, r, rpm);
+    const int32_t fl = (int32_t)axis_fraction(map->load_axis, map->load_recip, l, load);
+    const int16_t *row0 = &map->cells[r * map->load_bins + l];
+    const int16_t *row1 = row0 + map->load_bins;
+    // Q8 along load, then Q16 along RPM; int64 for the last product only
+    const int32_t top = row0[0] * FRAC_ONE + (row0[1] - row0[0]) * fl;
+    const int32_t bottom = row1[0] * FRAC_ONE + (row1[1] - row1[0]) * fl;
+    const int64_t blended = (int64_t)top * FRAC_ONE + (int64_t)(bottom - top) * fr;
+    return (int16_t)((blended + (1 << (2 * TUNING_MAP_FRAC_BITS - 1))) >> (2 * TUNING_MAP_FRAC_BITS));
+}
+
+esp_err_t tuning_map_set_init(tuning_map_set_t *set, const tuning_map_t *initial) {
+    set->maps[0] = *initial;
+    esp_err_t err = tuning_map_prepare(&set->maps[0]);
+    if (err != ESP_OK) {
+        return err;
+    }
+    set->maps[1] = set->maps[0];
+    set->readers[0] = 0;
+    set->readers[1] = 0;
+    set->generation = 0;
+    __atomic_store_n(&set->active, 0, __ATOMIC_SEQ_CST);
+    return ESP_OK;
+}
+
+int16_t IRAM_ATTR tuning_map_set_lookup(tuning_map_set_t *set, uint16_t rpm, uint16_t load) {
+    // Pin a copy, then check it is still the published one: either this sees
+    // a swap that raced the pin, or the writer sees the pin before reusing it
+    uint32_t index;
+    while (1) {
+        index = __atomic_load_n(&set->active, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&set->readers[index], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&set->active, __ATOMIC_SEQ_CST) == index) {
+            break;
+        }
+        __atomic_sub_fetch(&set->readers[index], 1, __ATOMIC_SEQ_CST);
+    }
+    const int16_t value = tuning_map_lookup(&set->maps[index], rpm, load);
+    __atomic_sub_fetch(&set->readers[index], 1, __ATOMIC_RELEASE);
+    return value;
+}
+
+tuning_map_t *tuning_map_set_begin_update(tuning_map_set_t *set) {
+    const uint32_t active = __atomic_load_n(&set->active, __ATOMIC_SEQ_CST);
+    const uint32_t spare = active ^ 1;
+    // Lookups take microseconds; a task reader may be preempted, so sleep rather than spin
+    while (__atomic_load_n(&set->readers[spare], __ATOMIC_SEQ_CST) != 0) {
+        vTaskDelay(1);
+    }
+    set->maps[spare] = set->maps[active];
+    return &set->maps[spare];
+}
+
+esp_err_t tuning_map_set_commit(tuning_map_set_t *set) {
+    const uint32_t spare = __atomic_load_n(&set->active, __ATOMIC_SEQ_CST) ^ 1;
+    esp_err_t err = tuning_map_prepare(&set->maps[spare]);
+    if (err != ESP_OK) {
+        return err;
+    }
+    __atomic_store_n(&set->active, spare, __ATOMIC_SEQ_CST);
+    set->generation++;
+    return ESP_OK;
+}
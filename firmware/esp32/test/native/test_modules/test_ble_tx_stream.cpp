@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include "ble_tx_stream.h"
+#include "hal_sim.h"
+
+namespace {
+
+constexpr uint32_t kStreamSize = 1024;
+
+class BleTxStreamTest : public ::testing::Test {
+protected:
+    void SetUp() override { ASSERT_TRUE(ble_tx_stream_init(&stream_, storage_, sizeof(storage_))); }
+
+    bool write(uint8_t fill, uint16_t len) {
+        uint8_t frame[BLE_TX_STREAM_MAX_FRAME];
+        memset(frame, fill, len);
+        return ble_tx_stream_write(&stream_, frame, len);
+    }
+
+    uint8_t storage_[kStreamSize];
+    ble_tx_stream_t stream_;
+};
+
+}  // namespace
+
+TEST_F(BleTxStreamTest, SpanPacksWholePrefixedFrames) {
+    ASSERT_TRUE(write(0xA1, 10));
+    ASSERT_TRUE(write(0xA2, 20));
+    ASSERT_TRUE(write(0xA3, 30));
+
+    const uint8_t *span;
+    bool full;
+    // Room for the first two prefixed frames only
+    const uint16_t len = ble_tx_stream_peek_span(&stream_, 2 * BLE_TX_STREAM_HEADER_SIZE + 30 + 5, &span, &full);
+    EXPECT_EQ(len, 2 * BLE_TX_STREAM_HEADER_SIZE + 30);
+    EXPECT_TRUE(full);
+    EXPECT_EQ(span[0], 10);
+    EXPECT_EQ(span[1], 0);
+    EXPECT_EQ(span[BLE_TX_STREAM_HEADER_SIZE], 0xA1);
+    ble_tx_stream_release_span(&stream_, len);
+
+    const uint8_t *frame;
+    uint16_t frame_len;
+    ASSERT_TRUE(ble_tx_stream_peek(&stream_, &frame, &frame_len));
+    EXPECT_EQ(frame_len, 30);
+    EXPECT_EQ(frame[0], 0xA3);
+}
+
+TEST_F(BleTxStreamTest, FrameNeverStraddlesTheEnd) {
+    // Fill most of the ring, drain it, then write a frame that cannot fit before the end
+    ASSERT_TRUE(write(0x11, 500));
+    ASSERT_TRUE(write(0x22, 400));
+    const uint8_t *frame;
+    uint16_t len;
+    ASSERT_TRUE(ble_tx_stream_peek(&stream_, &frame, &len));
+    ble_tx_stream_release(&stream_, len);
+
+    ASSERT_TRUE(write(0x33, 200));  // 120 bytes left before the end: skipped with a pad
+    ASSERT_TRUE(ble_tx_stream_peek(&stream_, &frame, &len));
+    EXPECT_EQ(len, 400);
+    ble_tx_stream_release(&stream_, len);
+    ASSERT_TRUE(ble_tx_stream_peek(&stream_, &frame, &len));
+    EXPECT_EQ(len, 200);
+    EXPECT_EQ(frame, storage_ + BLE_TX_STREAM_HEADER_SIZE);
+    EXPECT_EQ(frame[199], 0x33);
+}
+
+TEST_F(BleTxStreamTest, FullRingDropsAndCounts) {
+    while (write(0x55, BLE_TX_STREAM_MAX_FRAME)) {
+    }
+    EXPECT_EQ(stream_.dropped, 1u);
+    EXPECT_EQ(ble_tx_stream_reserve(&stream_, 0), nullptr);
+    EXPECT_EQ(ble_tx_stream_reserve(&stream_, BLE_TX_STREAM_MAX_FRAME + 1), nullptr);
+}
+
+TEST_F(BleTxStreamTest, OldestCommitTimeFollowsReleasedSpans) {
+    uint32_t commit_us;
+    EXPECT_FALSE(ble_tx_stream_oldest_commit(&stream_, &commit_us));
+    hal_sim_set_time_us(1000);
+    ASSERT_TRUE(write(0xB1, 10));
+    hal_sim_set_time_us(2000);
+    ASSERT_TRUE(write(0xB2, 10));
+    hal_sim_set_time_us(3000);
+    ASSERT_TRUE(write(0xB3, 10));
+
+    // A span of the first two frames goes out: the third has waited since 3000
+    const uint8_t *span;
+    bool full;
+    const uint16_t len = ble_tx_stream_peek_span(&stream_, 2 * (BLE_TX_STREAM_HEADER_SIZE + 10), &span, &full);
+    ASSERT_TRUE(ble_tx_stream_oldest_commit(&stream_, &commit_us));
+    EXPECT_EQ(commit_us, 1000u);
+    ble_tx_stream_release_span(&stream_, len);
+    ASSERT_TRUE(ble_tx_stream_oldest_commit(&stream_, &commit_us));
+    EXPECT_EQ(commit_us, 3000u);
+}
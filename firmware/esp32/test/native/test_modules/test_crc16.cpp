@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include "crc16.h"
+
+namespace {
+
+const uint8_t kCheckInput[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+// Bitwise reference: poly 0x1021, init 0xFFFF, no reflection
+uint16_t crc16_reference(const uint8_t *data, size_t len) {
+    uint16_t crc = CRC16_INIT;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+}  // namespace
+
+TEST(Crc16, CheckValue) {
+    EXPECT_EQ(crc16_compute(kCheckInput, sizeof(kCheckInput)), 0x29B1);
+}
+
+TEST(Crc16, EmptyMessageIsInit) {
+    EXPECT_EQ(crc16_compute(kCheckInput, 0), CRC16_INIT);
+}
+
+TEST(Crc16, ChunkedMatchesContiguous) {
+    // Every split point, so the slicing-by-4 head and tail paths are covered
+    for (size_t split = 0; split <= sizeof(kCheckInput); split++) {
+        uint16_t crc = crc16_update(CRC16_INIT, kCheckInput, split);
+        crc = crc16_update(crc, kCheckInput + split, sizeof(kCheckInput) - split);
+        EXPECT_EQ(crc, 0x29B1) << "split at " << split;
+    }
+}
+
+TEST(Crc16, MatchesBitwiseReference) {
+    uint8_t data[67];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 37 + 11);
+    }
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        EXPECT_EQ(crc16_compute(data, len), crc16_reference(data, len)) << "length " << len;
+    }
+}
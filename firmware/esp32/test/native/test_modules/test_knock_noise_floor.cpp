@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "knock_noise_floor.h"
+
+namespace {
+
+constexpr uint16_t kRpm = 2500;
+constexpr uint8_t kLoad = 40;
+
+class KnockNoiseFloorTest : public ::testing::Test {
+protected:
+    void SetUp() override { knock_noise_floor_init(&nf_); }
+
+    uint16_t update(uint32_t energy) { return knock_noise_floor_update(&nf_, 0, kRpm, kLoad, energy); }
+    uint32_t floor() const { return knock_noise_floor_get(&nf_, 0, kRpm, kLoad); }
+
+    knock_noise_floor_t nf_;
+};
+
+}  // namespace
+
+TEST_F(KnockNoiseFloorTest, FirstWindowSeedsWithoutScoring) {
+    EXPECT_EQ(update(10000), 0);
+    EXPECT_EQ(floor(), 10000u);
+    EXPECT_EQ(update(10000), KNOCK_SCORE_UNITY);
+}
+
+TEST_F(KnockNoiseFloorTest, DeadInputDoesNotSeed) {
+    // Sensor unplugged or DC at the first window
+    EXPECT_EQ(update(0), 0);
+    EXPECT_EQ(update(KNOCK_FLOOR_MIN - 1), 0);
+    EXPECT_EQ(floor(), 0u);
+    // The first live window seeds the cell, and normal noise then scores at unity
+    EXPECT_EQ(update(5000), 0);
+    EXPECT_EQ(update(5000), KNOCK_SCORE_UNITY);
+}
+
+TEST_F(KnockNoiseFloorTest, SmallFloorStillLearnsUpwards) {
+    update(KNOCK_FLOOR_MIN);
+    // Real noise appears: the floor must climb to it, not score knock forever
+    const uint32_t noise = 50 * KNOCK_FLOOR_MIN;
+    uint16_t score = UINT16_MAX;
+    for (int i = 0; i < 2000 && score > 2 * KNOCK_SCORE_UNITY; i++) {
+        score = update(noise);
+    }
+    EXPECT_LE(score, 2 * KNOCK_SCORE_UNITY);
+}
+
+TEST_F(KnockNoiseFloorTest, FloorNeverDropsBelowMinimum) {
+    update(4 * KNOCK_FLOOR_MIN);
+    for (int i = 0; i < 500; i++) {
+        update(0);
+    }
+    EXPECT_EQ(floor(), (uint32_t)KNOCK_FLOOR_MIN);
+}
+
+TEST_F(KnockNoiseFloorTest, KnockDoesNotDragTheFloorUp) {
+    update(10000);
+    const uint16_t score = update(100 * 10000u);
+    EXPECT_EQ(score, 100 * KNOCK_SCORE_UNITY);
+    // Learned from the clamped input (4x floor) with a 1/16 step
+    EXPECT_EQ(floor(), 10000u + (3 * 10000u >> KNOCK_FLOOR_ALPHA_SHIFT));
+}
+
+TEST_F(KnockNoiseFloorTest, CellsAreIndependent) {
+    update(10000);
+    EXPECT_EQ(knock_noise_floor_get(&nf_, 1, kRpm, kLoad), 0u);
+    EXPECT_EQ(knock_noise_floor_get(&nf_, 0, kRpm + KNOCK_FLOOR_RPM_BIN_WIDTH, kLoad), 0u);
+    EXPECT_EQ(knock_noise_floor_get(&nf_, 0, kRpm, kLoad + KNOCK_FLOOR_LOAD_BIN_WIDTH), 0u);
+}
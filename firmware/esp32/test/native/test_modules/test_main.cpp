@@ -0,0 +1,7 @@
+#include <gtest/gtest.h>
+
+// Host unit tests for the portable modules, built against the simulated HAL
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
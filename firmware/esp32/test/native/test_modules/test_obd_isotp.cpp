@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include "obd_pid.h"
+
+namespace {
+
+hal_can_frame_t make_frame(uint32_t id, std::initializer_list<uint8_t> bytes) {
+    hal_can_frame_t frame = {};
+    frame.id = id;
+    frame.dlc = HAL_CAN_MAX_DATA_LENGTH;
+    uint8_t i = 0;
+    for (uint8_t b : bytes) {
+        frame.data[i++] = b;
+    }
+    return frame;
+}
+
+}  // namespace
+
+TEST(ObdIsotp, SingleFrameCompletes) {
+    obd_isotp_rx_t rx;
+    obd_isotp_reset(&rx);
+    // 41 0C 1A F8: RPM = 0x1AF8 / 4
+    const hal_can_frame_t sf = make_frame(OBD_RESPONSE_ID_BASE, {0x04, 0x41, 0x0C, 0x1A, 0xF8});
+    ASSERT_EQ(obd_isotp_feed(&rx, &sf), OBD_ISOTP_COMPLETE);
+    ASSERT_EQ(rx.expected, 4);
+
+    obd_pid_value_t values[OBD_MAX_PIDS_PER_REQUEST];
+    ASSERT_EQ(obd_parse_mode01_response(rx.buffer, rx.expected, values, OBD_MAX_PIDS_PER_REQUEST), 1);
+    EXPECT_EQ(values[0].pid, 0x0C);
+    EXPECT_FLOAT_EQ(obd_pid_decode(&values[0]), 1726.0f);
+}
+
+TEST(ObdIsotp, FirstFrameThenConsecutiveFrames) {
+    obd_isotp_rx_t rx;
+    obd_isotp_reset(&rx);
+    // 15-byte response: 41, 0C xx xx, 0D xx, 05 xx, 0B xx, 11 xx, 04 xx, 0F xx
+    const uint8_t payload[15] = {0x41, 0x0C, 0x0B, 0xB8, 0x0D, 0x50, 0x05, 0x7B,
+                                 0x0B, 0x64, 0x11, 0x80, 0x04, 0x40, 0x0F};
+    const hal_can_frame_t ff = make_frame(OBD_RESPONSE_ID_BASE + 1,
+                                          {0x10, 15, payload[0], payload[1], payload[2], payload[3], payload[4], payload[5]});
+    ASSERT_EQ(obd_isotp_feed(&rx, &ff), OBD_ISOTP_NEED_FLOW_CONTROL);
+
+    hal_can_frame_t fc;
+    obd_build_flow_control(ff.id, &fc);
+    EXPECT_EQ(fc.id, OBD_PHYSICAL_REQUEST_BASE + 1u);
+    EXPECT_EQ(fc.data[0], 0x30);
+
+    const hal_can_frame_t cf1 = make_frame(ff.id, {0x21, payload[6], payload[7], payload[8], payload[9],
+                                                   payload[10], payload[11], payload[12]});
+    ASSERT_EQ(obd_isotp_feed(&rx, &cf1), OBD_ISOTP_INCOMPLETE);
+    const hal_can_frame_t cf2 = make_frame(ff.id, {0x22, payload[13], payload[14], 0xAA, 0xAA, 0xAA, 0xAA, 0xAA});
+    ASSERT_EQ(obd_isotp_feed(&rx, &cf2), OBD_ISOTP_COMPLETE);
+    ASSERT_EQ(rx.received, 15);
+    EXPECT_EQ(memcmp(rx.buffer, payload, sizeof(payload)), 0);  // Padding not copied in
+}
+
+TEST(ObdIsotp, OutOfSequenceConsecutiveFrameDropsTransfer) {
+    obd_isotp_rx_t rx;
+    obd_isotp_reset(&rx);
+    const hal_can_frame_t ff = make_frame(OBD_RESPONSE_ID_BASE, {0x10, 20, 0x41, 0, 0, 0, 0, 0});
+    ASSERT_EQ(obd_isotp_feed(&rx, &ff), OBD_ISOTP_NEED_FLOW_CONTROL);
+    const hal_can_frame_t cf = make_frame(ff.id, {0x22, 0, 0, 0, 0, 0, 0, 0});
+    EXPECT_EQ(obd_isotp_feed(&rx, &cf), OBD_ISOTP_ERROR);
+    EXPECT_FALSE(rx.active);
+
+    // A stray consecutive frame with nothing in progress is an error too
+    const hal_can_frame_t cf1 = make_frame(ff.id, {0x21, 0, 0, 0, 0, 0, 0, 0});
+    EXPECT_EQ(obd_isotp_feed(&rx, &cf1), OBD_ISOTP_ERROR);
+}
+
+TEST(ObdIsotp, RejectsOversizeFirstFrame) {
+    obd_isotp_rx_t rx;
+    obd_isotp_reset(&rx);
+    const hal_can_frame_t ff = make_frame(OBD_RESPONSE_ID_BASE, {0x10, OBD_ISOTP_MAX_PAYLOAD + 1, 0x41, 0, 0, 0, 0, 0});
+    EXPECT_EQ(obd_isotp_feed(&rx, &ff), OBD_ISOTP_ERROR);
+}
+
+TEST(ObdRequest, BuildsPaddedBatchedSingleFrame) {
+    const uint8_t pids[] = {0x0C, 0x0D, 0x05};
+    hal_can_frame_t frame;
+    ASSERT_EQ(obd_build_mode01_request(pids, 3, &frame), ESP_OK);
+    EXPECT_EQ(frame.id, (uint32_t)OBD_FUNCTIONAL_REQUEST_ID);
+    EXPECT_EQ(frame.dlc, HAL_CAN_MAX_DATA_LENGTH);
+    const uint8_t expected[8] = {0x04, 0x01, 0x0C, 0x0D, 0x05, 0x00, 0x00, 0x00};
+    EXPECT_EQ(memcmp(frame.data, expected, sizeof(expected)), 0);
+
+    EXPECT_EQ(obd_build_mode01_request(pids, 0, &frame), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(obd_build_mode01_request(pids, OBD_MAX_PIDS_PER_REQUEST + 1, &frame), ESP_ERR_INVALID_ARG);
+}
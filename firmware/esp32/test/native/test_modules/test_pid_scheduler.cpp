@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include "pid_scheduler.h"
+
+namespace {
+
+const pid_sched_config_t kConfig[] = {
+    {0x0C, 3, 50}, // RPM
+    {0x0B, 3, 50}, // MAP
+};
+
+obd_pid_value_t make_value(uint8_t pid) {
+    obd_pid_value_t v = {};
+    v.pid = pid;
+    v.len = obd_pid_data_length(pid);
+    return v;
+}
+
+uint32_t timeouts_of(const pid_scheduler_t *sched, uint8_t index) {
+    pid_sched_stats_t stats;
+    EXPECT_TRUE(pid_scheduler_get_stats(sched, index, &stats));
+    return stats.timeouts;
+}
+
+}  // namespace
+
+TEST(PidScheduler, PidLeftOutOfReplyCountsTimeout) {
+    pid_scheduler_t sched;
+    ASSERT_EQ(pid_scheduler_init(&sched, kConfig, 2, 0), ESP_OK);
+    uint8_t pids[OBD_MAX_PIDS_PER_REQUEST];
+    ASSERT_EQ(pid_scheduler_next_batch(&sched, 0, pids, OBD_MAX_PIDS_PER_REQUEST), 2);
+
+    // The ECU answers RPM only
+    const obd_pid_value_t values[] = {make_value(0x0C)};
+    EXPECT_TRUE(pid_scheduler_on_response(&sched, 2000, 0, values, 1));
+    EXPECT_FALSE(sched.awaiting_response);
+    EXPECT_FALSE(sched.entries[1].in_flight);
+    EXPECT_EQ(timeouts_of(&sched, 0), 0u);
+    EXPECT_EQ(timeouts_of(&sched, 1), 1u);
+}
+
+TEST(PidScheduler, SecondEcuReplyDoesNotSettleNextRequest) {
+    pid_scheduler_t sched;
+    ASSERT_EQ(pid_scheduler_init(&sched, kConfig, 2, 0), ESP_OK);
+    uint8_t pids[OBD_MAX_PIDS_PER_REQUEST];
+    ASSERT_EQ(pid_scheduler_next_batch(&sched, 0, pids, OBD_MAX_PIDS_PER_REQUEST), 2);
+    const obd_pid_value_t values[] = {make_value(0x0C), make_value(0x0B)};
+    ASSERT_TRUE(pid_scheduler_on_response(&sched, 2000, 0, values, 2));
+
+    // Next request goes out, then ECU 1's late copy of the first reply lands
+    ASSERT_EQ(pid_scheduler_next_batch(&sched, 20000, pids, OBD_MAX_PIDS_PER_REQUEST), 2);
+    const uint32_t latency_us = sched.latency_us;
+    EXPECT_FALSE(pid_scheduler_on_response(&sched, 20500, 1, values, 2));
+    EXPECT_TRUE(sched.awaiting_response);
+    EXPECT_EQ(sched.latency_us, latency_us);
+
+    EXPECT_TRUE(pid_scheduler_on_response(&sched, 22000, 0, values, 2));
+    EXPECT_FALSE(sched.awaiting_response);
+}
+
+TEST(PidScheduler, TimeoutReleasesResponder) {
+    pid_scheduler_t sched;
+    ASSERT_EQ(pid_scheduler_init(&sched, kConfig, 2, 0), ESP_OK);
+    uint8_t pids[OBD_MAX_PIDS_PER_REQUEST];
+    const obd_pid_value_t values[] = {make_value(0x0C), make_value(0x0B)};
+    ASSERT_EQ(pid_scheduler_next_batch(&sched, 0, pids, OBD_MAX_PIDS_PER_REQUEST), 2);
+    ASSERT_TRUE(pid_scheduler_on_response(&sched, 2000, 0, values, 2));
+
+    // ECU 0 goes quiet: after the timeout ECU 1 may answer
+    ASSERT_EQ(pid_scheduler_next_batch(&sched, 20000, pids, OBD_MAX_PIDS_PER_REQUEST), 2);
+    ASSERT_EQ(pid_scheduler_next_batch(&sched, 20000 + PID_SCHED_RESPONSE_TIMEOUT_US, pids,
+                                       OBD_MAX_PIDS_PER_REQUEST), 2);
+    EXPECT_EQ(timeouts_of(&sched, 0), 1u);
+    EXPECT_TRUE(pid_scheduler_on_response(&sched, 72000, 1, values, 2));
+}
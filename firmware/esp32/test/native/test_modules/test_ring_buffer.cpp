@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "ring_buffer.h"
+
+TEST(RingBuffer, OverwritesOldestWhenFull) {
+    uint8_t storage[4 * sizeof(uint32_t)];
+    ring_buffer_t rb;
+    ASSERT_TRUE(ring_buffer_init(&rb, storage, sizeof(storage), sizeof(uint32_t)));
+
+    for (uint32_t v = 1; v <= 6; v++) {
+        ASSERT_TRUE(ring_buffer_push(&rb, &v));
+    }
+    EXPECT_TRUE(ring_buffer_is_full(&rb));
+    for (uint32_t expected = 3; expected <= 6; expected++) {
+        uint32_t v = 0;
+        ASSERT_TRUE(ring_buffer_pop(&rb, &v));
+        EXPECT_EQ(v, expected);
+    }
+    EXPECT_TRUE(ring_buffer_is_empty(&rb));
+}
+
+TEST(RingBuffer, RegionsSplitAtTheWrap) {
+    uint8_t storage[8];
+    ring_buffer_t rb;
+    ASSERT_TRUE(ring_buffer_init(&rb, storage, sizeof(storage), 1));
+    const uint8_t first[6] = {0, 1, 2, 3, 4, 5};
+    ASSERT_EQ(ring_buffer_push_multiple(&rb, first, sizeof(first)), sizeof(first));
+    uint8_t sink[4];
+    ASSERT_EQ(ring_buffer_pop_multiple(&rb, sink, sizeof(sink)), 4u);
+
+    // head at 6: the contiguous write region ends at the buffer end
+    uint32_t avail = 0;
+    uint8_t *region = (uint8_t *)ring_buffer_get_write_region(&rb, &avail);
+    ASSERT_NE(region, nullptr);
+    EXPECT_EQ(region, storage + 6);
+    EXPECT_EQ(avail, 2u);
+    region[0] = 6;
+    region[1] = 7;
+    ASSERT_TRUE(ring_buffer_advance_write(&rb, 2));
+
+    region = (uint8_t *)ring_buffer_get_write_region(&rb, &avail);
+    ASSERT_NE(region, nullptr);
+    EXPECT_EQ(region, storage);
+    EXPECT_EQ(avail, 4u);
+
+    const uint8_t *read = (const uint8_t *)ring_buffer_get_read_region(&rb, &avail);
+    ASSERT_NE(read, nullptr);
+    EXPECT_EQ(read, storage + 4);
+    EXPECT_EQ(avail, 4u);
+    EXPECT_EQ(read[3], 7);
+}
+
+TEST(RingBufferSpsc, WrapsAndRejectsWhenFull) {
+    uint16_t storage[4];
+    ring_buffer_spsc_t rb;
+    ASSERT_TRUE(ring_buffer_spsc_init(&rb, (uint8_t *)storage, sizeof(storage), sizeof(uint16_t)));
+
+    // capacity - 1 usable slots; go around several times
+    uint16_t next_push = 0, next_pop = 0;
+    for (int round = 0; round < 5; round++) {
+        while (ring_buffer_spsc_push(&rb, &next_push)) {
+            next_push++;
+        }
+        EXPECT_EQ(ring_buffer_spsc_count(&rb), 3u);
+        uint16_t v;
+        while (ring_buffer_spsc_pop(&rb, &v)) {
+            EXPECT_EQ(v, next_pop++);
+        }
+        EXPECT_TRUE(ring_buffer_spsc_is_empty(&rb));
+    }
+    EXPECT_EQ(rb.overflows, 5u);
+}
+
+TEST(RingBufferTemplate, FreeRunningIndicesWrap) {
+    RingBuffer<uint32_t, 4> rb;
+    uint32_t next_pop = 0;
+    for (uint32_t v = 0; v < 10; v++) {
+        ASSERT_TRUE(rb.push(v));
+        if (rb.is_full()) {
+            EXPECT_FALSE(rb.push(v));
+            uint32_t out;
+            ASSERT_TRUE(rb.pop(out));
+            EXPECT_EQ(out, next_pop++);
+        }
+    }
+    EXPECT_EQ(rb.overflows(), 7u);
+    ASSERT_NE(rb.peek(), nullptr);
+    EXPECT_EQ(*rb.peek(), next_pop);
+}
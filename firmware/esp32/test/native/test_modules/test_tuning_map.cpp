@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "tuning_map.h"
+
+namespace {
+
+// 3 x 3 map: value = rpm_bin * 100 + load_bin * 10, so blends are exact
+tuning_map_t make_map() {
+    tuning_map_t map = {};
+    map.rpm_bins = 3;
+    map.load_bins = 3;
+    const uint16_t rpm_axis[] = {1000, 3000, 6000};
+    const uint16_t load_axis[] = {20, 60, 100};
+    for (int i = 0; i < 3; i++) {
+        map.rpm_axis[i] = rpm_axis[i];
+        map.load_axis[i] = load_axis[i];
+        for (int j = 0; j < 3; j++) {
+            map.cells[i * map.load_bins + j] = (int16_t)(i * 100 + j * 10);
+        }
+    }
+    return map;
+}
+
+}  // namespace
+
+TEST(TuningMap, ReturnsCellsOnBreakpoints) {
+    tuning_map_t map = make_map();
+    ASSERT_EQ(tuning_map_prepare(&map), ESP_OK);
+    EXPECT_EQ(tuning_map_lookup(&map, 1000, 20), 0);
+    EXPECT_EQ(tuning_map_lookup(&map, 3000, 60), 110);
+    EXPECT_EQ(tuning_map_lookup(&map, 6000, 100), 220);
+    EXPECT_EQ(tuning_map_lookup(&map, 6000, 20), 200);
+}
+
+TEST(TuningMap, InterpolatesBilinearly) {
+    tuning_map_t map = make_map();
+    ASSERT_EQ(tuning_map_prepare(&map), ESP_OK);
+    EXPECT_EQ(tuning_map_lookup(&map, 2000, 20), 50);   // Halfway along RPM
+    EXPECT_EQ(tuning_map_lookup(&map, 1000, 80), 15);   // Halfway along load
+    EXPECT_EQ(tuning_map_lookup(&map, 4500, 80), 165);  // Both, upper cells
+}
+
+TEST(TuningMap, ClampsOutsideTheAxes) {
+    tuning_map_t map = make_map();
+    ASSERT_EQ(tuning_map_prepare(&map), ESP_OK);
+    EXPECT_EQ(tuning_map_lookup(&map, 0, 0), 0);
+    EXPECT_EQ(tuning_map_lookup(&map, 500, 60), 10);
+    EXPECT_EQ(tuning_map_lookup(&map, 12000, 250), 220);  // Beyond the RPM LUT as well
+    EXPECT_EQ(tuning_map_lookup(&map, UINT16_MAX, 60), 210);
+}
+
+TEST(TuningMap, RejectsBadAxes) {
+    tuning_map_t map = make_map();
+    map.rpm_axis[2] = map.rpm_axis[1];
+    EXPECT_EQ(tuning_map_prepare(&map), ESP_ERR_INVALID_ARG);
+
+    map = make_map();
+    map.load_bins = 1;
+    EXPECT_EQ(tuning_map_prepare(&map), ESP_ERR_INVALID_ARG);
+}
+
+TEST(TuningMapSet, CommitPublishesAndBadCommitKeepsTheOld) {
+    static tuning_map_set_t set;
+    const tuning_map_t initial = make_map();
+    ASSERT_EQ(tuning_map_set_init(&set, &initial), ESP_OK);
+    EXPECT_EQ(tuning_map_set_lookup(&set, 3000, 60), 110);
+
+    tuning_map_t *spare = tuning_map_set_begin_update(&set);
+    spare->cells[1 * spare->load_bins + 1] = 150;
+    EXPECT_EQ(tuning_map_set_lookup(&set, 3000, 60), 110);  // Not published yet
+    ASSERT_EQ(tuning_map_set_commit(&set), ESP_OK);
+    EXPECT_EQ(tuning_map_set_lookup(&set, 3000, 60), 150);
+    EXPECT_EQ(set.generation, 1u);
+
+    spare = tuning_map_set_begin_update(&set);
+    EXPECT_EQ(spare->cells[1 * spare->load_bins + 1], 150);  // Copied from the published map
+    spare->rpm_axis[0] = 9000;
+    EXPECT_EQ(tuning_map_set_commit(&set), ESP_ERR_INVALID_ARG);
+    EXPECT_EQ(tuning_map_set_lookup(&set, 3000, 60), 150);
+    EXPECT_EQ(set.generation, 1u);
+}